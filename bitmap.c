@@ -0,0 +1,188 @@
+/* Bit operations on plain byte arrays, used by the bitmap commands working
+ * on string values (SETBIT, GETBIT, BITCOUNT, BITOP).
+ *
+ * Counting is the operation that scans whole bitmaps, so there are three
+ * kernels: a portable one counting 64 bits at a time with the usual SWAR
+ * tricks, one using the POPCNT instruction, and one using AVX2 to count the
+ * bits of 32 bytes at a time with a nibble lookup table (see Wojciech Mula,
+ * Nathan Kurz, Daniel Lemire, "Faster Population Counts Using AVX2
+ * Instructions"). The best kernel the CPU supports is picked at run time.
+ *
+ * BITOP works a 64 bit word at a time on the part of the bitmaps all the
+ * sources have, and a byte at a time on the rest, where the shorter sources
+ * are padded with zero bytes. */
+
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+#include "bitmap.h"
+
+#ifdef HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+/* Load a 64 bit word from a possibly unaligned address */
+static inline uint64_t bitmapLoad64(const unsigned char *p) {
+    uint64_t w;
+
+    memcpy(&w,p,sizeof(w));
+    return w;
+}
+
+static inline void bitmapStore64(unsigned char *p, uint64_t w) {
+    memcpy(p,&w,sizeof(w));
+}
+
+//统计一个字节中置1的位数
+static inline size_t bitmapCountByte(unsigned char b) {
+    b = b - ((b >> 1) & 0x55);
+    b = (b & 0x33) + ((b >> 2) & 0x33);
+    return (b + (b >> 4)) & 0x0f;
+}
+
+/* Portable kernel: every 64 bit word is reduced to per-byte counts, that
+ * are summed with a single multiplication */
+//不依赖特殊指令，一次统计64位
+static size_t bitmapCountSwar(const unsigned char *p, size_t len) {
+    size_t count = 0, j = 0;
+
+    for (; j+8 <= len; j += 8) {
+        uint64_t w = bitmapLoad64(p+j);
+
+        w = w - ((w >> 1) & 0x5555555555555555ULL);
+        w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+        w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        count += (w * 0x0101010101010101ULL) >> 56;
+    }
+    for (; j < len; j++) count += bitmapCountByte(p[j]);
+    return count;
+}
+
+#ifdef HAVE_AVX2_DISPATCH
+/* POPCNT kernel, four independent counters so that the instructions of
+ * consecutive words can run in parallel */
+//使用POPCNT指令，一次统计64位
+__attribute__((target("popcnt")))
+static size_t bitmapCountPopcnt(const unsigned char *p, size_t len) {
+    uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    size_t j = 0;
+
+    for (; j+32 <= len; j += 32) {
+        c0 += __builtin_popcountll(bitmapLoad64(p+j));
+        c1 += __builtin_popcountll(bitmapLoad64(p+j+8));
+        c2 += __builtin_popcountll(bitmapLoad64(p+j+16));
+        c3 += __builtin_popcountll(bitmapLoad64(p+j+24));
+    }
+    for (; j+8 <= len; j += 8) c0 += __builtin_popcountll(bitmapLoad64(p+j));
+    for (; j < len; j++) c0 += __builtin_popcount(p[j]);
+    return c0+c1+c2+c3;
+}
+
+/* AVX2 kernel: the count of every nibble is looked up with VPSHUFB, the
+ * per-byte counts are accumulated for up to 31 iterations (8 bits per
+ * byte, so they can't overflow) and then summed into four 64 bit lanes with
+ * VPSADBW. */
+//使用AVX2指令，一次统计256位
+__attribute__((target("avx2,popcnt")))
+static size_t bitmapCountAvx2(const unsigned char *p, size_t len) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+        0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i total = _mm256_setzero_si256();
+    uint64_t lanes[4];
+    size_t j = 0;
+
+    while (j+32 <= len) {
+        __m256i acc = _mm256_setzero_si256();
+        int k;
+
+        for (k = 0; k < 31 && j+32 <= len; k++, j += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p+j));
+            __m256i lo = _mm256_and_si256(v,low);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v,4),low);
+
+            acc = _mm256_add_epi8(acc,_mm256_shuffle_epi8(lookup,lo));
+            acc = _mm256_add_epi8(acc,_mm256_shuffle_epi8(lookup,hi));
+        }
+        total = _mm256_add_epi64(total,
+            _mm256_sad_epu8(acc,_mm256_setzero_si256()));
+    }
+    _mm256_storeu_si256((__m256i*)lanes,total);
+    return lanes[0]+lanes[1]+lanes[2]+lanes[3]+
+           bitmapCountPopcnt(p+j,len-j);
+}
+#endif
+
+/* Kernel used by bitmapCount(), picked the first time it is needed */
+typedef size_t bitmapCountKernel(const unsigned char *p, size_t len);
+static bitmapCountKernel *bitmapCountImpl = NULL;
+
+//选择统计位数使用的函数
+static void bitmapSelectKernels(void) {
+    bitmapCountImpl = bitmapCountSwar;
+#ifdef HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        bitmapCountImpl = bitmapCountAvx2;
+    else if (__builtin_cpu_supports("popcnt"))
+        bitmapCountImpl = bitmapCountPopcnt;
+#endif
+}
+
+//返回p开始的len个字节中置1的位数
+size_t bitmapCount(const unsigned char *p, size_t len) {
+    if (bitmapCountImpl == NULL) bitmapSelectKernels();
+    return bitmapCountImpl(p,len);
+}
+
+//对多个位图执行AND/OR/XOR/NOT运算
+void bitmapOp(int op, unsigned char *dst, const unsigned char **src,
+              const size_t *len, int numsrc)
+{
+    size_t minlen = len[0], maxlen = len[0], j = 0;
+    int k;
+
+    for (k = 1; k < numsrc; k++) {
+        if (len[k] < minlen) minlen = len[k];
+        if (len[k] > maxlen) maxlen = len[k];
+    }
+
+    /* Word at a time while all the sources have bytes */
+    for (; j+8 <= minlen; j += 8) {
+        uint64_t w = bitmapLoad64(src[0]+j);
+
+        switch(op) {
+        case BITMAP_OP_AND:
+            for (k = 1; k < numsrc; k++) w &= bitmapLoad64(src[k]+j);
+            break;
+        case BITMAP_OP_OR:
+            for (k = 1; k < numsrc; k++) w |= bitmapLoad64(src[k]+j);
+            break;
+        case BITMAP_OP_XOR:
+            for (k = 1; k < numsrc; k++) w ^= bitmapLoad64(src[k]+j);
+            break;
+        case BITMAP_OP_NOT:
+            w = ~w;
+            break;
+        }
+        bitmapStore64(dst+j,w);
+    }
+
+    /* Byte at a time for the rest, missing bytes are zero */
+    for (; j < maxlen; j++) {
+        unsigned char b = (j < len[0]) ? src[0][j] : 0;
+
+        for (k = 1; k < numsrc; k++) {
+            unsigned char s = (j < len[k]) ? src[k][j] : 0;
+
+            switch(op) {
+            case BITMAP_OP_AND: b &= s; break;
+            case BITMAP_OP_OR: b |= s; break;
+            case BITMAP_OP_XOR: b ^= s; break;
+            }
+        }
+        if (op == BITMAP_OP_NOT) b = ~b;
+        dst[j] = b;
+    }
+}
@@ -0,0 +1,29 @@
+/*
+ * bitmap.h与bitmap.c实现的是对一段连续内存按位进行的操作：
+ * 统计置1的位数以及多个位图之间的AND/OR/XOR/NOT运算，用于SETBIT/BITCOUNT/BITOP等命令
+ */
+
+#ifndef _BITMAP_H
+#define _BITMAP_H
+
+#include <stddef.h>
+
+#define BITMAP_OP_AND 0
+#define BITMAP_OP_OR 1
+#define BITMAP_OP_XOR 2
+#define BITMAP_OP_NOT 3
+
+/*
+ * 返回p开始的len个字节中置1的位数
+ * CPU支持时使用AVX2或者POPCNT指令
+ */
+size_t bitmapCount(const unsigned char *p, size_t len);
+
+/*
+ * 对numsrc个位图src[j](长度为len[j])执行op运算，结果保存在dst中
+ * dst的长度是最长的位图的长度，较短的位图后面视为0，NOT只使用src[0]
+ */
+void bitmapOp(int op, unsigned char *dst, const unsigned char **src,
+              const size_t *len, int numsrc);
+
+#endif /* _BITMAP_H */
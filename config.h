@@ -8,13 +8,42 @@
 #include <AvailabilityMacros.h>
 #endif
 
-/* test for malloc_size() */
-#ifdef __APPLE__
+/* test for malloc_size(). When the allocator is able to report the size of
+ * a block zmalloc() does not need to prefix every allocation with a header
+ * holding its size. USE_TCMALLOC and USE_JEMALLOC are set by the Makefile
+ * (make USE_TCMALLOC=yes / make USE_JEMALLOC=yes). */
+#if defined(USE_TCMALLOC)
+#include <google/tcmalloc.h>
+#define HAVE_MALLOC_SIZE 1
+#define redis_malloc_size(p) tc_malloc_size(p)
+#elif defined(USE_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#define HAVE_MALLOC_SIZE 1
+#define redis_malloc_size(p) malloc_usable_size(p)
+#elif defined(__APPLE__)
 #include <malloc/malloc.h>
 //下面这个宏定义表示有malloc_size这个函数
 #define HAVE_MALLOC_SIZE 1
 //将redis_malloc_size宏定义为malloc_size函数
 #define redis_malloc_size(p) malloc_size(p)
+#elif defined(__linux__)
+#include <malloc.h>
+#ifdef __GLIBC__
+//glibc下使用malloc_usable_size获取分配的内存空间大小
+#define HAVE_MALLOC_SIZE 1
+#define redis_malloc_size(p) malloc_usable_size(p)
+#endif
+#endif
+
+/* test for the __sync atomic builtins, used by zmalloc to update the used
+ * memory counter when other threads allocate or free memory as well */
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define HAVE_ATOMIC 1
+#endif
+
+/* test for /proc/self/stat, used to get the RSS */
+#ifdef __linux__
+#define HAVE_PROCFS 1
 #endif
 
 /* define redis_fstat to fstat or fstat64() */
@@ -28,6 +57,20 @@
 #define redis_stat stat
 #endif
 
+/* test for SSE2, always available on x86-64, used by the intset
+ * intersection kernels */
+#if defined(__SSE2__)
+#define HAVE_SSE2 1
+#endif
+
+/* test for the compiler support of per-function target attributes and of
+ * __builtin_cpu_supports(), used to pick the AVX2 intset intersection and
+ * the POPCNT/AVX2 bit counting kernels at run time when the CPU has them */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_AVX2_DISPATCH 1
+#endif
+
 /* test for backtrace() */
 #if defined(__APPLE__) || defined(__linux__)
 //返回函数的调用栈，一般用于调试（在mac以及linux下才有）
@@ -49,7 +49,7 @@ static void _dictFree(void *ptr) {
 
 static int _dictExpandIfNeeded(dict *ht);
 static unsigned long _dictNextPower(unsigned long size);
-static int _dictKeyIndex(dict *ht, const void *key);
+static int _dictKeyIndex(dict *ht, const void *key, unsigned int *hash);
 static int _dictInit(dict *ht, dictType *type, void *privDataPtr);
 
 /* -------------------------- hash functions -------------------------------- */
@@ -195,9 +195,10 @@ int dictExpand(dict *ht, unsigned long size)
             unsigned int h;
             nextHe = he->next;
             /* Get the new element index */
-            //dictHashKey(ht,he->key)获取相应的键值key,实际上就是取模运算
-            //求取在新hash表中的元素的位置
-            h = dictHashKey(ht, he->key) & n.sizemask;
+            //dictGetEntryHash获取相应的hash值,实际上就是取模运算
+            //求取在新hash表中的元素的位置. With DICT_CACHE_HASH
+            //this is just a load from the entry, no rehashing of the key.
+            h = dictGetEntryHash(ht, he) & n.sizemask;
             //采用的是头插入法进行的插入
             he->next = n.table[h];
             n.table[h] = he;
@@ -228,11 +229,12 @@ int dictExpand(dict *ht, unsigned long size)
 int dictAdd(dict *ht, void *key, void *val)
 {
     int index;
+    unsigned int hash;
     dictEntry *entry;
 
     /* Get the index of the new element, or -1 if
      * the element already exists. */
-    if ((index = _dictKeyIndex(ht, key)) == -1)
+    if ((index = _dictKeyIndex(ht, key, &hash)) == -1)
         return DICT_ERR;
 
     /* Allocates the memory and stores key */
@@ -246,6 +248,7 @@ int dictAdd(dict *ht, void *key, void *val)
     /* Set the hash entry fields. */
     dictSetHashKey(ht, entry, key);
     dictSetHashVal(ht, entry, val);
+    dictSetEntryHash(entry, hash);
     //使用的记录数进行+1操作
     ht->used++;
     //返回OK标记
@@ -282,7 +285,7 @@ int dictReplace(dict *ht, void *key, void *val)
 /* Search and remove an element */
 static int dictGenericDelete(dict *ht, const void *key, int nofree)
 {
-    unsigned int h;
+    unsigned int h, hash;
     dictEntry *he, *prevHe;
 
     if (ht->size == 0)
@@ -290,12 +293,14 @@ static int dictGenericDelete(dict *ht, const void *key, int nofree)
     /**
      *  返回key对应的dictEntry
      */
-    h = dictHashKey(ht, key) & ht->sizemask;
+    hash = dictHashKey(ht, key);
+    h = hash & ht->sizemask;
     he = ht->table[h];
 
     prevHe = NULL;
     while(he) {
-        if (dictCompareHashKeys(ht, key, he->key)) {
+        if (dictEntryHashMatch(he, hash) &&
+            dictCompareHashKeys(ht, key, he->key)) {
             /* Unlink the element from the list */
             if (prevHe)
                 prevHe->next = he->next;
@@ -391,13 +396,15 @@ void dictRelease(dict *ht)
 dictEntry *dictFind(dict *ht, const void *key)
 {
     dictEntry *he;
-    unsigned int h;
+    unsigned int h, hash;
     //如果Hash表的大小为0,则直接返回NULL
     if (ht->size == 0) return NULL;
-    h = dictHashKey(ht, key) & ht->sizemask;
+    hash = dictHashKey(ht, key);
+    h = hash & ht->sizemask;
     he = ht->table[h];
     while(he) {
-        if (dictCompareHashKeys(ht, key, he->key))
+        if (dictEntryHashMatch(he, hash) &&
+            dictCompareHashKeys(ht, key, he->key))
             return he;
         he = he->next;
     }
@@ -531,12 +538,14 @@ static unsigned long _dictNextPower(unsigned long size)
 
 /* Returns the index of a free slot that can be populated with
  * an hash entry for the given 'key'.
- * If the key already exists, -1 is returned. */
+ * If the key already exists, -1 is returned.
+ * The full hash of the key is returned by reference in *hash so that
+ * dictAdd() can store it in the new entry without hashing twice. */
 /**
  * 返回key在hash表的位置，如果key在Hash表里已经存在，
  * 则返回-1
  */
-static int _dictKeyIndex(dict *ht, const void *key)
+static int _dictKeyIndex(dict *ht, const void *key, unsigned int *hash)
 {
     unsigned int h;
     dictEntry *he;
@@ -550,12 +559,14 @@ static int _dictKeyIndex(dict *ht, const void *key)
     /**
      * 获取Hash表中key对应元素位置【即Hash表中的位置】 
      */
-    h = dictHashKey(ht, key) & ht->sizemask;
+    *hash = dictHashKey(ht, key);
+    h = *hash & ht->sizemask;
     /* Search if this slot does not already contain the given key */
     he = ht->table[h];
     while(he) {
         //如果已经存在了话，即键值相等的话
-        if (dictCompareHashKeys(ht, key, he->key))
+        if (dictEntryHashMatch(he, *hash) &&
+            dictCompareHashKeys(ht, key, he->key))
             return -1;
         he = he->next;
     }
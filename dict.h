@@ -8,11 +8,22 @@
 /* Unused arguments generate annoying warnings... */
 #define DICT_NOTUSED(V) ((void) V)
 
+/* When DICT_CACHE_HASH is defined every entry also stores the full hash
+ * value of its key. dictExpand() can then move entries to the new table
+ * without calling the hash function again, and lookups can skip entries
+ * whose hash differs without calling keyCompare (and touching the key
+ * memory at all). Comment the define out to trade speed for 4 bytes
+ * (plus padding) per entry. */
+#define DICT_CACHE_HASH
+
 //实际存放数据的地方
 typedef struct dictEntry {
     void *key;
     void *val;
     struct dictEntry *next;
+#ifdef DICT_CACHE_HASH
+    unsigned int hash;  //缓存的key的完整hash值
+#endif
 } dictEntry;
 
 //要作用于哈希表上的相关函数
@@ -103,6 +114,18 @@ typedef struct dictIterator {
 
 //对key进行hash取值
 #define dictHashKey(ht, key) (ht)->type->hashFunction(key)
+
+//获取/设置entry中缓存的hash值，没有缓存时重新计算
+#ifdef DICT_CACHE_HASH
+#define dictGetEntryHash(ht, he) ((he)->hash)
+#define dictSetEntryHash(he, _hash_) ((he)->hash = (_hash_))
+#define dictEntryHashMatch(he, _hash_) ((he)->hash == (_hash_))
+#else
+#define dictGetEntryHash(ht, he) dictHashKey(ht, (he)->key)
+#define dictSetEntryHash(he, _hash_) ((void) (_hash_))
+#define dictEntryHashMatch(he, _hash_) 1
+#endif
+
 //获取键值对中的键
 #define dictGetEntryKey(he) ((he)->key)
 //获取键值对中的值
@@ -0,0 +1,576 @@
+/* HyperLogLog cardinality estimation, stored as a string value.
+ *
+ * The hash of every element selects one of HLL_REGISTERS registers with
+ * its low HLL_P bits, and the register keeps the maximum run length seen
+ * of the remaining bits (trailing zeroes + 1). From the registers it is
+ * possible to estimate the number of distinct elements added, with a
+ * standard error of 1.04/sqrt(HLL_REGISTERS), that is 0.81%. The
+ * estimation uses the improved estimator described by Otmar Ertl in
+ * "New cardinality estimation algorithms for HyperLogLog sketches", that
+ * needs no bias correction tables and works well for small cardinalities.
+ *
+ * Every HyperLogLog starts with a 16 bytes header:
+ *
+ * +------+---+-----+----------+
+ * | HYLL | E | N/U | Cardin.  |
+ * +------+---+-----+----------+
+ *
+ * The magic "HYLL", the encoding E (dense or sparse), three unused bytes
+ * and the last computed cardinality as a 64 bit little endian integer. The
+ * most significant bit of the cardinality is set when it is not valid
+ * because registers were modified after it was computed.
+ *
+ * The DENSE encoding stores the registers as 6 bit integers, packed from
+ * the least significant bit of every byte: 12288 bytes for 16384 registers.
+ *
+ * The SPARSE encoding is a run length encoding of the registers, useful
+ * because most registers are zero when just a few elements were added.
+ * There are three opcodes:
+ *
+ * ZERO:  00xxxxxx           xxxxxx+1 (1-64) registers set to 0.
+ * XZERO: 01xxxxxx yyyyyyyy  xxxxxxyyyyyyyy+1 (1-16384) registers set to 0.
+ * VAL:   1vvvvvxx           xx+1 (1-4) registers set to vvvvv+1 (1-32).
+ *
+ * An empty HyperLogLog is a single XZERO opcode. A register can't be set
+ * to a value greater than 32 in the sparse encoding, and the sparse
+ * encoding stops paying off after a few thousand bytes, so in both cases
+ * the HyperLogLog is converted to the dense encoding, that is never
+ * converted back. */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "sds.h"
+#include "hyperloglog.h"
+
+#define HLL_Q (64-HLL_P)    /* Bits of the hash used for the run length */
+#define HLL_P_MASK (HLL_REGISTERS-1)
+#define HLL_BITS 6          /* Enough to store values up to HLL_Q+1 */
+#define HLL_REGISTER_MAX ((1<<HLL_BITS)-1)
+#define HLL_HDR_SIZE 16
+#define HLL_DENSE_SIZE (HLL_HDR_SIZE+((HLL_REGISTERS*HLL_BITS+7)/8))
+#define HLL_DENSE 0
+#define HLL_SPARSE 1
+#define HLL_ALPHA_INF 0.721347520444481703680 /* 1/(2*log(2)) */
+
+typedef struct hllhdr {
+    char magic[4];          /* "HYLL" */
+    uint8_t encoding;       /* HLL_DENSE or HLL_SPARSE */
+    uint8_t notused[3];
+    uint8_t card[8];        /* Cached cardinality, little endian */
+    uint8_t registers[];
+} hllhdr;
+
+#define HLL_INVALIDATE_CACHE(hdr) ((hdr)->card[7] |= (1<<7))
+#define HLL_VALID_CACHE(hdr) (((hdr)->card[7] & (1<<7)) == 0)
+
+#define HLL_SPARSE_XZERO_BIT 0x40 /* 01xxxxxx */
+#define HLL_SPARSE_VAL_BIT 0x80 /* 1vvvvvxx */
+#define HLL_SPARSE_IS_ZERO(p) (((*(p)) & 0xc0) == 0)
+#define HLL_SPARSE_IS_XZERO(p) (((*(p)) & 0xc0) == HLL_SPARSE_XZERO_BIT)
+#define HLL_SPARSE_IS_VAL(p) ((*(p)) & HLL_SPARSE_VAL_BIT)
+#define HLL_SPARSE_ZERO_LEN(p) (((*(p)) & 0x3f)+1)
+#define HLL_SPARSE_XZERO_LEN(p) (((((*(p)) & 0x3f) << 8) | (*((p)+1)))+1)
+#define HLL_SPARSE_VAL_VALUE(p) ((((*(p)) >> 2) & 0x1f)+1)
+#define HLL_SPARSE_VAL_LEN(p) (((*(p)) & 0x3)+1)
+#define HLL_SPARSE_VAL_MAX_VALUE 32
+#define HLL_SPARSE_VAL_MAX_LEN 4
+#define HLL_SPARSE_ZERO_MAX_LEN 64
+#define HLL_SPARSE_XZERO_MAX_LEN 16384
+#define HLL_SPARSE_VAL(val,len) \
+    ((uint8_t)((((val)-1) << 2) | ((len)-1) | HLL_SPARSE_VAL_BIT))
+#define HLL_SPARSE_ZERO(len) ((uint8_t)((len)-1))
+
+/* ========================== Registers and hashing ========================= */
+
+//获取稠密编码中第regnum个寄存器的值
+static inline uint8_t hllDenseGet(const uint8_t *p, long regnum) {
+    unsigned long byte = regnum*HLL_BITS/8;
+    unsigned long fb = (regnum*HLL_BITS)&7;
+    unsigned long b0 = p[byte];
+    unsigned long b1 = (fb > 8-HLL_BITS) ? p[byte+1] : 0;
+
+    return ((b0 >> fb) | (b1 << (8-fb))) & HLL_REGISTER_MAX;
+}
+
+//设置稠密编码中第regnum个寄存器的值
+static inline void hllDenseSet(uint8_t *p, long regnum, uint8_t val) {
+    unsigned long byte = regnum*HLL_BITS/8;
+    unsigned long fb = (regnum*HLL_BITS)&7;
+
+    p[byte] &= ~(HLL_REGISTER_MAX << fb);
+    p[byte] |= val << fb;
+    if (fb > 8-HLL_BITS) {
+        p[byte+1] &= ~(HLL_REGISTER_MAX >> (8-fb));
+        p[byte+1] |= val >> (8-fb);
+    }
+}
+
+/* MurmurHash2, 64 bit version, by Austin Appleby. The bytes are read one by
+ * one so that the hash is the same on big and little endian machines. */
+static uint64_t MurmurHash64A(const unsigned char *data, size_t len,
+                              uint64_t seed)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    uint64_t h = seed ^ (len * m);
+    const unsigned char *end = data + (len-(len&7));
+
+    while (data != end) {
+        uint64_t k;
+
+        k = (uint64_t) data[0];
+        k |= (uint64_t) data[1] << 8;
+        k |= (uint64_t) data[2] << 16;
+        k |= (uint64_t) data[3] << 24;
+        k |= (uint64_t) data[4] << 32;
+        k |= (uint64_t) data[5] << 40;
+        k |= (uint64_t) data[6] << 48;
+        k |= (uint64_t) data[7] << 56;
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+        data += 8;
+    }
+
+    switch(len & 7) {
+    case 7: h ^= (uint64_t)data[6] << 48; /* fall through */
+    case 6: h ^= (uint64_t)data[5] << 40; /* fall through */
+    case 5: h ^= (uint64_t)data[4] << 32; /* fall through */
+    case 4: h ^= (uint64_t)data[3] << 24; /* fall through */
+    case 3: h ^= (uint64_t)data[2] << 16; /* fall through */
+    case 2: h ^= (uint64_t)data[1] << 8; /* fall through */
+    case 1: h ^= (uint64_t)data[0];
+            h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+/* Return the register of the element in *regp, and the value the register
+ * should have for it: the number of trailing zeroes of the rest of the
+ * hash, plus one. */
+//计算元素对应的寄存器以及寄存器的值
+static int hllPatLen(const unsigned char *ele, size_t len, long *regp) {
+    uint64_t hash = MurmurHash64A(ele,len,0xadc83b19ULL);
+
+    *regp = hash & HLL_P_MASK;
+    hash >>= HLL_P;
+    /* Sentinel bit, so the count is at most HLL_Q+1 */
+    hash |= (uint64_t)1 << HLL_Q;
+    return __builtin_ctzll(hash)+1;
+}
+
+/* ============================== Estimation ================================ */
+
+static double hllSigma(double x) {
+    double zPrime, y = 1, z = x;
+
+    if (x == 1.) return INFINITY;
+    do {
+        x *= x;
+        zPrime = z;
+        z += x * y;
+        y += y;
+    } while(zPrime != z);
+    return z;
+}
+
+static double hllTau(double x) {
+    double zPrime, y = 1.0, z = 1 - x;
+
+    if (x == 0. || x == 1.) return 0.;
+    do {
+        x = sqrt(x);
+        zPrime = z;
+        y *= 0.5;
+        z -= (1 - x) * (1 - x) * y;
+    } while(zPrime != z);
+    return z / 3;
+}
+
+/* Estimate the cardinality from the histogram of the register values */
+//根据寄存器值的分布估算基数
+static uint64_t hllEstimate(const int *reghisto) {
+    double m = HLL_REGISTERS, z;
+    int j;
+
+    z = m * hllTau((m-reghisto[HLL_Q+1])/m);
+    for (j = HLL_Q; j >= 1; --j) {
+        z += reghisto[j];
+        z *= 0.5;
+    }
+    z += m * hllSigma(reghisto[0]/m);
+    return (uint64_t) llround(HLL_ALPHA_INF*m*m/z);
+}
+
+/* Histogram of the dense registers. With 6 bit registers every 3 bytes
+ * hold exactly 4 registers, so they are unpacked 4 at a time without the
+ * generic bit offset arithmetic. */
+//统计稠密编码中每种寄存器值的个数
+static void hllDenseHisto(const uint8_t *p, int *reghisto) {
+    int j;
+
+    for (j = 0; j < HLL_REGISTERS/4; j++, p += 3) {
+        unsigned b0 = p[0], b1 = p[1], b2 = p[2];
+
+        reghisto[b0 & 63]++;
+        reghisto[((b0 >> 6) | (b1 << 2)) & 63]++;
+        reghisto[((b1 >> 4) | (b2 << 4)) & 63]++;
+        reghisto[b2 >> 2]++;
+    }
+}
+
+/* Histogram of the sparse registers. Returns -1 if the opcodes don't cover
+ * exactly HLL_REGISTERS registers. */
+//统计稀疏编码中每种寄存器值的个数
+static int hllSparseHisto(const uint8_t *p, const uint8_t *end,
+                          int *reghisto)
+{
+    long idx = 0, runlen;
+
+    while (p < end) {
+        if (HLL_SPARSE_IS_ZERO(p)) {
+            runlen = HLL_SPARSE_ZERO_LEN(p);
+            reghisto[0] += runlen;
+            p++;
+        } else if (HLL_SPARSE_IS_XZERO(p)) {
+            runlen = HLL_SPARSE_XZERO_LEN(p);
+            reghisto[0] += runlen;
+            p += 2;
+        } else {
+            runlen = HLL_SPARSE_VAL_LEN(p);
+            reghisto[HLL_SPARSE_VAL_VALUE(p)] += runlen;
+            p++;
+        }
+        idx += runlen;
+    }
+    return (idx == HLL_REGISTERS) ? 0 : -1;
+}
+
+/* =============================== Encodings ================================ */
+
+//初始化头部
+static void hllInitHeader(hllhdr *hdr, int encoding) {
+    memcpy(hdr->magic,"HYLL",4);
+    hdr->encoding = encoding;
+    memset(hdr->notused,0,sizeof(hdr->notused));
+    memset(hdr->card,0,sizeof(hdr->card));
+    HLL_INVALIDATE_CACHE(hdr);
+}
+
+//创建一个空的HyperLogLog，所有寄存器用一个XZERO表示
+sds hllNew(void) {
+    sds s = sdsnewlen(NULL,HLL_HDR_SIZE+2);
+    hllhdr *hdr = (hllhdr*)s;
+
+    hllInitHeader(hdr,HLL_SPARSE);
+    /* The cardinality of an empty HyperLogLog is known */
+    memset(hdr->card,0,sizeof(hdr->card));
+    hdr->registers[0] = HLL_SPARSE_XZERO_BIT | ((HLL_REGISTERS-1) >> 8);
+    hdr->registers[1] = (HLL_REGISTERS-1) & 0xff;
+    return s;
+}
+
+//根据寄存器数组创建稠密编码的HyperLogLog
+sds hllNewDense(const uint8_t *regs) {
+    sds s = sdsnewlen(NULL,HLL_DENSE_SIZE);
+    hllhdr *hdr = (hllhdr*)s;
+    long j;
+
+    hllInitHeader(hdr,HLL_DENSE);
+    for (j = 0; j < HLL_REGISTERS; j++)
+        if (regs[j]) hllDenseSet(hdr->registers,j,regs[j]);
+    return s;
+}
+
+//检查头部以及长度是否合法
+int hllValid(const sds s) {
+    hllhdr *hdr = (hllhdr*)s;
+    size_t len = sdslen(s);
+
+    if (len < HLL_HDR_SIZE || memcmp(hdr->magic,"HYLL",4) != 0) return 0;
+    if (hdr->encoding == HLL_DENSE) return len == HLL_DENSE_SIZE;
+    return hdr->encoding == HLL_SPARSE;
+}
+
+/* Convert a sparse HyperLogLog to the dense encoding. On success the old
+ * string is freed and *sp points to the new one. Returns -1 if the sparse
+ * representation is corrupted, leaving *sp untouched. */
+//将稀疏编码转为稠密编码
+static int hllSparseToDense(sds *sp) {
+    sds old = *sp, s;
+    uint8_t *p = ((hllhdr*)old)->registers, *end = (uint8_t*)old+sdslen(old);
+    long idx = 0, runlen, j;
+
+    s = sdsnewlen(NULL,HLL_DENSE_SIZE);
+    memcpy(s,old,HLL_HDR_SIZE);
+    ((hllhdr*)s)->encoding = HLL_DENSE;
+    while (p < end) {
+        if (HLL_SPARSE_IS_ZERO(p)) {
+            idx += HLL_SPARSE_ZERO_LEN(p);
+            p++;
+        } else if (HLL_SPARSE_IS_XZERO(p)) {
+            idx += HLL_SPARSE_XZERO_LEN(p);
+            p += 2;
+        } else {
+            int val = HLL_SPARSE_VAL_VALUE(p);
+
+            runlen = HLL_SPARSE_VAL_LEN(p);
+            if (idx+runlen > HLL_REGISTERS) break;
+            for (j = 0; j < runlen; j++)
+                hllDenseSet(((hllhdr*)s)->registers,idx++,val);
+            p++;
+        }
+    }
+    if (idx != HLL_REGISTERS) {
+        sdsfree(s);
+        return -1;
+    }
+    sdsfree(old);
+    *sp = s;
+    return 0;
+}
+
+/* Replace the 'oldlen' bytes at offset 'pos' of the sparse string with the
+ * 'seqlen' bytes of 'seq', growing or shrinking the string. */
+//替换稀疏编码中的一段操作码
+static sds hllSparseReplace(sds s, size_t pos, size_t oldlen,
+                            const uint8_t *seq, size_t seqlen)
+{
+    size_t len = sdslen(s);
+
+    if (seqlen > oldlen) s = sdsgrowzero(s,len+seqlen-oldlen);
+    memmove(s+pos+seqlen,s+pos+oldlen,len-pos-oldlen);
+    memcpy(s+pos,seq,seqlen);
+    if (seqlen < oldlen) s = sdsrange(s,0,len+seqlen-oldlen-1);
+    return s;
+}
+
+/* Set the register 'index' of a sparse HyperLogLog to 'count' if it is
+ * currently smaller. The opcode covering the register is split into up to
+ * three opcodes (the registers before it, the register, the registers
+ * after it), then adjacent VAL opcodes with the same value are joined
+ * again. If the value does not fit the sparse encoding, or the string
+ * grows past 'sparsemax' bytes, the HyperLogLog is converted to the dense
+ * encoding first.
+ *
+ * Returns 1 if the register was modified, 0 if not, -1 on corruption. */
+//设置稀疏编码中的一个寄存器
+static int hllSparseSet(sds *sp, long index, uint8_t count, size_t sparsemax) {
+    sds s = *sp;
+    uint8_t *start, *end, *p, *prev = NULL, seq[5], *n = seq;
+    long first = 0, span = 0, last, runlen = 0;
+    size_t pos, oldlen = 1, prevpos = 0;
+    int scanlen;
+
+    if (count > HLL_SPARSE_VAL_MAX_VALUE) goto promote;
+
+    /* Find the opcode covering the register */
+    start = ((hllhdr*)s)->registers;
+    end = (uint8_t*)s+sdslen(s);
+    p = start;
+    while (p < end) {
+        oldlen = 1;
+        if (HLL_SPARSE_IS_ZERO(p)) {
+            span = HLL_SPARSE_ZERO_LEN(p);
+        } else if (HLL_SPARSE_IS_VAL(p)) {
+            span = HLL_SPARSE_VAL_LEN(p);
+        } else {
+            span = HLL_SPARSE_XZERO_LEN(p);
+            oldlen = 2;
+        }
+        if (index <= first+span-1) break;
+        prev = p;
+        p += oldlen;
+        first += span;
+    }
+    if (p >= end || (oldlen == 2 && p+1 >= end)) return -1;
+    last = first+span-1;
+    if (prev) prevpos = prev-(uint8_t*)s;
+    pos = p-(uint8_t*)s;
+
+    if (HLL_SPARSE_IS_VAL(p)) {
+        int oldcount = HLL_SPARSE_VAL_VALUE(p);
+
+        if (oldcount >= count) return 0;
+        /* Single register run: just update the value */
+        if (span == 1) {
+            *p = HLL_SPARSE_VAL(count,1);
+            goto updated;
+        }
+        if (index != first) {
+            runlen = index-first;
+            *n++ = HLL_SPARSE_VAL(oldcount,runlen);
+        }
+        *n++ = HLL_SPARSE_VAL(count,1);
+        if (index != last) {
+            runlen = last-index;
+            *n++ = HLL_SPARSE_VAL(oldcount,runlen);
+        }
+    } else {
+        if (span == 1 && HLL_SPARSE_IS_ZERO(p)) {
+            *p = HLL_SPARSE_VAL(count,1);
+            goto updated;
+        }
+        if (index != first) {
+            runlen = index-first;
+            if (runlen > HLL_SPARSE_ZERO_MAX_LEN) {
+                *n++ = HLL_SPARSE_XZERO_BIT | ((runlen-1) >> 8);
+                *n++ = (runlen-1) & 0xff;
+            } else {
+                *n++ = HLL_SPARSE_ZERO(runlen);
+            }
+        }
+        *n++ = HLL_SPARSE_VAL(count,1);
+        if (index != last) {
+            runlen = last-index;
+            if (runlen > HLL_SPARSE_ZERO_MAX_LEN) {
+                *n++ = HLL_SPARSE_XZERO_BIT | ((runlen-1) >> 8);
+                *n++ = (runlen-1) & 0xff;
+            } else {
+                *n++ = HLL_SPARSE_ZERO(runlen);
+            }
+        }
+    }
+    if (sdslen(s)+(n-seq)-oldlen > sparsemax) goto promote;
+    s = *sp = hllSparseReplace(s,pos,oldlen,seq,n-seq);
+
+updated:
+    /* Join adjacent VAL opcodes with the same value, starting from the
+     * opcode before the modified one. Only a few opcodes can be affected. */
+    p = (uint8_t*)s+(prev ? prevpos : HLL_HDR_SIZE);
+    end = (uint8_t*)s+sdslen(s);
+    scanlen = 5;
+    while (p < end && scanlen--) {
+        if (HLL_SPARSE_IS_XZERO(p)) {
+            p += 2;
+            continue;
+        } else if (HLL_SPARSE_IS_ZERO(p)) {
+            p++;
+            continue;
+        }
+        if (p+1 < end && HLL_SPARSE_IS_VAL(p+1)) {
+            int v1 = HLL_SPARSE_VAL_VALUE(p);
+            int v2 = HLL_SPARSE_VAL_VALUE(p+1);
+            long len = HLL_SPARSE_VAL_LEN(p)+HLL_SPARSE_VAL_LEN(p+1);
+
+            if (v1 == v2 && len <= HLL_SPARSE_VAL_MAX_LEN) {
+                seq[0] = HLL_SPARSE_VAL(v1,len);
+                pos = p-(uint8_t*)s;
+                s = *sp = hllSparseReplace(s,pos,2,seq,1);
+                p = (uint8_t*)s+pos;
+                end = (uint8_t*)s+sdslen(s);
+                continue;
+            }
+        }
+        p++;
+    }
+    HLL_INVALIDATE_CACHE((hllhdr*)s);
+    return 1;
+
+promote:
+    if (hllSparseToDense(sp) == -1) return -1;
+    s = *sp;
+    if (hllDenseGet(((hllhdr*)s)->registers,index) >= count) return 0;
+    hllDenseSet(((hllhdr*)s)->registers,index,count);
+    HLL_INVALIDATE_CACHE((hllhdr*)s);
+    return 1;
+}
+
+/* ================================== API =================================== */
+
+//添加一个元素
+int hllAdd(sds *s, const unsigned char *ele, size_t len, size_t sparsemax) {
+    hllhdr *hdr = (hllhdr*)*s;
+    long index;
+    int count = hllPatLen(ele,len,&index);
+
+    if (hdr->encoding == HLL_SPARSE)
+        return hllSparseSet(s,index,count,sparsemax);
+    if (hllDenseGet(hdr->registers,index) >= count) return 0;
+    hllDenseSet(hdr->registers,index,count);
+    HLL_INVALIDATE_CACHE(hdr);
+    return 1;
+}
+
+//读取缓存的基数
+int hllCachedCount(const sds s, uint64_t *card) {
+    hllhdr *hdr = (hllhdr*)s;
+    uint64_t c = 0;
+    int j;
+
+    if (!HLL_VALID_CACHE(hdr)) return 0;
+    for (j = 7; j >= 0; j--) c = (c << 8) | hdr->card[j];
+    *card = c;
+    return 1;
+}
+
+//计算基数并更新缓存
+int hllCount(sds s, uint64_t *card) {
+    hllhdr *hdr = (hllhdr*)s;
+    int reghisto[64] = {0}, j;
+    uint64_t c;
+
+    if (hdr->encoding == HLL_DENSE) {
+        hllDenseHisto(hdr->registers,reghisto);
+    } else if (hllSparseHisto(hdr->registers,(uint8_t*)s+sdslen(s),
+                              reghisto) == -1) {
+        return -1;
+    }
+    c = hllEstimate(reghisto);
+    for (j = 0; j < 8; j++) hdr->card[j] = (c >> (j*8)) & 0xff;
+    *card = c;
+    return 0;
+}
+
+//合并寄存器，每个寄存器取最大值
+int hllMerge(uint8_t *regs, const sds s) {
+    hllhdr *hdr = (hllhdr*)s;
+    long idx = 0, runlen, j;
+
+    if (hdr->encoding == HLL_DENSE) {
+        for (j = 0; j < HLL_REGISTERS; j++) {
+            uint8_t val = hllDenseGet(hdr->registers,j);
+
+            if (val > regs[j]) regs[j] = val;
+        }
+        return 0;
+    } else {
+        uint8_t *p = hdr->registers, *end = (uint8_t*)s+sdslen(s);
+
+        while (p < end) {
+            if (HLL_SPARSE_IS_ZERO(p)) {
+                idx += HLL_SPARSE_ZERO_LEN(p);
+                p++;
+            } else if (HLL_SPARSE_IS_XZERO(p)) {
+                idx += HLL_SPARSE_XZERO_LEN(p);
+                p += 2;
+            } else {
+                uint8_t val = HLL_SPARSE_VAL_VALUE(p);
+
+                runlen = HLL_SPARSE_VAL_LEN(p);
+                if (idx+runlen > HLL_REGISTERS) return -1;
+                for (j = 0; j < runlen; j++, idx++)
+                    if (val > regs[idx]) regs[idx] = val;
+                p++;
+            }
+        }
+        return (idx == HLL_REGISTERS) ? 0 : -1;
+    }
+}
+
+//根据寄存器数组估算基数
+uint64_t hllCountRegisters(const uint8_t *regs) {
+    int reghisto[64] = {0};
+    long j;
+
+    for (j = 0; j < HLL_REGISTERS; j++) reghisto[regs[j]]++;
+    return hllEstimate(reghisto);
+}
@@ -0,0 +1,59 @@
+/*
+ * hyperloglog.h与hyperloglog.c实现的是HyperLogLog：
+ * 用固定的内存(最多12KB)估算集合中不同元素的个数，标准误差约0.81%，
+ * 保存在一个sds字符串中，寄存器较少被使用时用稀疏编码，用于PFADD/PFCOUNT/PFMERGE等命令
+ */
+
+#ifndef _HYPERLOGLOG_H
+#define _HYPERLOGLOG_H
+
+#include <stdint.h>
+#include "sds.h"
+
+#define HLL_P 14                        /* 寄存器序号占用hash的位数 */
+#define HLL_REGISTERS (1<<HLL_P)        /* 寄存器个数，16384 */
+
+/*
+ * 创建一个空的HyperLogLog，使用稀疏编码
+ */
+sds hllNew(void);
+
+/*
+ * 根据寄存器数组regs(每个寄存器一个字节)创建一个稠密编码的HyperLogLog
+ */
+sds hllNewDense(const uint8_t *regs);
+
+/*
+ * 检查s的头部是否是一个合法的HyperLogLog
+ */
+int hllValid(const sds s);
+
+/*
+ * 添加一个元素，稀疏编码超过sparsemax字节时转为稠密编码，*s可能会改变
+ * 有寄存器被修改时返回1，否则返回0，数据损坏时返回-1
+ */
+int hllAdd(sds *s, const unsigned char *ele, size_t len, size_t sparsemax);
+
+/*
+ * 缓存的基数有效时保存到*card并返回1，否则返回0
+ */
+int hllCachedCount(const sds s, uint64_t *card);
+
+/*
+ * 计算基数保存到*card，同时更新缓存
+ * 成功时返回0，数据损坏时返回-1
+ */
+int hllCount(sds s, uint64_t *card);
+
+/*
+ * 将s的寄存器合并到regs中(每个寄存器取最大值)
+ * 成功时返回0，数据损坏时返回-1
+ */
+int hllMerge(uint8_t *regs, const sds s);
+
+/*
+ * 根据寄存器数组regs估算基数
+ */
+uint64_t hllCountRegisters(const uint8_t *regs);
+
+#endif /* _HYPERLOGLOG_H */
@@ -0,0 +1,480 @@
+/* The intset is a sorted array of integers without duplicates, used to
+ * represent small sets made only of integers. All the elements have the
+ * same size, the smallest of int16_t, int32_t and int64_t able to hold all
+ * of them: when a value that does not fit is added the whole array is
+ * upgraded to the larger encoding (it is never downgraded).
+ *
+ * The layout is:
+ *
+ * <encoding><length><contents>
+ *
+ * <encoding> is the size in bytes of every element, <length> the number of
+ * elements, and <contents> the elements sorted from the smallest to the
+ * greatest, so lookups are binary searches. Adding and removing elements
+ * moves the following elements and reallocates the intset, so this is only
+ * fast for small sets.
+ *
+ * Values are stored in the host byte order, intsets are only used in memory
+ * and are never written on disk as they are.
+ *
+ * Two intsets are intersected walking both the sorted arrays. When they have
+ * the same 16 or 32 bit encoding blocks of elements are compared at once
+ * with SSE2 (or AVX2, if the CPU supports it), and when one intset is much
+ * smaller its elements are searched in the other one galloping.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "zmalloc.h"
+#include "intset.h"
+
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+#define INTSET_ENC_INT16 (sizeof(int16_t))
+#define INTSET_ENC_INT32 (sizeof(int32_t))
+#define INTSET_ENC_INT64 (sizeof(int64_t))
+
+//内存出错函数
+static void intsetOomAbort(void) {
+    fprintf(stderr,"intset: Out Of Memory\n");
+    abort();
+}
+
+/* Return the encoding needed to store 'v' */
+//获取保存v需要的编码
+static uint8_t intsetValueEncoding(int64_t v) {
+    if (v < INT32_MIN || v > INT32_MAX)
+        return INTSET_ENC_INT64;
+    else if (v < INT16_MIN || v > INT16_MAX)
+        return INTSET_ENC_INT32;
+    return INTSET_ENC_INT16;
+}
+
+/* Return the element at 'pos' using the encoding 'enc' */
+//按照enc编码读取pos位置的元素
+static int64_t intsetGetEncoded(intset *is, int pos, uint8_t enc) {
+    if (enc == INTSET_ENC_INT64)
+        return ((int64_t*)is->contents)[pos];
+    else if (enc == INTSET_ENC_INT32)
+        return ((int32_t*)is->contents)[pos];
+    return ((int16_t*)is->contents)[pos];
+}
+
+//读取pos位置的元素
+static int64_t intsetGetValue(intset *is, int pos) {
+    return intsetGetEncoded(is,pos,is->encoding);
+}
+
+//设置pos位置的元素
+static void intsetSetValue(intset *is, int pos, int64_t value) {
+    if (is->encoding == INTSET_ENC_INT64) {
+        ((int64_t*)is->contents)[pos] = value;
+    } else if (is->encoding == INTSET_ENC_INT32) {
+        ((int32_t*)is->contents)[pos] = value;
+    } else {
+        ((int16_t*)is->contents)[pos] = value;
+    }
+}
+
+//创建一个空的intset
+intset *intsetNew(void) {
+    intset *is = zmalloc(sizeof(intset));
+
+    if (is == NULL) intsetOomAbort();
+    is->encoding = INTSET_ENC_INT16;
+    is->length = 0;
+    return is;
+}
+
+//调整intset的大小以保存len个元素
+static intset *intsetResize(intset *is, uint32_t len) {
+    size_t size = (size_t)len*is->encoding;
+
+    is = zrealloc(is,sizeof(intset)+size);
+    if (is == NULL) intsetOomAbort();
+    return is;
+}
+
+/* Search 'value'. Returns 1 if it was found, with its position in *pos,
+ * otherwise 0, with the position where it should be inserted in *pos. */
+//二分查找value，找到时返回1，pos为元素或者插入的位置
+static int intsetSearch(intset *is, int64_t value, uint32_t *pos) {
+    int min = 0, max = is->length-1, mid = -1;
+    int64_t cur = -1;
+
+    if (is->length == 0) {
+        if (pos) *pos = 0;
+        return 0;
+    }
+    /* Check the ends first: appending in order is the common case */
+    if (value > intsetGetValue(is,max)) {
+        if (pos) *pos = is->length;
+        return 0;
+    } else if (value < intsetGetValue(is,0)) {
+        if (pos) *pos = 0;
+        return 0;
+    }
+
+    while (max >= min) {
+        mid = ((unsigned int)min + (unsigned int)max) >> 1;
+        cur = intsetGetValue(is,mid);
+        if (value > cur) {
+            min = mid+1;
+        } else if (value < cur) {
+            max = mid-1;
+        } else {
+            break;
+        }
+    }
+
+    if (value == cur) {
+        if (pos) *pos = mid;
+        return 1;
+    }
+    if (pos) *pos = min;
+    return 0;
+}
+
+/* Upgrade the encoding to the one needed by 'value' and add it. As the
+ * value does not fit the current encoding it is either smaller or greater
+ * than all the elements, so it goes at one of the ends. */
+//升级intset的编码并添加value
+static intset *intsetUpgradeAndAdd(intset *is, int64_t value) {
+    uint8_t curenc = is->encoding;
+    uint8_t newenc = intsetValueEncoding(value);
+    int length = is->length;
+    int prepend = value < 0 ? 1 : 0;
+
+    is->encoding = newenc;
+    is = intsetResize(is,is->length+1);
+
+    /* Convert from the end, so that values are not overwritten */
+    while (length--)
+        intsetSetValue(is,length+prepend,intsetGetEncoded(is,length,curenc));
+
+    if (prepend)
+        intsetSetValue(is,0,value);
+    else
+        intsetSetValue(is,is->length,value);
+    is->length++;
+    return is;
+}
+
+//将from开始的元素移动到to，用于插入或者删除元素
+static void intsetMoveTail(intset *is, uint32_t from, uint32_t to) {
+    uint32_t bytes = (is->length-from)*is->encoding;
+
+    memmove(is->contents+(size_t)to*is->encoding,
+            is->contents+(size_t)from*is->encoding,bytes);
+}
+
+//添加一个元素
+intset *intsetAdd(intset *is, int64_t value, int *success) {
+    uint8_t valenc = intsetValueEncoding(value);
+    uint32_t pos;
+
+    if (success) *success = 1;
+    if (valenc > is->encoding) return intsetUpgradeAndAdd(is,value);
+    if (intsetSearch(is,value,&pos)) {
+        if (success) *success = 0;
+        return is;
+    }
+    is = intsetResize(is,is->length+1);
+    if (pos < is->length) intsetMoveTail(is,pos,pos+1);
+    intsetSetValue(is,pos,value);
+    is->length++;
+    return is;
+}
+
+//删除一个元素
+intset *intsetRemove(intset *is, int64_t value, int *success) {
+    uint8_t valenc = intsetValueEncoding(value);
+    uint32_t pos;
+
+    if (success) *success = 0;
+    if (valenc <= is->encoding && intsetSearch(is,value,&pos)) {
+        if (success) *success = 1;
+        if (pos < is->length-1) intsetMoveTail(is,pos+1,pos);
+        is->length--;
+        is = intsetResize(is,is->length);
+    }
+    return is;
+}
+
+//判断value是否在intset中
+int intsetFind(intset *is, int64_t value) {
+    uint8_t valenc = intsetValueEncoding(value);
+
+    return valenc <= is->encoding && intsetSearch(is,value,NULL);
+}
+
+//随机返回一个元素
+int64_t intsetRandom(intset *is) {
+    return intsetGetValue(is,rand()%is->length);
+}
+
+//获取pos位置的元素
+int intsetGet(intset *is, uint32_t pos, int64_t *value) {
+    if (pos >= is->length) return 0;
+    *value = intsetGetValue(is,pos);
+    return 1;
+}
+
+//元素个数
+uint32_t intsetLen(intset *is) {
+    return is->length;
+}
+
+//intset占用的字节数
+size_t intsetBlobLen(intset *is) {
+    return sizeof(intset)+(size_t)is->length*is->encoding;
+}
+
+/* Intersection. All the kernels write the elements common to 'a' and 'b'
+ * in 'dst' starting at position 'n' and return the new number of elements
+ * of 'dst'. As an element of both intsets fits both encodings, 'dst' uses
+ * the smaller one. */
+
+/* When the larger intset has this many times the elements of the smaller,
+ * the elements of the smaller are searched galloping in the larger */
+#define INTSET_GALLOP_RATIO 32
+
+/* Merge the sorted arrays starting at a[i] and b[j] */
+//从a[i]和b[j]开始合并两个有序数组求交集
+static uint32_t intsetIntersectMerge(intset *a, intset *b, intset *dst,
+                                     uint32_t i, uint32_t j, uint32_t n)
+{
+    while (i < a->length && j < b->length) {
+        int64_t va = intsetGetValue(a,i), vb = intsetGetValue(b,j);
+
+        if (va < vb) {
+            i++;
+        } else if (va > vb) {
+            j++;
+        } else {
+            intsetSetValue(dst,n++,va);
+            i++;
+            j++;
+        }
+    }
+    return n;
+}
+
+/* Search every element of the small intset 'a' in 'b': exponential steps
+ * from the last match find a range of 'b' holding the element, then a
+ * binary search finds it. */
+//在b中倍增查找a的每个元素
+static uint32_t intsetIntersectGallop(intset *a, intset *b, intset *dst) {
+    uint32_t i, n = 0;
+    uint64_t j = 0;
+
+    for (i = 0; i < a->length && j < b->length; i++) {
+        int64_t v = intsetGetValue(a,i);
+        uint64_t lo = j, hi = j, step = 1;
+
+        while (hi < b->length && intsetGetValue(b,hi) < v) {
+            lo = hi+1;
+            hi += step;
+            step <<= 1;
+        }
+        if (hi > b->length) hi = b->length;
+        /* The first element not smaller than 'v' is in b[lo..hi] */
+        while (lo < hi) {
+            uint64_t mid = lo+(hi-lo)/2;
+
+            if (intsetGetValue(b,mid) < v) lo = mid+1;
+            else hi = mid;
+        }
+        j = lo;
+        if (j < b->length && intsetGetValue(b,j) == v) {
+            intsetSetValue(dst,n++,v);
+            j++;
+        }
+    }
+    return n;
+}
+
+#ifdef HAVE_SSE2
+/* Compare 4 elements of 'a' against 4 elements of 'b' rotating the vector
+ * of 'b', so the mask tells which elements of 'a' are in the block of 'b'.
+ * Then the block with the smaller last element is consumed: none of its
+ * elements can match the elements following the other block. */
+//SSE2一次比较4个int32元素
+static uint32_t intsetIntersect32Sse2(intset *a, intset *b, intset *dst,
+                                      uint32_t *ip, uint32_t *jp)
+{
+    const int32_t *va = (int32_t*)a->contents, *vb = (int32_t*)b->contents;
+    int32_t *out = (int32_t*)dst->contents;
+    uint32_t i = 0, j = 0, n = 0, k;
+    uint32_t la = a->length & ~3U, lb = b->length & ~3U;
+
+    while (i < la && j < lb) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(va+i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(vb+j));
+        __m128i m;
+        int mask;
+
+        m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(x,y),
+                _mm_cmpeq_epi32(x,_mm_shuffle_epi32(y,_MM_SHUFFLE(0,3,2,1)))),
+            _mm_or_si128(
+                _mm_cmpeq_epi32(x,_mm_shuffle_epi32(y,_MM_SHUFFLE(1,0,3,2))),
+                _mm_cmpeq_epi32(x,_mm_shuffle_epi32(y,_MM_SHUFFLE(2,1,0,3)))));
+        mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+        for (k = 0; mask; k++, mask >>= 1)
+            if (mask & 1) out[n++] = va[i+k];
+        if (va[i+3] <= vb[j+3]) i += 4;
+        else j += 4;
+    }
+    *ip = i;
+    *jp = j;
+    return n;
+}
+
+/* Rotate the 8 elements of a vector of int16 by 'k' positions */
+#define INTSET_ROT16(y,k) \
+    _mm_or_si128(_mm_srli_si128(y,2*(k)),_mm_slli_si128(y,16-2*(k)))
+
+/* Like intsetIntersect32Sse2() with 8 elements at a time */
+//SSE2一次比较8个int16元素
+static uint32_t intsetIntersect16Sse2(intset *a, intset *b, intset *dst,
+                                      uint32_t *ip, uint32_t *jp)
+{
+    const int16_t *va = (int16_t*)a->contents, *vb = (int16_t*)b->contents;
+    int16_t *out = (int16_t*)dst->contents;
+    uint32_t i = 0, j = 0, n = 0, k;
+    uint32_t la = a->length & ~7U, lb = b->length & ~7U;
+
+    while (i < la && j < lb) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(va+i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(vb+j));
+        __m128i m;
+        int mask;
+
+        m = _mm_or_si128(
+            _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi16(x,y),
+                             _mm_cmpeq_epi16(x,INTSET_ROT16(y,1))),
+                _mm_or_si128(_mm_cmpeq_epi16(x,INTSET_ROT16(y,2)),
+                             _mm_cmpeq_epi16(x,INTSET_ROT16(y,3)))),
+            _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi16(x,INTSET_ROT16(y,4)),
+                             _mm_cmpeq_epi16(x,INTSET_ROT16(y,5))),
+                _mm_or_si128(_mm_cmpeq_epi16(x,INTSET_ROT16(y,6)),
+                             _mm_cmpeq_epi16(x,INTSET_ROT16(y,7)))));
+        /* One bit per element */
+        mask = _mm_movemask_epi8(_mm_packs_epi16(m,_mm_setzero_si128()));
+        for (k = 0; mask; k++, mask >>= 1)
+            if (mask & 1) out[n++] = va[i+k];
+        if (va[i+7] <= vb[j+7]) i += 8;
+        else j += 8;
+    }
+    *ip = i;
+    *jp = j;
+    return n;
+}
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+/* Like intsetIntersect32Sse2() with 8 elements at a time, only called when
+ * the CPU supports AVX2 */
+//AVX2一次比较8个int32元素
+__attribute__((target("avx2")))
+static uint32_t intsetIntersect32Avx2(intset *a, intset *b, intset *dst,
+                                      uint32_t *ip, uint32_t *jp)
+{
+    const int32_t *va = (int32_t*)a->contents, *vb = (int32_t*)b->contents;
+    int32_t *out = (int32_t*)dst->contents;
+    uint32_t i = 0, j = 0, n = 0, k;
+    uint32_t la = a->length & ~7U, lb = b->length & ~7U;
+    const __m256i rot = _mm256_setr_epi32(1,2,3,4,5,6,7,0);
+
+    while (i < la && j < lb) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(va+i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(vb+j));
+        __m256i m = _mm256_cmpeq_epi32(x,y);
+        int mask;
+
+        for (k = 1; k < 8; k++) {
+            y = _mm256_permutevar8x32_epi32(y,rot);
+            m = _mm256_or_si256(m,_mm256_cmpeq_epi32(x,y));
+        }
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+        for (k = 0; mask; k++, mask >>= 1)
+            if (mask & 1) out[n++] = va[i+k];
+        if (va[i+7] <= vb[j+7]) i += 8;
+        else j += 8;
+    }
+    *ip = i;
+    *jp = j;
+    return n;
+}
+#endif
+
+/* Kernel used for two int32 intsets, picked the first time it is needed */
+typedef uint32_t intsetBlockKernel(intset *a, intset *b, intset *dst,
+                                   uint32_t *ip, uint32_t *jp);
+static intsetBlockKernel *intsetIntersect32Kernel = NULL;
+
+//选择int32交集使用的函数
+static void intsetSelectKernels(void) {
+#if defined(HAVE_AVX2_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        intsetIntersect32Kernel = intsetIntersect32Avx2;
+        return;
+    }
+#endif
+#if defined(HAVE_SSE2)
+    intsetIntersect32Kernel = intsetIntersect32Sse2;
+#endif
+}
+
+//返回a与b的交集
+intset *intsetIntersect(intset *a, intset *b) {
+    intset *dst;
+    uint32_t i = 0, j = 0, n = 0;
+    uint8_t enc;
+
+    if (a->length > b->length) {
+        intset *tmp = a;
+
+        a = b;
+        b = tmp;
+    }
+    enc = (a->encoding < b->encoding) ? a->encoding : b->encoding;
+    dst = zmalloc(sizeof(intset)+(size_t)a->length*enc);
+    if (dst == NULL) intsetOomAbort();
+    dst->encoding = enc;
+    if (a->length == 0) {
+        n = 0;
+    } else if (b->length/a->length >= INTSET_GALLOP_RATIO) {
+        n = intsetIntersectGallop(a,b,dst);
+    } else {
+        if (a->encoding == b->encoding) {
+            static int selected = 0;
+
+            if (!selected) {
+                intsetSelectKernels();
+                selected = 1;
+            }
+            if (a->encoding == INTSET_ENC_INT32 && intsetIntersect32Kernel)
+                n = intsetIntersect32Kernel(a,b,dst,&i,&j);
+#ifdef HAVE_SSE2
+            else if (a->encoding == INTSET_ENC_INT16)
+                n = intsetIntersect16Sse2(a,b,dst,&i,&j);
+#endif
+        }
+        /* The remaining elements, or all of them without a block kernel */
+        n = intsetIntersectMerge(a,b,dst,i,j,n);
+    }
+    dst->length = n;
+    return intsetResize(dst,n);
+}
@@ -0,0 +1,70 @@
+/*
+ * intset.h与intset.c实现的是一个有序的整数数组：
+ * 所有元素按从小到大的顺序保存在一块连续的内存中，用于保存元素较少且都是整数的set
+ */
+
+#ifndef _INTSET_H
+#define _INTSET_H
+
+#include <stdint.h>
+
+/*
+ * encoding是每个元素占用的字节数(INTSET_ENC_INT16/32/64)
+ * length是元素个数
+ * contents保存所有的元素，按从小到大排序
+ */
+typedef struct intset {
+    uint32_t encoding;
+    uint32_t length;
+    int8_t contents[];
+} intset;
+
+/*
+ * 创建一个空的intset
+ */
+intset *intsetNew(void);
+
+/*
+ * 添加一个元素，已经存在时*success为0，否则为1
+ * 返回新的intset地址
+ */
+intset *intsetAdd(intset *is, int64_t value, int *success);
+
+/*
+ * 删除一个元素，不存在时*success为0，否则为1
+ * 返回新的intset地址
+ */
+intset *intsetRemove(intset *is, int64_t value, int *success);
+
+/*
+ * 判断value是否在intset中
+ */
+int intsetFind(intset *is, int64_t value);
+
+/*
+ * 随机返回一个元素，intset不能为空
+ */
+int64_t intsetRandom(intset *is);
+
+/*
+ * 获取pos位置的元素，越界时返回0
+ */
+int intsetGet(intset *is, uint32_t pos, int64_t *value);
+
+/*
+ * 元素个数
+ */
+uint32_t intsetLen(intset *is);
+
+/*
+ * intset占用的字节数
+ */
+size_t intsetBlobLen(intset *is);
+
+/*
+ * 返回一个新的intset，保存a与b的交集
+ * 编码相同时用SSE2/AVX2一次比较多个元素，大小相差很多时倍增查找
+ */
+intset *intsetIntersect(intset *a, intset *b);
+
+#endif /* _INTSET_H */
@@ -0,0 +1,333 @@
+/* A quicklist is a doubly linked list of ziplists. Every node holds up to
+ * 'fill' elements, packed in a ziplist that is at most about
+ * QUICKLIST_NODE_MAX_BYTES long, so a big list costs a few bytes per element
+ * instead of a list node and an object for every element, and the elements
+ * are stored in a few big allocations instead of millions of small ones.
+ *
+ * Every node knows how many elements it holds, so accessing an element by
+ * index skips whole nodes, starting from the end of the list that is
+ * closer to the element, and then walks the ziplist of the node, again from
+ * its closer end. LINDEX, LSET and LRANGE near the tail of a big list are
+ * now as fast as near the head.
+ *
+ * Nodes are only created and filled by pushes at the head or at the tail,
+ * the only way elements are added to Redis lists.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "zmalloc.h"
+#include "ziplist.h"
+#include "quicklist.h"
+
+/* Worst case overhead of a ziplist entry: the prevlen and encoding fields */
+#define QUICKLIST_ENTRY_OVERHEAD 10
+
+//内存出错函数
+static void quicklistOomAbort(void) {
+    fprintf(stderr,"quicklist: Out Of Memory\n");
+    abort();
+}
+
+//创建一个空的quicklist
+quicklist *quicklistCreate(unsigned int fill) {
+    quicklist *ql = zmalloc(sizeof(*ql));
+
+    if (ql == NULL) quicklistOomAbort();
+    ql->head = ql->tail = NULL;
+    ql->count = 0;
+    ql->len = 0;
+    ql->fill = fill ? fill : 1;
+    return ql;
+}
+
+//创建一个保存zl的节点
+static quicklistNode *quicklistCreateNode(unsigned char *zl) {
+    quicklistNode *node = zmalloc(sizeof(*node));
+
+    if (node == NULL) quicklistOomAbort();
+    node->prev = node->next = NULL;
+    node->zl = zl;
+    node->sz = ziplistBlobLen(zl);
+    node->count = ziplistLen(zl);
+    return node;
+}
+
+//将节点添加到头部或者尾部
+static void quicklistLinkNode(quicklist *ql, quicklistNode *node, int where) {
+    if (where == QUICKLIST_HEAD) {
+        node->prev = NULL;
+        node->next = ql->head;
+        if (ql->head) ql->head->prev = node;
+        else ql->tail = node;
+        ql->head = node;
+    } else {
+        node->next = NULL;
+        node->prev = ql->tail;
+        if (ql->tail) ql->tail->next = node;
+        else ql->head = node;
+        ql->tail = node;
+    }
+    ql->len++;
+    ql->count += node->count;
+}
+
+//将节点从quicklist中摘除，不释放节点
+static void quicklistUnlinkNode(quicklist *ql, quicklistNode *node) {
+    if (node->prev) node->prev->next = node->next;
+    else ql->head = node->next;
+    if (node->next) node->next->prev = node->prev;
+    else ql->tail = node->prev;
+    ql->len--;
+    ql->count -= node->count;
+}
+
+//摘除并释放节点
+static void quicklistDelNode(quicklist *ql, quicklistNode *node) {
+    quicklistUnlinkNode(ql,node);
+    zfree(node->zl);
+    zfree(node);
+}
+
+//释放quicklist
+void quicklistRelease(quicklist *ql) {
+    quicklistNode *node = ql->head, *next;
+
+    while (node) {
+        next = node->next;
+        zfree(node->zl);
+        zfree(node);
+        node = next;
+    }
+    zfree(ql);
+}
+
+/* True if an element of 'sz' bytes can be added to 'node' */
+//判断节点能否再保存一个sz字节的元素
+static int quicklistNodeAllowInsert(quicklist *ql, quicklistNode *node, unsigned int sz) {
+    if (node == NULL || node->count >= ql->fill) return 0;
+    return node->sz+sz+QUICKLIST_ENTRY_OVERHEAD <= QUICKLIST_NODE_MAX_BYTES;
+}
+
+//在头部或者尾部添加一个元素，头(尾)节点满了时创建新节点
+void quicklistPush(quicklist *ql, unsigned char *value, unsigned int sz, int where) {
+    quicklistNode *node = (where == QUICKLIST_HEAD) ? ql->head : ql->tail;
+
+    if (!quicklistNodeAllowInsert(ql,node,sz)) {
+        node = quicklistCreateNode(ziplistNew());
+        quicklistLinkNode(ql,node,where);
+    }
+    node->zl = ziplistPush(node->zl,value,sz,
+        (where == QUICKLIST_HEAD) ? ZIPLIST_HEAD : ZIPLIST_TAIL);
+    node->sz = ziplistBlobLen(node->zl);
+    node->count++;
+    ql->count++;
+}
+
+//将整个ziplist作为一个节点添加到尾部
+void quicklistAppendZiplist(quicklist *ql, unsigned char *zl) {
+    if (ziplistLen(zl) == 0) {
+        zfree(zl);
+        return;
+    }
+    quicklistLinkNode(ql,quicklistCreateNode(zl),QUICKLIST_TAIL);
+}
+
+//读取entry->zi指向的元素的值
+static void quicklistFillEntry(quicklistEntry *entry) {
+    entry->value = NULL;
+    entry->sz = 0;
+    entry->longval = 0;
+    ziplistGet(entry->zi,&entry->value,&entry->sz,&entry->longval);
+}
+
+/* Find the element at 'index'. Whole nodes are skipped using their element
+ * count, starting from the end of the list closer to the element, then the
+ * ziplist of the node is walked from its closer end as well. */
+//获取index位置的元素
+int quicklistIndex(quicklist *ql, long index, quicklistEntry *entry) {
+    quicklistNode *n;
+    unsigned long idx, accum = 0;
+    int forward = index >= 0;
+
+    idx = forward ? (unsigned long)index : (unsigned long)(-(index+1));
+    if (idx >= ql->count) return 0;
+    if (idx > (ql->count-1)/2) {
+        forward = !forward;
+        idx = ql->count-1-idx;
+    }
+    n = forward ? ql->head : ql->tail;
+    while (accum+n->count <= idx) {
+        accum += n->count;
+        n = forward ? n->next : n->prev;
+    }
+
+    /* Position of the element in the node, counting from the head */
+    idx -= accum;
+    if (!forward) idx = n->count-1-idx;
+    entry->ql = ql;
+    entry->node = n;
+    entry->offset = (idx <= (n->count-1)/2) ? (long)idx :
+                                              (long)idx-(long)n->count;
+    entry->zi = ziplistIndex(n->zl,entry->offset);
+    quicklistFillEntry(entry);
+    return 1;
+}
+
+/* Delete the element at '*p' in 'node'. '*p' is updated to the following
+ * element of the ziplist. Returns 1 if the node was removed as it was left
+ * empty. */
+//删除节点中*p指向的元素，节点为空时删除节点并返回1
+static int quicklistDelNodeEntry(quicklist *ql, quicklistNode *node, unsigned char **p) {
+    node->zl = ziplistDelete(node->zl,p);
+    node->count--;
+    ql->count--;
+    if (node->count == 0) {
+        quicklistDelNode(ql,node);
+        return 1;
+    }
+    node->sz = ziplistBlobLen(node->zl);
+    return 0;
+}
+
+//删除quicklistIndex()获取的元素
+void quicklistDelIndex(quicklist *ql, quicklistEntry *entry) {
+    quicklistDelNodeEntry(ql,entry->node,&entry->zi);
+}
+
+/* Replace the element of 'entry' with 'value'. The entry can't be used
+ * anymore after this call. */
+//用value替换entry的元素
+void quicklistReplaceEntry(quicklist *ql, quicklistEntry *entry, unsigned char *value, unsigned int sz) {
+    quicklistNode *node = entry->node;
+    unsigned char *p = entry->zi;
+
+    ((void) ql);
+    node->zl = ziplistDelete(node->zl,&p);
+    node->zl = ziplistInsert(node->zl,p,value,sz);
+    node->sz = ziplistBlobLen(node->zl);
+}
+
+/* Delete 'count' elements starting at 'start'. Nodes entirely inside the
+ * range are released without touching their ziplist. */
+//从start开始删除count个元素
+unsigned long quicklistDelRange(quicklist *ql, long start, unsigned long count) {
+    quicklistEntry entry;
+    quicklistNode *node;
+    unsigned long extent, deleted;
+    long offset;
+
+    if (count == 0 || !quicklistIndex(ql,start,&entry)) return 0;
+    extent = (start >= 0) ? ql->count-start : (unsigned long)(-start);
+    if (extent > count) extent = count;
+    deleted = extent;
+
+    node = entry.node;
+    offset = entry.offset;
+    while (extent) {
+        quicklistNode *next = node->next;
+        unsigned long del;
+
+        if (offset < 0) offset += node->count;
+        del = node->count-offset;
+        if (del > extent) del = extent;
+        if (del == node->count) {
+            quicklistDelNode(ql,node);
+        } else {
+            node->zl = ziplistDeleteRange(node->zl,offset,del);
+            node->sz = ziplistBlobLen(node->zl);
+            node->count -= del;
+            ql->count -= del;
+        }
+        extent -= del;
+        node = next;
+        offset = 0;
+    }
+    return deleted;
+}
+
+/* Move whole nodes from the head (or the tail) of 'ql' to the tail of 'dst'
+ * as long as the total number of moved elements is not greater than 'max'.
+ * Returns the number of elements moved. */
+//从头部或者尾部移动完整的节点到dst
+unsigned long quicklistMoveNodes(quicklist *ql, quicklist *dst, int where, unsigned long max) {
+    quicklistNode *node;
+    unsigned long moved = 0;
+
+    while ((node = (where == QUICKLIST_HEAD) ? ql->head : ql->tail) &&
+           moved+node->count <= max)
+    {
+        quicklistUnlinkNode(ql,node);
+        quicklistLinkNode(dst,node,QUICKLIST_TAIL);
+        moved += node->count;
+    }
+    return moved;
+}
+
+/* Initialize 'iter' to start at 'index' and move towards the tail if
+ * 'direction' is QUICKLIST_TAIL, towards the head otherwise. The offset is
+ * positive going forward and negative going backward: this way when the
+ * current element is deleted the next one to visit has the same offset. */
+//初始化迭代器
+int quicklistInitIterator(quicklistIter *iter, quicklist *ql, long index, int direction) {
+    quicklistEntry entry;
+
+    iter->ql = ql;
+    iter->current = NULL;
+    iter->zi = NULL;
+    iter->offset = 0;
+    iter->direction = direction;
+    if (!quicklistIndex(ql,index,&entry)) return 0;
+    iter->current = entry.node;
+    iter->offset = entry.offset;
+    if (direction == QUICKLIST_TAIL && iter->offset < 0)
+        iter->offset += entry.node->count;
+    else if (direction == QUICKLIST_HEAD && iter->offset >= 0)
+        iter->offset -= entry.node->count;
+    return 1;
+}
+
+//获取迭代器的下一个元素
+int quicklistNext(quicklistIter *iter, quicklistEntry *entry) {
+    int forward = iter->direction == QUICKLIST_TAIL;
+
+    while (iter->current) {
+        unsigned char *zl = iter->current->zl;
+
+        if (iter->zi == NULL) {
+            iter->zi = ziplistIndex(zl,iter->offset);
+        } else {
+            iter->zi = forward ? ziplistNext(zl,iter->zi) :
+                                 ziplistPrev(zl,iter->zi);
+            iter->offset += forward ? 1 : -1;
+        }
+        if (iter->zi) {
+            entry->ql = iter->ql;
+            entry->node = iter->current;
+            entry->zi = iter->zi;
+            entry->offset = iter->offset;
+            quicklistFillEntry(entry);
+            return 1;
+        }
+        /* Done with this node, go on with the next one */
+        iter->current = forward ? iter->current->next : iter->current->prev;
+        iter->offset = forward ? 0 : -1;
+    }
+    return 0;
+}
+
+//删除迭代器刚返回的元素
+void quicklistDelEntry(quicklistIter *iter, quicklistEntry *entry) {
+    quicklistNode *prev = entry->node->prev, *next = entry->node->next;
+    int forward = iter->direction == QUICKLIST_TAIL;
+
+    if (quicklistDelNodeEntry(iter->ql,entry->node,&entry->zi)) {
+        iter->current = forward ? next : prev;
+        iter->offset = forward ? 0 : -1;
+    }
+    /* Otherwise the next element has the offset of the deleted one, it is
+     * looked up again as the ziplist may have been reallocated */
+    iter->zi = NULL;
+}
@@ -0,0 +1,139 @@
+/*
+ * quicklist.h与quicklist.c实现的是一个由ziplist组成的双向链表：
+ * 每个节点是一个保存了多个元素的ziplist，用于保存元素较多的list
+ */
+
+#ifndef __QUICKLIST_H__
+#define __QUICKLIST_H__
+
+#define QUICKLIST_HEAD 0
+#define QUICKLIST_TAIL 1
+
+/*
+ * 节点保存的ziplist超过该字节数时不再添加元素(至少保存一个元素)
+ */
+#define QUICKLIST_NODE_MAX_BYTES 8192
+
+/*
+ * quicklist的节点
+ * zl是保存元素的ziplist
+ * sz是ziplist占用的字节数
+ * count是ziplist中的元素个数
+ */
+typedef struct quicklistNode {
+    struct quicklistNode *prev;
+    struct quicklistNode *next;
+    unsigned char *zl;
+    unsigned int sz;
+    unsigned int count;
+} quicklistNode;
+
+/*
+ * count是所有节点中的元素个数
+ * len是节点个数
+ * fill是每个节点最多保存的元素个数
+ */
+typedef struct quicklist {
+    quicklistNode *head;
+    quicklistNode *tail;
+    unsigned long count;
+    unsigned long len;
+    unsigned int fill;
+} quicklist;
+
+/*
+ * 迭代器
+ * current是当前节点，zi是当前元素(NULL表示需要根据offset重新定位)
+ * offset是当前元素在节点中的位置，向尾部迭代时为正数，向头部迭代时为负数
+ * direction为QUICKLIST_TAIL时向尾部迭代，为QUICKLIST_HEAD时向头部迭代
+ */
+typedef struct quicklistIter {
+    quicklist *ql;
+    quicklistNode *current;
+    unsigned char *zi;
+    long offset;
+    int direction;
+} quicklistIter;
+
+/*
+ * 元素的位置与值
+ * 字符串保存在value/sz中，整数保存在longval中(value为NULL)
+ */
+typedef struct quicklistEntry {
+    quicklist *ql;
+    quicklistNode *node;
+    unsigned char *zi;
+    unsigned char *value;
+    long long longval;
+    unsigned int sz;
+    long offset;
+} quicklistEntry;
+
+/*
+ * 获取quicklist中的元素个数/节点个数
+ */
+#define quicklistCount(ql) ((ql)->count)
+#define quicklistNodeCount(ql) ((ql)->len)
+
+/*
+ * 创建一个空的quicklist，每个节点最多保存fill个元素
+ */
+quicklist *quicklistCreate(unsigned int fill);
+
+/*
+ * 释放quicklist
+ */
+void quicklistRelease(quicklist *ql);
+
+/*
+ * 在头部(QUICKLIST_HEAD)或者尾部(QUICKLIST_TAIL)添加一个元素
+ */
+void quicklistPush(quicklist *ql, unsigned char *value, unsigned int sz, int where);
+
+/*
+ * 将整个ziplist作为一个节点添加到尾部，ziplist归quicklist所有
+ */
+void quicklistAppendZiplist(quicklist *ql, unsigned char *zl);
+
+/*
+ * 获取index位置的元素，负数表示从尾部开始，越界时返回0
+ */
+int quicklistIndex(quicklist *ql, long index, quicklistEntry *entry);
+
+/*
+ * 删除quicklistIndex()获取的元素
+ */
+void quicklistDelIndex(quicklist *ql, quicklistEntry *entry);
+
+/*
+ * 用value替换entry的元素
+ */
+void quicklistReplaceEntry(quicklist *ql, quicklistEntry *entry, unsigned char *value, unsigned int sz);
+
+/*
+ * 从start开始删除count个元素，返回删除的元素个数
+ */
+unsigned long quicklistDelRange(quicklist *ql, long start, unsigned long count);
+
+/*
+ * 从头部或者尾部把不超过max个元素的完整节点移动到dst的尾部，
+ * 返回移动的元素个数
+ */
+unsigned long quicklistMoveNodes(quicklist *ql, quicklist *dst, int where, unsigned long max);
+
+/*
+ * 初始化从index开始的迭代器，index越界时返回0
+ */
+int quicklistInitIterator(quicklistIter *iter, quicklist *ql, long index, int direction);
+
+/*
+ * 获取迭代器的下一个元素，没有时返回0
+ */
+int quicklistNext(quicklistIter *iter, quicklistEntry *entry);
+
+/*
+ * 删除迭代器刚返回的元素，迭代器仍然可用
+ */
+void quicklistDelEntry(quicklistIter *iter, quicklistEntry *entry);
+
+#endif /* __QUICKLIST_H__ */
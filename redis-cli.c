@@ -64,29 +64,61 @@ static struct redisCommand cmdTable[] = {
     {"exists",2,REDIS_CMD_INLINE},
     {"incr",2,REDIS_CMD_INLINE},
     {"decr",2,REDIS_CMD_INLINE},
-    {"rpush",3,REDIS_CMD_BULK},
-    {"lpush",3,REDIS_CMD_BULK},
+    {"rpush",-3,REDIS_CMD_BULK},
+    {"lpush",-3,REDIS_CMD_BULK},
     {"rpop",2,REDIS_CMD_INLINE},
     {"lpop",2,REDIS_CMD_INLINE},
+    {"blpop",-3,REDIS_CMD_INLINE},
+    {"brpop",-3,REDIS_CMD_INLINE},
     {"llen",2,REDIS_CMD_INLINE},
     {"lindex",3,REDIS_CMD_INLINE},
     {"lset",4,REDIS_CMD_BULK},
     {"lrange",4,REDIS_CMD_INLINE},
     {"ltrim",4,REDIS_CMD_INLINE},
     {"lrem",4,REDIS_CMD_BULK},
-    {"sadd",3,REDIS_CMD_BULK},
-    {"srem",3,REDIS_CMD_BULK},
+    {"sadd",-3,REDIS_CMD_BULK},
+    {"srem",-3,REDIS_CMD_BULK},
     {"smove",4,REDIS_CMD_BULK},
     {"sismember",3,REDIS_CMD_BULK},
     {"scard",2,REDIS_CMD_INLINE},
-    {"spop",2,REDIS_CMD_INLINE},
+    {"spop",-2,REDIS_CMD_INLINE},
+    {"srandmember",-2,REDIS_CMD_INLINE},
     {"sinter",-2,REDIS_CMD_INLINE},
     {"sinterstore",-3,REDIS_CMD_INLINE},
+    {"sintercard",-3,REDIS_CMD_INLINE},
     {"sunion",-2,REDIS_CMD_INLINE},
     {"sunionstore",-3,REDIS_CMD_INLINE},
     {"sdiff",-2,REDIS_CMD_INLINE},
     {"sdiffstore",-3,REDIS_CMD_INLINE},
     {"smembers",2,REDIS_CMD_INLINE},
+    {"zadd",-4,REDIS_CMD_BULK},
+    {"zincrby",4,REDIS_CMD_BULK},
+    {"zrem",-3,REDIS_CMD_BULK},
+    {"zrange",-4,REDIS_CMD_INLINE},
+    {"zrevrange",-4,REDIS_CMD_INLINE},
+    {"zrangebyscore",-4,REDIS_CMD_INLINE},
+    {"zrevrangebyscore",-4,REDIS_CMD_INLINE},
+    {"zcount",4,REDIS_CMD_INLINE},
+    {"zcard",2,REDIS_CMD_INLINE},
+    {"zscore",3,REDIS_CMD_BULK},
+    {"zrank",3,REDIS_CMD_BULK},
+    {"zrevrank",3,REDIS_CMD_BULK},
+    {"zremrangebyscore",4,REDIS_CMD_INLINE},
+    {"zremrangebyrank",4,REDIS_CMD_INLINE},
+    {"hset",-4,REDIS_CMD_BULK},
+    {"hget",3,REDIS_CMD_BULK},
+    {"hmget",-3,REDIS_CMD_INLINE},
+    {"hincrby",4,REDIS_CMD_INLINE},
+    {"hdel",-3,REDIS_CMD_BULK},
+    {"hlen",2,REDIS_CMD_INLINE},
+    {"hgetall",2,REDIS_CMD_INLINE},
+    {"setbit",4,REDIS_CMD_BULK},
+    {"getbit",3,REDIS_CMD_INLINE},
+    {"bitcount",-2,REDIS_CMD_INLINE},
+    {"bitop",-4,REDIS_CMD_INLINE},
+    {"pfadd",-2,REDIS_CMD_BULK},
+    {"pfcount",-2,REDIS_CMD_INLINE},
+    {"pfmerge",-2,REDIS_CMD_INLINE},
     {"incrby",3,REDIS_CMD_INLINE},
     {"decrby",3,REDIS_CMD_INLINE},
     {"getset",3,REDIS_CMD_BULK},
@@ -104,8 +136,8 @@ static struct redisCommand cmdTable[] = {
     {"shutdown",1,REDIS_CMD_INLINE},
     {"lastsave",1,REDIS_CMD_INLINE},
     {"type",2,REDIS_CMD_INLINE},
-    {"flushdb",1,REDIS_CMD_INLINE},
-    {"flushall",1,REDIS_CMD_INLINE},
+    {"flushdb",-1,REDIS_CMD_INLINE},
+    {"flushall",-1,REDIS_CMD_INLINE},
     {"sort",-2,REDIS_CMD_INLINE},
     {"info",1,REDIS_CMD_INLINE},
     {"mget",-2,REDIS_CMD_INLINE},
@@ -28,6 +28,8 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "redis.h"
 #include "ae.h"     /* Event driven programming library */
@@ -38,6 +40,11 @@
 #include "zmalloc.h" /* total memory usage aware version of malloc/free */
 #include "lzf.h"    /* LZF compression library */
 #include "pqsort.h" /* Partial qsort for SORT+LIMIT */
+#include "ziplist.h" /* Compact list encoding */
+#include "quicklist.h" /* Linked list of ziplists */
+#include "intset.h" /* Compact integer set encoding */
+#include "bitmap.h" /* Bit counting and bitwise operations */
+#include "hyperloglog.h" /* Approximated cardinality of sets */
 
 /* Error codes */
 #define REDIS_OK                0
@@ -51,11 +58,29 @@
 #define REDIS_STATIC_ARGS       4
 #define REDIS_DEFAULT_DBNUM     16
 #define REDIS_CONFIGLINE_MAX    1024
-#define REDIS_OBJFREELIST_MAX   1000000 /* Max number of objects to cache */
+#define REDIS_OBJFREELIST_MAX   100000  /* Max number of objects to cache */
+#define REDIS_SHARED_INTEGERS   10000   /* Shared objects for 0..9999 */
+#define REDIS_LAZYFREE_THRESHOLD 64     /* Free bigger values in background */
+#define REDIS_COMPRESS_THRESHOLD 1024   /* Compress bigger string values */
+#define REDIS_LIST_MAX_ZIPLIST_ENTRIES 128 /* Bigger lists are linked lists */
+#define REDIS_LIST_MAX_ZIPLIST_VALUE 64    /* Same for longer elements */
+#define REDIS_SET_MAX_INTSET_ENTRIES 512   /* Bigger sets are hash tables */
+#define REDIS_HASH_MAX_ZIPLIST_ENTRIES 64  /* Bigger hashes are hash tables */
+#define REDIS_HASH_MAX_ZIPLIST_VALUE 64    /* Same for longer fields/values */
+#define REDIS_HLL_SPARSE_MAX_BYTES 3000    /* Bigger HyperLogLogs are dense */
+#define REDIS_SETRANDOM_COPY_MUL 3 /* SRANDMEMBER/SPOP count*3 > size: copy */
+#define REDIS_SETRANDOM_MAX_REPEAT (1024*1024) /* Max SRANDMEMBER -count */
+#define ZSKIPLIST_MAXLEVEL 32   /* Should be enough for 2^32 elements */
+#define ZSKIPLIST_P 0.25        /* Skiplist P = 1/4 */
 #define REDIS_MAX_SYNC_TIME     60      /* Slave can't take more to sync */
 #define REDIS_EXPIRELOOKUPS_PER_CRON    100 /* try to expire 100 keys/second */
+#define REDIS_MEMSAMPLES_PER_CRON 20    /* keys sampled per DB per second */
+#define REDIS_MEMSAMPLE_ELEMENTS 5      /* elements sampled per aggregate */
+#define REDIS_MEMSAMPLE_WINDOW 10000    /* halve the samples after that */
 #define REDIS_MAX_WRITE_PER_EVENT (1024*64)
 #define REDIS_REQUEST_MAX_SIZE  (1024*1024*256) /* max bytes in inline command */
+#define REDIS_MULTIBULK_MAX_ARGS (1024*1024) /* max args of multi bulk commands */
+#define REDIS_BULK_MAX_SIZE (1024*1024*1024) /* max length of a bulk argument */
 
 /* Hash table parameters */
 #define REDIS_HT_MINFILL        10      /* Minimal hash table fill 10% */
@@ -74,8 +99,36 @@
 #define REDIS_LIST 1
 #define REDIS_SET 2
 #define REDIS_HASH 3
+#define REDIS_ZSET 4
+#define REDIS_NUM_TYPES 5       /* Number of object types above */
+
+/* Objects encoding. A string object can be stored as a plain sds string
+ * or, when it is the decimal representation of a long, directly as a long
+ * inside the 'ptr' field of the object. Big string values can be stored
+ * LZF compressed, see tryObjectCompression(). Small lists are stored as
+ * a ziplist, bigger ones as a quicklist, a linked list of ziplists. */
+#define REDIS_ENCODING_RAW 0    /* Raw representation */
+#define REDIS_ENCODING_INT 1    /* Encoded as integer */
+#define REDIS_ENCODING_EMBSTR 2 /* sds allocated together with the object */
+#define REDIS_ENCODING_LZF 3    /* LZF compressed, ptr is a redisLzfString */
+#define REDIS_ENCODING_QUICKLIST 4  /* List encoded as a quicklist.c list */
+#define REDIS_ENCODING_ZIPLIST 5    /* List or hash encoded as a ziplist */
+#define REDIS_ENCODING_HT 6         /* Set or hash encoded as a hash table */
+#define REDIS_ENCODING_INTSET 7     /* Set encoded as an intset.c intset */
+#define REDIS_ENCODING_SKIPLIST 8   /* Sorted set, skiplist plus hash table */
+
+/* Strings up to this length are created as REDIS_ENCODING_EMBSTR objects:
+ * the robj, the sds header and the string share a single allocation.
+ * With a 16 bytes robj and a 3 bytes sdshdr8 the limit of 44 bytes makes
+ * the whole thing fit a 64 bytes allocator size class. */
+#define REDIS_ENCODING_EMBSTR_SIZE_LIMIT 44
+
+/* True if o->ptr is an sds string (raw or embedded) */
+#define sdsEncodedObject(o) ((o)->encoding == REDIS_ENCODING_RAW || \
+                             (o)->encoding == REDIS_ENCODING_EMBSTR)
 
 /* Object types only used for dumping to disk */
+#define REDIS_RESIZEDB 252
 #define REDIS_EXPIRETIME 253
 #define REDIS_SELECTDB 254
 #define REDIS_EOF 255
@@ -107,11 +160,24 @@
 #define REDIS_RDB_ENC_INT32 2       /* 32 bit signed integer */
 #define REDIS_RDB_ENC_LZF 3         /* string compressed with FASTLZ */
 
+/* Request types: commands are sent either as a line of space separated
+ * arguments (the last one optionally sent as bulk data, see REDIS_CMD_BULK)
+ * or in the binary safe multi bulk format:
+ *
+ *   *<number of arguments>\r\n
+ *   $<length of argument 1>\r\n<argument 1>\r\n
+ *   ...
+ */
+#define REDIS_REQ_INLINE 0
+#define REDIS_REQ_MULTIBULK 1
+
 /* Client flags */
 #define REDIS_CLOSE 1       /* This client connection should be closed ASAP */
 #define REDIS_SLAVE 2       /* This client is a slave server */
 #define REDIS_MASTER 4      /* This client is a master server */
 #define REDIS_MONITOR 8      /* This client is a slave monitor, see MONITOR */
+#define REDIS_BLOCKED 16    /* The client is waiting in BLPOP/BRPOP */
+#define REDIS_UNBLOCKED 32  /* Unblocked, in server.unblocked_clients */
 
 /* Slave replication state - slave side */
 #define REDIS_REPL_NONE 0   /* No active replication */
@@ -140,6 +206,9 @@
 #define REDIS_SORT_DESC 5
 #define REDIS_SORTKEY_MAX 1024
 
+/* Size of a buffer able to hold any long formatted as a decimal string */
+#define REDIS_LONGSTR_SIZE 32
+
 /* Log levels */
 #define REDIS_DEBUG 0
 #define REDIS_NOTICE 1
@@ -155,15 +224,28 @@
 //redis对象，这是一种能够容纳字符串/列表/集合的类型
 typedef struct redisObject {
     void *ptr;
-    int type;
+    unsigned char type;
+    unsigned char encoding; //编码方式，见REDIS_ENCODING_*
+    unsigned char notused[2];
     int refcount;
 } robj;
 
+/* The ptr field of REDIS_ENCODING_LZF objects points to this structure */
+typedef struct redisLzfString {
+    uint32_t len;           /* length of the uncompressed string */
+    uint32_t clen;          /* length of the compressed data */
+    unsigned char data[];
+} redisLzfString;
+
 //结构体是用来表示一个数据库实例的。Redis支持多个数据库。
 typedef struct redisDb {
     dict *dict;//存储数据库中的所有键值对。
     dict *expires;//存储设置了过期时间的键
     int id;
+    dict *blockingkeys; //key -> 等待该key的客户端链表(BLPOP/BRPOP)
+    /* Memory usage sampling, see sampleDbMemory() */
+    unsigned long long memsamplebytes[REDIS_NUM_TYPES]; //采样到的每种类型的字节数
+    unsigned long memsamplekeys;    //采样的key的数量
 } redisDb;
 
 /* With multiplexing we need to take per-clinet state.
@@ -184,6 +266,10 @@ typedef struct redisClient {
     //如果客户端正在执行批量读取操作（如 GET 命令读取大量数据），
     //这个字段会存储需要读取的数据长度。如果不是批量读取模式，则这个值为 -1
     int bulklen;            /* bulk read len. -1 if not in bulk read mode */
+    //请求的格式，REDIS_REQ_INLINE或者REDIS_REQ_MULTIBULK
+    int reqtype;            /* format of the command being read */
+    //multi bulk格式的命令还需要读取的参数个数
+    int multibulklen;       /* multi bulk arguments left to read */
     //指向回复队列的指针。Redis 会将命令的回复添加到这个队列中，然后通过套接字发送给客户端。
     list *reply;
     //已经发送给客户端的回复字节数。这个值用于跟踪回复的发送进度，特别是在处理大回复时。
@@ -205,6 +291,13 @@ typedef struct redisClient {
     long repldboff;          /* replication DB file offset */
     //复制数据库文件的大小。这个值用于在从服务器启动复制过程时，确定需要下载多少数据。
     off_t repldbsize;       /* replication DB file size */
+    //正在执行的命令，命令可以把自己改写为复制给从服务器的等价命令
+    struct redisCommand *cmd; /* command being executed, see processCommand() */
+    //BLPOP/BRPOP阻塞时等待的key、弹出的方向以及超时定时器的id
+    robj **blockingkeys;    /* keys the client is waiting for */
+    int blockingkeysnum;    /* number of blockingkeys */
+    int blockingwhere;      /* REDIS_HEAD for BLPOP, REDIS_TAIL for BRPOP */
+    long long blocktimer;   /* timeout time event id, -1 if none */
 } redisClient;
 
 struct saveparam {
@@ -224,20 +317,28 @@ struct redisServer {
     dict *sharingpool;
     //对象共享池大小
     unsigned int sharingpoolsize;
+    //预先创建的共享整数对象的数量(0..sharedintegers-1)
+    long sharedintegers;
     //自上次保存数据库以来，数据库被修改的次数
     long long dirty;            /* changes to DB from the last save */
     //一个列表，包含了所有连接到服务器的客户端的 redisClient 结构体指针。
     list *clients;
     //分别包含从服务器（slave）和监视器（monitor）的列表。
     list *slaves, *monitors;
+    //被push唤醒的客户端，在beforeSleep()中处理它们输入缓冲区中的命令
+    list *unblocked_clients;
+    unsigned int blockedclients;    /* clients blocked in BLPOP/BRPOP */
     //用于存储网络错误的缓冲区。
     char neterr[ANET_ERR_LEN];
     //指向 Redis 事件循环的指针，
     aeEventLoop *el;
     //cron 函数（Redis 的定时任务处理函数）运行的次数。
     int cronloops;              /* number of times the cron function run */
-    //一个列表，用于存储已经释放但可能再次使用的对象，以减少内存分配的开销。
-    list *objfreelist;          /* A list of freed objects to avoid malloc() */
+    //已经释放但可能再次使用的对象，通过对象的ptr字段串成单链表，以减少内存分配的开销。
+    robj *objfreelist;          /* Freed objects to avoid malloc(), linked
+                                   using the ptr field of the objects */
+    unsigned long objfreelistlen;   /* Number of objects in objfreelist */
+    unsigned long objfreelistmin;   /* Min objfreelistlen since last trim */
     //后一次成功保存数据库的时间戳。
     time_t lastsave;            /* Unix time of last save succeeede */
     //Redis 服务器当前使用的内存量
@@ -246,6 +347,22 @@ struct redisServer {
     time_t stat_starttime;         /* server start time 服务器启动的时间戳。*/
     long long stat_numcommands;    /* number of processed commands 服务器处理过的命令总数*/
     long long stat_numconnections; /* number of connections received 服务器接收到的连接总数*/
+    long long stat_objfreelist_hits;    /* objects reused from objfreelist */
+    long long stat_objfreelist_misses;  /* objects allocated with zmalloc() */
+    long long stat_objfreelist_trimmed; /* cached objects freed by serverCron */
+    /* Lazy free: big values are released by a background thread. The jobs
+     * list and the two counters are protected by lazyfree_mutex. */
+    list *lazyfree_jobs;                /* values and dicts waiting to be freed */
+    unsigned long lazyfree_pending;     /* jobs queued or being freed */
+    long long stat_lazyfreed_objects;   /* jobs completed by the thread */
+    long long stat_lzf_compressed;      /* values stored compressed */
+    long long stat_lzf_uncompressible;  /* values not compressed enough */
+    long long stat_lzf_rawbytes;        /* input bytes of stat_lzf_compressed */
+    long long stat_lzf_compressedbytes; /* output bytes of stat_lzf_compressed */
+    long long stat_lzf_decompressions;  /* values inflated for replies etc */
+    pthread_t lazyfree_thread;
+    pthread_mutex_t lazyfree_mutex;
+    pthread_cond_t lazyfree_cond;
     /* Configuration */
     int verbosity;//日志级别
     int glueoutputbuf;//是否将输出合并 使用粘包
@@ -262,6 +379,15 @@ struct redisServer {
     char *dbfilename;//数据库文件名
     char *requirepass;//密码
     int shareobjects;//是否共享对象
+    unsigned long objfreelistmax;//objfreelist中最多缓存的对象数量
+    unsigned long lazyfreethreshold;//元素个数超过该值的对象在后台线程中释放，0表示不启用
+    size_t compressthreshold;//长度超过该值的字符串值使用LZF压缩保存，0表示不压缩
+    unsigned int listmaxziplistentries;//元素个数不超过该值的list使用ziplist编码
+    size_t listmaxziplistvalue;//元素长度都不超过该值的list使用ziplist编码
+    unsigned int setmaxintsetentries;//元素都是整数且个数不超过该值的set使用intset编码
+    unsigned int hashmaxziplistentries;//field个数不超过该值的hash使用ziplist编码
+    size_t hashmaxziplistvalue;//field和value长度都不超过该值的hash使用ziplist编码
+    size_t hllsparsemaxbytes;//稀疏编码的HyperLogLog的最大字节数，超过后转为稠密编码
     /* Replication related */
     int isslave;//指示当前服务器是否是一个从服务器。
     char *masterhost;//主服务器的地址
@@ -305,6 +431,71 @@ typedef struct _redisSortOperation {
     int type;
     robj *pattern;
 } redisSortOperation;
+
+/* List iterator, see the listType*() functions */
+typedef struct listTypeIterator {
+    robj *subject;
+    unsigned char encoding;
+    unsigned char direction; /* REDIS_TAIL goes head to tail, REDIS_HEAD back */
+    unsigned char *zi;
+    quicklistIter iter;
+} listTypeIterator;
+
+/* The element the iterator was on when listTypeNext() was called. For both
+ * the encodings 'zi' points to the element inside a ziplist. */
+typedef struct listTypeEntry {
+    listTypeIterator *li;
+    unsigned char *zi;
+    quicklistEntry entry;
+} listTypeEntry;
+
+/* Set iterator, see the setType*() functions */
+typedef struct setTypeIterator {
+    robj *subject;
+    unsigned char encoding;
+    uint32_t ii; /* Next position of an intset */
+    dictIterator *di;
+} setTypeIterator;
+
+/* Hash iterator, see the hashType*() functions. For ziplists 'fptr' and
+ * 'vptr' point to the current field and value. */
+typedef struct hashTypeIterator {
+    robj *subject;
+    unsigned char encoding;
+    unsigned char *fptr, *vptr;
+    dictIterator *di;
+    dictEntry *de;
+} hashTypeIterator;
+
+/* Sorted sets are a skiplist ordered by (score, member), used for ranges
+ * and ranks, plus a hash table mapping every member to its skiplist node,
+ * used to find the current score of a member. See the ZSets section. */
+typedef struct zskiplistNode {
+    robj *obj;
+    double score;
+    struct zskiplistNode *backward;
+    struct zskiplistLevel {
+        struct zskiplistNode *forward;
+        unsigned long span; /* Number of nodes skipped following 'forward' */
+    } level[];
+} zskiplistNode;
+
+typedef struct zskiplist {
+    struct zskiplistNode *header, *tail;
+    unsigned long length;
+    int level;
+} zskiplist;
+
+typedef struct zset {
+    dict *dict;
+    zskiplist *zsl;
+} zset;
+
+/* Score range of ZRANGEBYSCORE and friends, '(' makes a bound exclusive */
+typedef struct zrangespec {
+    double min, max;
+    int minex, maxex;
+} zrangespec;
 //920行初始化
 struct sharedObjectsStruct {
     //crlf 指向一个包含换行符（CRLF，即 \r\n）的字符串对象
@@ -316,9 +507,11 @@ struct sharedObjectsStruct {
     robj *crlf, *ok, *err, *emptybulk, *czero, *cone, *pong, *space,
     *colon, *nullbulk, *nullmultibulk,
     *emptymultibulk, *wrongtypeerr, *nokeyerr, *syntaxerr, *sameobjecterr,
-    *outofrangeerr, *plus,
+    *outofrangeerr, *invalidhllerr, *corrupthllerr, *plus,
     *select0, *select1, *select2, *select3, *select4,
     *select5, *select6, *select7, *select8, *select9;
+    //整数0..server.sharedintegers-1的共享对象
+    robj **integers;
 } shared;
 
 /*================================ Prototypes =============================== */
@@ -328,20 +521,71 @@ static void freeStringObject(robj *o);
 static void freeListObject(robj *o);
 //释放哈希表
 static void freeSetObject(robj *o);
-//引用计数-1,根据类型type释放ptr，将o添加到一个名为server.objfreelist的列表
-//如果超过REDIS_OBJFREELIST_MAX或者添加失败则会释放o
+//引用计数-1,根据类型type释放ptr，将o添加到server.objfreelist
+//如果超过server.objfreelistmax则会释放o
 static void decrRefCount(void *o);
+static unsigned long trimObjFreelist(unsigned long count);
+static void lazyfreeInit(void);
+static void lazyfreeObject(robj *o);
+static void lazyfreeDict(dict *d);
+static void lazyfreeReleaseDict(dict *d);
+static unsigned long lazyfreePendingJobs(long long *freed);
+static void lazyfreeDecrRefCount(void *obj);
 //创建一个robj*对象
 static robj *createObject(int type, void *ptr);
 //释放客户端结构体
 static void freeClient(redisClient *c);
+static void unblockClient(redisClient *c);
+static void processInputBuffer(redisClient *c);
+static int processMultibulkBuffer(redisClient *c);
+static void beforeSleep(struct aeEventLoop *eventLoop);
+static int handleClientsWaitingListPush(redisClient *c, robj *key, robj *ele);
 static int rdbLoad(char *filename);
 static void addReply(redisClient *c, robj *obj);
 static void addReplySds(redisClient *c, sds s);
 static void incrRefCount(robj *o);
 static int rdbSaveBackground(char *filename);
 static robj *createStringObject(char *ptr, size_t len);
-static void replicationFeedSlaves(list *slaves, struct redisCommand *cmd, int dictid, robj **argv, int argc);
+static robj *createStringObjectFromLongLong(long long value);
+static robj *createEmbeddedStringObject(char *ptr, size_t len);
+static char *strEncoding(int encoding);
+static robj *tryObjectEncoding(robj *o);
+static void tryObjectCompression(robj *o);
+static robj *getDecodedObject(robj *o);
+static char *stringObjectBytes(robj *o, char *buf, size_t *len);
+static size_t stringObjectLen(robj *o);
+static int compareStringObjects(robj *a, robj *b);
+static void addReplyBulkLen(redisClient *c, robj *obj);
+static void addReplyZiplistEntry(redisClient *c, unsigned char *p);
+static robj *ziplistEntryObject(unsigned char *p);
+static void listTypeTryConversion(robj *subject, robj *value);
+static void listTypeConvert(robj *subject, int enc);
+static void listTypePush(robj *subject, robj *value, int where);
+static unsigned long listTypeLength(robj *subject);
+static void listTypeInitIterator(listTypeIterator *li, robj *subject,
+                                 int index, int direction);
+static int listTypeNext(listTypeIterator *li, listTypeEntry *entry);
+static robj *listTypeGet(listTypeEntry *entry);
+static robj *createIntsetObject(void);
+static int setTypeAdd(robj *subject, robj *value);
+static unsigned long setTypeSize(robj *subject);
+static void setTypeInitIterator(setTypeIterator *si, robj *subject);
+static robj *setTypeNext(setTypeIterator *si);
+static void setTypeReleaseIterator(setTypeIterator *si);
+static robj *createZsetObject(void);
+static robj *createHashObject(void);
+static void hashTypeConvert(robj *subject);
+static unsigned long hashTypeLength(robj *o);
+static void hashTypeInitIterator(hashTypeIterator *hi, robj *subject);
+static int hashTypeNext(hashTypeIterator *hi);
+static robj *hashTypeCurrent(hashTypeIterator *hi, int what);
+static void hashTypeReleaseIterator(hashTypeIterator *hi);
+static zskiplist *zslCreate(void);
+static void zslFree(zskiplist *zsl, void (*freeobj)(void *));
+static zskiplistNode *zslInsert(zskiplist *zsl, double score, robj *obj);
+static void addReplyDouble(redisClient *c, double d);
+static void replicationFeedSlaves(list *slaves, int dictid, robj **argv, int argc);
+static void replicationFeedMonitors(list *monitors, struct redisCommand *cmd, int dictid, robj **argv, int argc);
 static int syncWithMaster(void);
 //这段代码实现了一个简单的对象共享池机制，用于在Redis中减少内存使用，特别是针对字符串类型的对象。
 //它通过维护一个字典（server.sharingpool）来跟踪哪些字符串对象已经被共享，并允许后续请求重用这些对象而不是创建新的对象
@@ -350,10 +594,16 @@ static int removeExpire(redisDb *db, robj *key);
 static int expireIfNeeded(redisDb *db, robj *key);
 static int deleteIfVolatile(redisDb *db, robj *key);
 static int deleteKey(redisDb *db, robj *key);
+static int deleteKeyGeneric(redisDb *db, robj *key, int lazy);
+static void dbOverwrite(redisDb *db, robj *key, robj *val);
+static robj *dbUnshareStringValue(redisDb *db, robj *key, robj *o);
 static time_t getExpire(redisDb *db, robj *key);
 static int setExpire(redisDb *db, robj *key, time_t when);
 static void updateSlavesWaitingBgsave(int bgsaveerr);
 static void freeMemoryIfNeeded(void);
+static size_t objectComputeSize(robj *o, int samples);
+static size_t keyComputeSize(robj *key, robj *val, int samples);
+static void sampleDbMemory(redisDb *db, int count);
 static int processCommand(redisClient *c);
 static void setupSigSegvAction(void);
 static void rdbRemoveTempFile(pid_t childpid);
@@ -385,6 +635,8 @@ static void lpushCommand(redisClient *c);
 static void rpushCommand(redisClient *c);
 static void lpopCommand(redisClient *c);
 static void rpopCommand(redisClient *c);
+static void blpopCommand(redisClient *c);
+static void brpopCommand(redisClient *c);
 static void llenCommand(redisClient *c);
 static void lindexCommand(redisClient *c);
 static void lrangeCommand(redisClient *c);
@@ -397,12 +649,42 @@ static void smoveCommand(redisClient *c);
 static void sismemberCommand(redisClient *c);
 static void scardCommand(redisClient *c);
 static void spopCommand(redisClient *c);
+static void srandmemberCommand(redisClient *c);
 static void sinterCommand(redisClient *c);
 static void sinterstoreCommand(redisClient *c);
+static void sintercardCommand(redisClient *c);
 static void sunionCommand(redisClient *c);
 static void sunionstoreCommand(redisClient *c);
 static void sdiffCommand(redisClient *c);
 static void sdiffstoreCommand(redisClient *c);
+static void zaddCommand(redisClient *c);
+static void zincrbyCommand(redisClient *c);
+static void zremCommand(redisClient *c);
+static void zrangeCommand(redisClient *c);
+static void zrevrangeCommand(redisClient *c);
+static void zrangebyscoreCommand(redisClient *c);
+static void zrevrangebyscoreCommand(redisClient *c);
+static void zcountCommand(redisClient *c);
+static void zcardCommand(redisClient *c);
+static void zscoreCommand(redisClient *c);
+static void zrankCommand(redisClient *c);
+static void zrevrankCommand(redisClient *c);
+static void zremrangebyscoreCommand(redisClient *c);
+static void zremrangebyrankCommand(redisClient *c);
+static void hsetCommand(redisClient *c);
+static void hgetCommand(redisClient *c);
+static void hmgetCommand(redisClient *c);
+static void hincrbyCommand(redisClient *c);
+static void hdelCommand(redisClient *c);
+static void hlenCommand(redisClient *c);
+static void hgetallCommand(redisClient *c);
+static void setbitCommand(redisClient *c);
+static void getbitCommand(redisClient *c);
+static void bitcountCommand(redisClient *c);
+static void bitopCommand(redisClient *c);
+static void pfaddCommand(redisClient *c);
+static void pfcountCommand(redisClient *c);
+static void pfmergeCommand(redisClient *c);
 static void syncCommand(redisClient *c);
 static void flushdbCommand(redisClient *c);
 static void flushallCommand(redisClient *c);
@@ -416,6 +698,7 @@ static void getSetCommand(redisClient *c);
 static void ttlCommand(redisClient *c);
 static void slaveofCommand(redisClient *c);
 static void debugCommand(redisClient *c);
+static void memoryCommand(redisClient *c);
 /*================================= Globals ================================= */
 
 /* Global vars */
@@ -440,29 +723,61 @@ static struct redisCommand cmdTable[] = {
     {"incr",incrCommand,2,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//+1
     {"decr",decrCommand,2,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//-1
     {"mget",mgetCommand,-2,REDIS_CMD_INLINE},////获取多个值
-    {"rpush",rpushCommand,3,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//rpush
-    {"lpush",lpushCommand,3,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//lpush
+    {"rpush",rpushCommand,-3,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//rpush
+    {"lpush",lpushCommand,-3,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//lpush
     {"rpop",rpopCommand,2,REDIS_CMD_INLINE},//rpop
     {"lpop",lpopCommand,2,REDIS_CMD_INLINE},//lpop
+    {"blpop",blpopCommand,-3,REDIS_CMD_INLINE},//阻塞的lpop
+    {"brpop",brpopCommand,-3,REDIS_CMD_INLINE},//阻塞的rpop
     {"llen",llenCommand,2,REDIS_CMD_INLINE},////list长度
     {"lindex",lindexCommand,3,REDIS_CMD_INLINE},//获取list第index个
     {"lset",lsetCommand,4,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//列表的指定索引位置设置一个新元素。
     {"lrange",lrangeCommand,4,REDIS_CMD_INLINE},////在list中获取下标left-right的值
     {"ltrim",ltrimCommand,4,REDIS_CMD_INLINE},////用法 ltrim list num1 num2 只保留list num1-num2的内容
     {"lrem",lremCommand,4,REDIS_CMD_BULK},//list去掉 n 个 x
-    {"sadd",saddCommand,3,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},////set中增加一个key
-    {"srem",sremCommand,3,REDIS_CMD_BULK},////删除key
+    {"sadd",saddCommand,-3,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},////set中增加一个key
+    {"srem",sremCommand,-3,REDIS_CMD_BULK},////删除key
     {"smove",smoveCommand,4,REDIS_CMD_BULK},////将set a中元素x移到set b
     {"sismember",sismemberCommand,3,REDIS_CMD_BULK},//查看set a中是不是有元素x
     {"scard",scardCommand,2,REDIS_CMD_INLINE},////求s的大小
-    {"spop",spopCommand,2,REDIS_CMD_INLINE},//SPOP命令用于从集合中随机移除一个元素
+    {"spop",spopCommand,-2,REDIS_CMD_INLINE},//SPOP命令用于从集合中随机移除一个或多个元素
+    {"srandmember",srandmemberCommand,-2,REDIS_CMD_INLINE},//随机返回set中的一个或多个元素
     {"sinter",sinterCommand,-2,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//求多个集合交集
     {"sinterstore",sinterstoreCommand,-3,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//求多个集合交集并存储
+    {"sintercard",sintercardCommand,-3,REDIS_CMD_INLINE},//求多个集合交集的元素个数
     {"sunion",sunionCommand,-2,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//交集
     {"sunionstore",sunionstoreCommand,-3,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//交集存储
     {"sdiff",sdiffCommand,-2,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//差集
     {"sdiffstore",sdiffstoreCommand,-3,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//差集存储
     {"smembers",sinterCommand,2,REDIS_CMD_INLINE},//交集
+    {"zadd",zaddCommand,-4,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//有序集合中增加一个或多个元素
+    {"zincrby",zincrbyCommand,4,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//增加元素的分数
+    {"zrem",zremCommand,-3,REDIS_CMD_BULK},//删除有序集合中的一个或多个元素
+    {"zrange",zrangeCommand,-4,REDIS_CMD_INLINE},//按排名返回元素，分数从小到大
+    {"zrevrange",zrevrangeCommand,-4,REDIS_CMD_INLINE},//按排名返回元素，分数从大到小
+    {"zrangebyscore",zrangebyscoreCommand,-4,REDIS_CMD_INLINE},//返回分数在范围内的元素
+    {"zrevrangebyscore",zrevrangebyscoreCommand,-4,REDIS_CMD_INLINE},//同上，分数从大到小
+    {"zcount",zcountCommand,4,REDIS_CMD_INLINE},//分数在范围内的元素个数
+    {"zcard",zcardCommand,2,REDIS_CMD_INLINE},//有序集合的元素个数
+    {"zscore",zscoreCommand,3,REDIS_CMD_BULK},//返回元素的分数
+    {"zrank",zrankCommand,3,REDIS_CMD_BULK},//返回元素的排名，分数从小到大
+    {"zrevrank",zrevrankCommand,3,REDIS_CMD_BULK},//返回元素的排名，分数从大到小
+    {"zremrangebyscore",zremrangebyscoreCommand,4,REDIS_CMD_INLINE},//删除分数在范围内的元素
+    {"zremrangebyrank",zremrangebyrankCommand,4,REDIS_CMD_INLINE},//删除排名在范围内的元素
+    {"hset",hsetCommand,-4,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//设置hash中一个或多个field的值
+    {"hget",hgetCommand,3,REDIS_CMD_BULK},//获取field的值
+    {"hmget",hmgetCommand,-3,REDIS_CMD_INLINE},//获取多个field的值
+    {"hincrby",hincrbyCommand,4,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//field的值增加n
+    {"hdel",hdelCommand,-3,REDIS_CMD_BULK},//删除一个或多个field
+    {"hlen",hlenCommand,2,REDIS_CMD_INLINE},//hash中field的个数
+    {"hgetall",hgetallCommand,2,REDIS_CMD_INLINE},//返回所有的field和value
+    {"setbit",setbitCommand,4,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//设置位图中的一位，返回原来的值
+    {"getbit",getbitCommand,3,REDIS_CMD_INLINE},//返回位图中的一位
+    {"bitcount",bitcountCommand,-2,REDIS_CMD_INLINE},//统计置1的位数
+    {"bitop",bitopCommand,-4,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//多个位图之间的AND/OR/XOR/NOT运算
+    {"pfadd",pfaddCommand,-2,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//添加元素到HyperLogLog中
+    {"pfcount",pfcountCommand,-2,REDIS_CMD_INLINE},//返回一个或多个HyperLogLog的近似基数
+    {"pfmerge",pfmergeCommand,-2,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//合并多个HyperLogLog
     {"incrby",incrbyCommand,3,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//+n
     {"decrby",decrbyCommand,3,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},//-n
     {"getset",getSetCommand,3,REDIS_CMD_BULK|REDIS_CMD_DENYOOM},//get and set
@@ -483,14 +798,15 @@ static struct redisCommand cmdTable[] = {
     {"lastsave",lastsaveCommand,1,REDIS_CMD_INLINE},//上一次存储时间
     {"type",typeCommand,2,REDIS_CMD_INLINE},////查看key类型
     {"sync",syncCommand,1,REDIS_CMD_INLINE},
-    {"flushdb",flushdbCommand,1,REDIS_CMD_INLINE},//清空数据库
-    {"flushall",flushallCommand,1,REDIS_CMD_INLINE},//清空所有数据库
+    {"flushdb",flushdbCommand,-1,REDIS_CMD_INLINE},//清空数据库
+    {"flushall",flushallCommand,-1,REDIS_CMD_INLINE},//清空所有数据库
     {"sort",sortCommand,-2,REDIS_CMD_INLINE|REDIS_CMD_DENYOOM},
     {"info",infoCommand,1,REDIS_CMD_INLINE},////打印一些日志
     {"monitor",monitorCommand,1,REDIS_CMD_INLINE},
     {"ttl",ttlCommand,2,REDIS_CMD_INLINE},////返回过期时间
     {"slaveof",slaveofCommand,3,REDIS_CMD_INLINE},
     {"debug",debugCommand,-2,REDIS_CMD_INLINE},//debug
+    {"memory",memoryCommand,-3,REDIS_CMD_INLINE},//查看key占用的内存
     {NULL,NULL,0,0}
 };
 /*============================ Utility functions ============================ */
@@ -680,37 +996,113 @@ static void dictRedisObjectDestructor(void *privdata, void *val)
     decrRefCount(val);
 }
 
-//robj中保存的ptr为dict，判断两个dict是否相等
-static int dictSdsKeyCompare(void *privdata, const void *key1,
+/* Objects used as keys may be encoded (see REDIS_ENCODING_*), so the
+ * compare and hash functions work on the string representation: an integer
+ * encoded object and a raw object holding the same number are the same key.
+ * Integers are only encoded when the string is the canonical decimal form,
+ * so formatting them back gives exactly the original bytes. */
+//比较两个robj保存的字符串是否相等(支持编码后的对象)
+static int dictEncObjKeyCompare(void *privdata, const void *key1,
         const void *key2)
 {
-    const robj *o1 = key1, *o2 = key2;
-    return sdsDictKeyCompare(privdata,o1->ptr,o2->ptr);
+    robj *o1 = (robj*) key1, *o2 = (robj*) key2;
+    DICT_NOTUSED(privdata);
+
+    if (sdsEncodedObject(o1) && sdsEncodedObject(o2))
+        return sdsDictKeyCompare(privdata,o1->ptr,o2->ptr);
+    if (o1->encoding == REDIS_ENCODING_INT &&
+        o2->encoding == REDIS_ENCODING_INT)
+        return o1->ptr == o2->ptr;
+    return compareStringObjects(o1,o2) == 0;
 }
-//计算rojb->ptr的hash
-static unsigned int dictSdsHash(const void *key) {
-    const robj *o = key;
-    return dictGenHashFunction(o->ptr, sdslen((sds)o->ptr));
+//计算robj保存的字符串的hash
+static unsigned int dictEncObjHash(const void *key) {
+    robj *o = (robj*) key;
+    char buf[REDIS_LONGSTR_SIZE];
+    size_t len;
+    char *p = stringObjectBytes(o,buf,&len);
+
+    return dictGenHashFunction((unsigned char*)p,len);
 }
 
 static dictType setDictType = {
-    dictSdsHash,               /* hash function */
+    dictEncObjHash,            /* hash function */
     NULL,                      /* key dup */
     NULL,                      /* val dup */
-    dictSdsKeyCompare,         /* key compare */
+    dictEncObjKeyCompare,      /* key compare */
     dictRedisObjectDestructor, /* key destructor */
     NULL                       /* val destructor */
 };
 
+/* The members of a sorted set are owned by its skiplist, the dict maps them
+ * to their skiplist node without holding a reference */
+static dictType zsetDictType = {
+    dictEncObjHash,            /* hash function */
+    NULL,                      /* key dup */
+    NULL,                      /* val dup */
+    dictEncObjKeyCompare,      /* key compare */
+    NULL,                      /* key destructor */
+    NULL                       /* val destructor */
+};
+
 static dictType hashDictType = {
-    dictSdsHash,                /* hash function */
+    dictEncObjHash,             /* hash function */
     NULL,                       /* key dup */
     NULL,                       /* val dup */
-    dictSdsKeyCompare,          /* key compare */
+    dictEncObjKeyCompare,       /* key compare */
     dictRedisObjectDestructor,  /* key destructor */
     dictRedisObjectDestructor   /* val destructor */
 };
 
+//单纯释放dict中保存的链表
+static void dictListDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+
+    listRelease((list*)val);
+}
+
+/* Keys are objects, values lists of clients (see the blockingkeys field
+ * of redisDb) */
+static dictType keylistDictType = {
+    dictEncObjHash,             /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictEncObjKeyCompare,       /* key compare */
+    dictRedisObjectDestructor,  /* key destructor */
+    dictListDestructor          /* val destructor */
+};
+
+/* Dictionaries released by the lazy free thread are switched to these
+ * types (the lazy free counterparts of setDictType and hashDictType), so
+ * that keys and values are freed without using the objects free list that
+ * only the main thread can touch. */
+//后台线程释放dict时使用的类型
+static void dictLazyfreeObjectDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+
+    lazyfreeDecrRefCount(val);
+}
+
+static dictType lazyfreeSetDictType = {
+    dictEncObjHash,               /* hash function */
+    NULL,                         /* key dup */
+    NULL,                         /* val dup */
+    dictEncObjKeyCompare,         /* key compare */
+    dictLazyfreeObjectDestructor, /* key destructor */
+    NULL                          /* val destructor */
+};
+
+static dictType lazyfreeHashDictType = {
+    dictEncObjHash,               /* hash function */
+    NULL,                         /* key dup */
+    NULL,                         /* val dup */
+    dictEncObjKeyCompare,         /* key compare */
+    dictLazyfreeObjectDestructor, /* key destructor */
+    dictLazyfreeObjectDestructor  /* val destructor */
+};
+
 /* ========================= Random utility functions ======================= */
 
 /* Redis generally does not try to recover from out of memory conditions
@@ -739,6 +1131,7 @@ static void closeTimedoutClients(void) {
         c = listNodeValue(ln);
         if (!(c->flags & REDIS_SLAVE) &&    /* no timeout for slaves */
             !(c->flags & REDIS_MASTER) &&   /* no timeout for masters */
+            !(c->flags & REDIS_BLOCKED) &&  /* blocked clients are idle */
              (now - c->lastinteraction > server.maxidletime)) {
             redisLog(REDIS_DEBUG,"Closing idle client");
             freeClient(c);
@@ -815,6 +1208,22 @@ static int serverCron(struct aeEventLoop *eventLoop, long long id, void *clientD
      * copied. */
     if (!server.bgsaveinprogress) tryResizeHashTables();
 
+    /* Sample a few keys of every DB to keep the per type memory breakdown
+     * reported by INFO up to date without ever scanning the whole DB */
+    for (j = 0; j < server.dbnum; j++)
+        sampleDbMemory(server.db+j,REDIS_MEMSAMPLES_PER_CRON);
+
+    /* Trim the objects free list. objfreelistmin is the minimum length the
+     * list reached since the last call: that many objects were not needed
+     * at all in the last second, so we release half of them. A steady
+     * workload keeps the objects it recycles, while after a burst of
+     * deletions the list shrinks back exponentially. */
+    if (server.objfreelistmin) {
+        server.stat_objfreelist_trimmed +=
+            trimObjFreelist((server.objfreelistmin+1)/2);
+    }
+    server.objfreelistmin = server.objfreelistlen;
+
     /* Show information about connected clients */
     if (!(loops % 5)) {
         redisLog(REDIS_DEBUG,"%d clients connected (%d slaves), %zu bytes in use, %d shared objects",
@@ -938,6 +1347,10 @@ static void createSharedObjects(void) {
         "-ERR source and destination objects are the same\r\n"));
     shared.outofrangeerr = createObject(REDIS_STRING,sdsnew(
         "-ERR index out of range\r\n"));
+    shared.invalidhllerr = createObject(REDIS_STRING,sdsnew(
+        "-ERR Key is not a valid HyperLogLog string value\r\n"));
+    shared.corrupthllerr = createObject(REDIS_STRING,sdsnew(
+        "-ERR Corrupted HyperLogLog value detected\r\n"));
     shared.space = createObject(REDIS_STRING,sdsnew(" "));
     shared.colon = createObject(REDIS_STRING,sdsnew(":"));
     shared.plus = createObject(REDIS_STRING,sdsnew("+"));
@@ -951,6 +1364,21 @@ static void createSharedObjects(void) {
     shared.select7 = createStringObject("select 7\r\n",10);
     shared.select8 = createStringObject("select 8\r\n",10);
     shared.select9 = createStringObject("select 9\r\n",10);
+    /* Integer encoded objects for the most common small values. They are
+     * never modified nor freed, so they can be referenced from any number
+     * of keys, lists and sets (see tryObjectEncoding()). */
+    if (server.sharedintegers) {
+        long j;
+
+        shared.integers = zmalloc(sizeof(robj*)*server.sharedintegers);
+        if (!shared.integers) oom("createSharedObjects");
+        for (j = 0; j < server.sharedintegers; j++) {
+            shared.integers[j] = createObject(REDIS_STRING,(void*)j);
+            shared.integers[j]->encoding = REDIS_ENCODING_INT;
+        }
+    } else {
+        shared.integers = NULL;
+    }
 }
 /*
 *struct saveparam {
@@ -989,6 +1417,16 @@ static void initServerConfig() {
     server.requirepass = NULL;///密码
     server.shareobjects = 0;////是否共享对象
     server.sharingpoolsize = 1024;//对象共享池大小
+    server.sharedintegers = REDIS_SHARED_INTEGERS;
+    server.objfreelistmax = REDIS_OBJFREELIST_MAX;
+    server.lazyfreethreshold = REDIS_LAZYFREE_THRESHOLD;
+    server.compressthreshold = REDIS_COMPRESS_THRESHOLD;
+    server.listmaxziplistentries = REDIS_LIST_MAX_ZIPLIST_ENTRIES;
+    server.listmaxziplistvalue = REDIS_LIST_MAX_ZIPLIST_VALUE;
+    server.setmaxintsetentries = REDIS_SET_MAX_INTSET_ENTRIES;
+    server.hashmaxziplistentries = REDIS_HASH_MAX_ZIPLIST_ENTRIES;
+    server.hashmaxziplistvalue = REDIS_HASH_MAX_ZIPLIST_VALUE;
+    server.hllsparsemaxbytes = REDIS_HLL_SPARSE_MAX_BYTES;
     server.maxclients = 0;//服务器允许的最大客户端连接数
     server.maxmemory = 0;////服务器允许使用的最大内存量
     ResetServerSaveParams();
@@ -1017,12 +1455,16 @@ static void initServer() {
     server.clients = listCreate();
     server.slaves = listCreate();
     server.monitors = listCreate();
-    server.objfreelist = listCreate();
+    server.unblocked_clients = listCreate();
+    server.blockedclients = 0;
+    server.objfreelist = NULL;
+    server.objfreelistlen = server.objfreelistmin = 0;
     createSharedObjects();//初始化shared
     server.el = aeCreateEventLoop(200);//创建事件循环
     server.db = zmalloc(sizeof(redisDb)*server.dbnum);
     server.sharingpool = dictCreate(&setDictType,NULL);
-    if (!server.db || !server.clients || !server.slaves || !server.monitors || !server.el || !server.objfreelist)
+    if (!server.db || !server.clients || !server.slaves || !server.monitors ||
+        !server.unblocked_clients || !server.el)
         oom("server initialization"); /* Fatal OOM */
     server.fd = anetTcpServer(server.neterr, server.port, server.bindaddr);
     if (server.fd == -1) {
@@ -1033,6 +1475,10 @@ static void initServer() {
         server.db[j].dict = dictCreate(&hashDictType,NULL);
         server.db[j].expires = dictCreate(&setDictType,NULL);
         server.db[j].id = j;
+        server.db[j].blockingkeys = dictCreate(&keylistDictType,NULL);
+        memset(server.db[j].memsamplebytes,0,
+            sizeof(server.db[j].memsamplebytes));
+        server.db[j].memsamplekeys = 0;
     }
     server.cronloops = 0;//函数（Redis 的定时任务处理函数）运行的次数。
     server.bgsaveinprogress = 0;//是否正在进行后台保存
@@ -1042,8 +1488,18 @@ static void initServer() {
     server.usedmemory = 0;//使用的内存
     server.stat_numcommands = 0;//服务器处理过的命令总数
     server.stat_numconnections = 0;//服务器接收到的连接总数
+    server.stat_objfreelist_hits = 0;
+    server.stat_objfreelist_misses = 0;
+    server.stat_objfreelist_trimmed = 0;
+    server.stat_lzf_compressed = 0;
+    server.stat_lzf_uncompressible = 0;
+    server.stat_lzf_rawbytes = 0;
+    server.stat_lzf_compressedbytes = 0;
+    server.stat_lzf_decompressions = 0;
     server.stat_starttime = time(NULL);
+    lazyfreeInit();
     aeCreateTimeEvent(server.el, 1000, serverCron, NULL, NULL);
+    aeSetBeforeSleepProc(server.el,beforeSleep);
 }
 
 /* Empty the whole database */
@@ -1058,6 +1514,21 @@ static long long emptyDb() {
     }
     return removed;
 }
+
+/* Empty 'db' in O(1): the dicts are replaced by new ones and the old ones
+ * are released by the lazy free thread. Returns the number of keys. */
+//异步清空一个数据库
+static long long emptyDbAsync(redisDb *db) {
+    long long removed = dictSize(db->dict);
+    dict *olddict = db->dict, *oldexpires = db->expires;
+
+    db->dict = dictCreate(&hashDictType,NULL);
+    db->expires = dictCreate(&setDictType,NULL);
+    if (!db->dict || !db->expires) oom("emptyDbAsync");
+    lazyfreeDict(olddict);
+    lazyfreeDict(oldexpires);
+    return removed;
+}
 //不区分大小写
 static int yesnotoi(char *s) {
     if (!strcasecmp(s,"yes")) return 1;
@@ -1179,6 +1650,29 @@ static void loadServerConfig(char *filename) {
             if (server.sharingpoolsize < 1) {
                 err = "invalid object sharing pool size"; goto loaderr;
             }
+        } else if (!strcasecmp(argv[0],"objfreelistmax") && argc == 2) {//objfreelist的最大长度
+            server.objfreelistmax = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"lazyfreethreshold") && argc == 2) {//后台释放的元素个数阈值
+            server.lazyfreethreshold = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"compressthreshold") && argc == 2) {//压缩字符串值的长度阈值
+            server.compressthreshold = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"listmaxziplistentries") && argc == 2) {//ziplist编码的list的最大元素个数
+            server.listmaxziplistentries = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"listmaxziplistvalue") && argc == 2) {//ziplist编码的list的最大元素长度
+            server.listmaxziplistvalue = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"setmaxintsetentries") && argc == 2) {//intset编码的set的最大元素个数
+            server.setmaxintsetentries = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"hashmaxziplistentries") && argc == 2) {//ziplist编码的hash的最大field个数
+            server.hashmaxziplistentries = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"hashmaxziplistvalue") && argc == 2) {//ziplist编码的hash的最大field和value长度
+            server.hashmaxziplistvalue = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"hllsparsemaxbytes") && argc == 2) {//稀疏编码的HyperLogLog的最大字节数
+            server.hllsparsemaxbytes = strtoul(argv[1],NULL,10);
+        } else if (!strcasecmp(argv[0],"sharedintegers") && argc == 2) {//共享整数对象的数量
+            server.sharedintegers = strtol(argv[1],NULL,10);
+            if (server.sharedintegers < 0) {
+                err = "invalid number of shared integers"; goto loaderr;
+            }
         } else if (!strcasecmp(argv[0],"daemonize") && argc == 2) {//守护进程
             if ((server.daemonize = yesnotoi(argv[1])) == -1) {
                 err = "argument must be 'yes' or 'no'"; goto loaderr;
@@ -1228,6 +1722,14 @@ static void freeClient(redisClient *c) {
     listRelease(c->reply);
     ////已经发送给客户端的回复字节数。这个值用于跟踪回复的发送进度，特别是在处理大回复时。
     freeClientArgv(c);
+    /* Stop waiting for the keys, and don't process the input buffer of a
+     * client that no longer exists */
+    if (c->flags & REDIS_BLOCKED) unblockClient(c);
+    if (c->flags & REDIS_UNBLOCKED) {
+        ln = listSearchKey(server.unblocked_clients,c);
+        assert(ln != NULL);
+        listDelNode(server.unblocked_clients,ln);
+    }
     close(c->fd);
     ln = listSearchKey(server.clients,c);
     assert(ln != NULL);
@@ -1350,6 +1852,8 @@ static struct redisCommand *lookupCommand(char *name) {
 static void resetClient(redisClient *c) {
     freeClientArgv(c);
     c->bulklen = -1;
+    c->reqtype = REDIS_REQ_INLINE;
+    c->multibulklen = 0;
 }
 
 /* If this function gets called we already read a whole
@@ -1389,7 +1893,8 @@ static int processCommand(redisClient *c) {
         addReplySds(c,sdsnew("-ERR command not allowed when used memory > 'maxmemory'\r\n"));
         resetClient(c);
         return 1;
-    } else if (cmd->flags & REDIS_CMD_BULK && c->bulklen == -1) {
+    } else if (c->reqtype == REDIS_REQ_INLINE &&
+               cmd->flags & REDIS_CMD_BULK && c->bulklen == -1) {
         //从最后一位读取长度
         int bulklen = atoi(c->argv[c->argc-1]->ptr);
         //释放最后一个参数
@@ -1432,11 +1937,13 @@ static int processCommand(redisClient *c) {
     /* Exec the command */
     //执行命令，如果存在dirty则把命令发给从服务器和监视服务器
     dirty = server.dirty;
+    c->cmd = cmd;
     cmd->proc(c);
+    /* The command may have rewritten itself, see rewriteClientCommand() */
     if (server.dirty-dirty != 0 && listLength(server.slaves))
-        replicationFeedSlaves(server.slaves,cmd,c->db->id,c->argv,c->argc);
+        replicationFeedSlaves(server.slaves,c->db->id,c->argv,c->argc);
     if (listLength(server.monitors))
-        replicationFeedSlaves(server.monitors,cmd,c->db->id,c->argv,c->argc);
+        replicationFeedMonitors(server.monitors,c->cmd,c->db->id,c->argv,c->argc);
     server.stat_numcommands++;
 
     /* Prepare the client for the next command */
@@ -1447,9 +1954,80 @@ static int processCommand(redisClient *c) {
     resetClient(c);
     return 1;
 }
-//replicationFeedSlaves 函数是 Redis 复制功能的一部分，
-//用于将命令及其参数复制给所有处于活动状态的从服务器（slave）。这个函数处理命令的序列化，确保它们可以被从服务器正确解析和执行。下面是该函数的详细解释：
-static void replicationFeedSlaves(list *slaves, struct redisCommand *cmd, int dictid, robj **argv, int argc) {
+/* Select the DB 'dictid' in the stream of commands sent to 'slave' */
+//如果需要，向从服务器(或者监视器)发送SELECT命令
+static void replicationSelectDb(redisClient *slave, int dictid) {
+    robj *selectcmd;
+
+    if (slave->slaveseldb == dictid) return;
+    switch(dictid) {
+    case 0: selectcmd = shared.select0; break;
+    case 1: selectcmd = shared.select1; break;
+    case 2: selectcmd = shared.select2; break;
+    case 3: selectcmd = shared.select3; break;
+    case 4: selectcmd = shared.select4; break;
+    case 5: selectcmd = shared.select5; break;
+    case 6: selectcmd = shared.select6; break;
+    case 7: selectcmd = shared.select7; break;
+    case 8: selectcmd = shared.select8; break;
+    case 9: selectcmd = shared.select9; break;
+    default:
+        selectcmd = createObject(REDIS_STRING,
+            sdscatprintf(sdsempty(),"select %d\r\n",dictid));
+        selectcmd->refcount = 0;
+        break;
+    }
+    addReply(slave,selectcmd);
+    slave->slaveseldb = dictid;
+}
+
+/* Feed the slaves with the command, in the multi bulk format: it is binary
+ * safe and can carry any number of arguments, so commands with many
+ * elements (like variadic RPUSH or SADD) are replicated as they are. The
+ * whole command is copied into a single object shared by all the slaves. */
+//将命令以multi bulk格式发送给所有的从服务器
+static void replicationFeedSlaves(list *slaves, int dictid, robj **argv, int argc) {
+    listNode *ln;
+    sds cmd;
+    robj *cmdobj;
+    int j;
+
+    cmd = sdscatprintf(sdsempty(),"*%d\r\n",argc);
+    for (j = 0; j < argc; j++) {
+        char buf[REDIS_LONGSTR_SIZE], *p;
+        size_t len;
+        robj *dec = NULL;
+
+        /* SET and GETSET may have compressed the value argument in place */
+        if (argv[j]->encoding == REDIS_ENCODING_LZF) {
+            dec = getDecodedObject(argv[j]);
+            p = dec->ptr;
+            len = sdslen(dec->ptr);
+        } else {
+            p = stringObjectBytes(argv[j],buf,&len);
+        }
+        cmd = sdscatprintf(cmd,"$%zu\r\n",len);
+        cmd = sdscatlen(cmd,p,len);
+        cmd = sdscatlen(cmd,"\r\n",2);
+        if (dec) decrRefCount(dec);
+    }
+    cmdobj = createObject(REDIS_STRING,cmd);
+
+    listRewind(slaves);
+    while((ln = listYield(slaves))) {
+        redisClient *slave = ln->value;
+
+        /* Don't feed slaves that are still waiting for BGSAVE to start */
+        if (slave->replstate == REDIS_REPL_WAIT_BGSAVE_START) continue;
+        replicationSelectDb(slave,dictid);
+        addReply(slave,cmdobj);
+    }
+    decrRefCount(cmdobj);
+}
+
+/* MONITOR clients see the commands in the human readable inline format */
+//将命令以inline格式发送给所有的监视器
+static void replicationFeedMonitors(list *monitors, struct redisCommand *cmd, int dictid, robj **argv, int argc) {
     listNode *ln;
     int outc = 0, j;
     robj **outv;
@@ -1461,7 +2039,7 @@ static void replicationFeedSlaves(list *slaves, struct redisCommand *cmd, int di
         outv = static_outv;
     } else {
         outv = zmalloc(sizeof(robj*)*(argc*2+1));
-        if (!outv) oom("replicationFeedSlaves");
+        if (!outv) oom("replicationFeedMonitors");
     }
 
     for (j = 0; j < argc; j++) {
@@ -1470,7 +2048,8 @@ static void replicationFeedSlaves(list *slaves, struct redisCommand *cmd, int di
             robj *lenobj;
 
             lenobj = createObject(REDIS_STRING,
-                sdscatprintf(sdsempty(),"%d\r\n",sdslen(argv[j]->ptr)));
+                sdscatprintf(sdsempty(),"%d\r\n",
+                    (int)stringObjectLen(argv[j])));
             lenobj->refcount = 0;
             outv[outc++] = lenobj;
         }
@@ -1482,38 +2061,12 @@ static void replicationFeedSlaves(list *slaves, struct redisCommand *cmd, int di
      * be sure to free objects if there is no slave in a replication state
      * able to be feed with commands */
     for (j = 0; j < outc; j++) incrRefCount(outv[j]);
-    listRewind(slaves);
-    while((ln = listYield(slaves))) {
-        redisClient *slave = ln->value;
+    listRewind(monitors);
+    while((ln = listYield(monitors))) {
+        redisClient *monitor = ln->value;
 
-        /* Don't feed slaves that are still waiting for BGSAVE to start */
-        if (slave->replstate == REDIS_REPL_WAIT_BGSAVE_START) continue;
-
-        /* Feed all the other slaves, MONITORs and so on */
-        if (slave->slaveseldb != dictid) {
-            robj *selectcmd;
-
-            switch(dictid) {
-            case 0: selectcmd = shared.select0; break;
-            case 1: selectcmd = shared.select1; break;
-            case 2: selectcmd = shared.select2; break;
-            case 3: selectcmd = shared.select3; break;
-            case 4: selectcmd = shared.select4; break;
-            case 5: selectcmd = shared.select5; break;
-            case 6: selectcmd = shared.select6; break;
-            case 7: selectcmd = shared.select7; break;
-            case 8: selectcmd = shared.select8; break;
-            case 9: selectcmd = shared.select9; break;
-            default:
-                selectcmd = createObject(REDIS_STRING,
-                    sdscatprintf(sdsempty(),"select %d\r\n",dictid));
-                selectcmd->refcount = 0;
-                break;
-            }
-            addReply(slave,selectcmd);
-            slave->slaveseldb = dictid;
-        }
-        for (j = 0; j < outc; j++) addReply(slave,outv[j]);
+        replicationSelectDb(monitor,dictid);
+        for (j = 0; j < outc; j++) addReply(monitor,outv[j]);
     }
     for (j = 0; j < outc; j++) decrRefCount(outv[j]);
     if (outv != static_outv) zfree(outv);
@@ -1547,8 +2100,27 @@ static void readQueryFromClient(aeEventLoop *el, int fd, void *privdata, int mas
     } else {
         return;
     }
+    processInputBuffer(c);
+}
 
+/* Execute the commands in the query buffer of the client. A client blocked
+ * in BLPOP/BRPOP keeps the following commands in the buffer: they are
+ * processed by beforeSleep() once it gets unblocked. */
+//执行客户端输入缓冲区中的命令
+static void processInputBuffer(redisClient *c) {
 again:
+    if (c->flags & REDIS_BLOCKED) return;
+    /* Multi bulk requests start with '*' */
+    if (c->reqtype == REDIS_REQ_MULTIBULK ||
+        (c->bulklen == -1 && c->querybuf[0] == '*'))
+    {
+        int retval = processMultibulkBuffer(c);
+
+        if (retval == -1) return; /* protocol error, client freed */
+        if (retval == 0) return;  /* more data needed */
+        if (processCommand(c) && sdslen(c->querybuf)) goto again;
+        return;
+    }
     //如果没有进行批处理，度取出一行，将参数分解出来，放到argc和argv中，并处理参数
     //如果每处理完，这继续运行到again的位置
     if (c->bulklen == -1) {
@@ -1575,6 +2147,7 @@ again:
             if (sdslen(query) == 0) {
                 /* Ignore empty query */
                 sdsfree(query);
+                if (sdslen(c->querybuf)) goto again;
                 return;
             }
             argv = sdssplitlen(query,sdslen(query)," ",1,&argc);
@@ -1616,11 +2189,92 @@ again:
             c->argv[c->argc] = createStringObject(c->querybuf,c->bulklen-2);
             c->argc++;
             c->querybuf = sdsrange(c->querybuf,c->bulklen,-1);
-            processCommand(c);
+            /* Go on with the commands pipelined after this one */
+            if (processCommand(c) && sdslen(c->querybuf)) goto again;
             return;
         }
     }
 }
+
+/* Read the arguments of a multi bulk request from the query buffer into
+ * c->argv. The arguments may arrive in many reads: the number of arguments
+ * left and the length of the current one are kept in c->multibulklen and
+ * c->bulklen. The buffer is trimmed just once at the end, so a command with
+ * many arguments is not copied again for every argument.
+ *
+ * Returns 1 when all the arguments were read, 0 if more data is needed,
+ * -1 on protocol error (the client is freed). */
+//读取multi bulk格式命令的参数
+static int processMultibulkBuffer(redisClient *c) {
+    char *buf = c->querybuf, *newline, *eptr;
+    size_t pos = 0, buflen = sdslen(c->querybuf);
+    long long ll;
+
+    if (c->multibulklen == 0) {
+        /* The first line is *<number of arguments> */
+        newline = memchr(buf,'\n',buflen);
+        if (newline == NULL) {
+            if (buflen > REDIS_REQUEST_MAX_SIZE) goto protoerr;
+            return 0;
+        }
+        ll = strtoll(buf+1,&eptr,10);
+        if ((*eptr != '\r' && *eptr != '\n') ||
+            ll <= 0 || ll > REDIS_MULTIBULK_MAX_ARGS) goto protoerr;
+        pos = newline-buf+1;
+        if (c->argv) zfree(c->argv);
+        c->argv = zmalloc(sizeof(robj*)*ll);
+        if (c->argv == NULL) oom("allocating arguments list for client");
+        c->argc = 0;
+        c->multibulklen = ll;
+        c->reqtype = REDIS_REQ_MULTIBULK;
+    }
+
+    while (c->multibulklen) {
+        if (c->bulklen == -1) {
+            /* Read the $<length> line */
+            newline = memchr(buf+pos,'\n',buflen-pos);
+            if (newline == NULL) {
+                if (buflen-pos > REDIS_REQUEST_MAX_SIZE) goto protoerr;
+                break;
+            }
+            if (buf[pos] != '$') goto protoerr;
+            ll = strtoll(buf+pos+1,&eptr,10);
+            if ((*eptr != '\r' && *eptr != '\n') ||
+                ll < 0 || ll > REDIS_BULK_MAX_SIZE) goto protoerr;
+            pos = newline-buf+1;
+            c->bulklen = ll+2; /* add two bytes for CR+LF */
+        }
+        if (buflen-pos < (size_t)c->bulklen) break;
+        c->argv[c->argc++] = createStringObject(buf+pos,c->bulklen-2);
+        pos += c->bulklen;
+        c->bulklen = -1;
+        c->multibulklen--;
+    }
+    if (pos) c->querybuf = sdsrange(c->querybuf,pos,-1);
+    return c->multibulklen == 0;
+
+protoerr:
+    redisLog(REDIS_DEBUG, "Client protocol error");
+    freeClient(c);
+    return -1;
+}
+/* Called before the event loop sleeps: the clients unblocked by a push may
+ * have more commands in the query buffer, that were not processed while
+ * they were blocked. */
+//处理被唤醒的客户端输入缓冲区中的命令
+static void beforeSleep(struct aeEventLoop *eventLoop) {
+    listNode *ln;
+    REDIS_NOTUSED(eventLoop);
+
+    while ((ln = listFirst(server.unblocked_clients)) != NULL) {
+        redisClient *c = listNodeValue(ln);
+
+        listDelNode(server.unblocked_clients,ln);
+        c->flags &= ~REDIS_UNBLOCKED;
+        if (sdslen(c->querybuf)) processInputBuffer(c);
+    }
+}
+
 //选择数据库
 static int selectDb(redisClient *c, int id) {
     if (id < 0 || id >= server.dbnum)
@@ -1651,11 +2305,17 @@ static redisClient *createClient(int fd) {
     c->argc = 0;
     c->argv = NULL;
     c->bulklen = -1;
+    c->reqtype = REDIS_REQ_INLINE;
+    c->multibulklen = 0;
     c->sentlen = 0;
     c->flags = 0;
     c->lastinteraction = time(NULL);
     c->authenticated = 0;//密码
     c->replstate = REDIS_REPL_NONE;//No active replication
+    c->cmd = NULL;
+    c->blockingkeys = NULL;
+    c->blockingkeysnum = 0;
+    c->blocktimer = -1;
     if ((c->reply = listCreate()) == NULL) oom("listCreate");
     listSetFreeMethod(c->reply,decrRefCount);
     listSetDupMethod(c->reply,dupClientReplyValue);
@@ -1679,8 +2339,14 @@ static void addReply(redisClient *c, robj *obj) {
         aeCreateFileEvent(server.el, c->fd, AE_WRITABLE,
         sendReplyToClient, c) == AE_ERR) return;
     //注册了可写事件，但是并没有调用select函数，所以不会立刻执行
+    /* The output buffer can only hold sds strings: integer encoded
+     * objects are turned into a raw copy here */
+    if (!sdsEncodedObject(obj)) {
+        obj = getDecodedObject(obj);
+    } else {
+        incrRefCount(obj);
+    }
     if (!listAddNodeTail(c->reply,obj)) oom("listAddNodeTail");
-    incrRefCount(obj);
 }
 
 static void addReplySds(redisClient *c, sds s) {
@@ -1688,6 +2354,22 @@ static void addReplySds(redisClient *c, sds s) {
     addReply(c,o);
     decrRefCount(o);
 }
+
+//发送bulk长度"$<len>\r\n"
+static void addReplyBulkLen(redisClient *c, robj *obj) {
+    addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",
+        (int)stringObjectLen(obj)));
+}
+
+/* Doubles are replied as bulk strings, with enough digits to read back
+ * exactly the same value */
+//以bulk的形式发送一个double
+static void addReplyDouble(redisClient *c, double d) {
+    char dbuf[128];
+    int len = snprintf(dbuf,sizeof(dbuf),"%.17g",d);
+
+    addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n%s\r\n",len,dbuf));
+}
 //连接一个客户端
 static void acceptHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
     int cport, cfd;
@@ -1728,63 +2410,196 @@ static void acceptHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
 static robj *createObject(int type, void *ptr) {
     robj *o;
 
-    if (listLength(server.objfreelist)) {
-        listNode *head = listFirst(server.objfreelist);//获取链表的头结点
-        o = listNodeValue(head);//获取链表当前节点的值
-        listDelNode(server.objfreelist,head);//从objfreelist删除
+    if (server.objfreelist) {
+        o = server.objfreelist;//取出链表的头结点
+        server.objfreelist = o->ptr;
+        server.objfreelistlen--;
+        if (server.objfreelistlen < server.objfreelistmin)
+            server.objfreelistmin = server.objfreelistlen;
+        server.stat_objfreelist_hits++;
     } else {
         o = zmalloc(sizeof(*o));
+        server.stat_objfreelist_misses++;
     }
     if (!o) oom("createObject");
     o->type = type;
+    o->encoding = REDIS_ENCODING_RAW;
     o->ptr = ptr;
     o->refcount = 1;
     return o;
 }
 
+/* Create a string object. Short strings use the embedded encoding, longer
+ * ones a separately allocated sds. If 'ptr' is NULL the string is zeroed. */
 static robj *createStringObject(char *ptr, size_t len) {
+    if (len <= REDIS_ENCODING_EMBSTR_SIZE_LIMIT)
+        return createEmbeddedStringObject(ptr,len);
     return createObject(REDIS_STRING,sdsnewlen(ptr,len));
 }
 
-static robj *createListObject(void) {
-    list *l = listCreate();
+/* Create a string object with encoding REDIS_ENCODING_EMBSTR: the sds
+ * header (always a sdshdr8, see REDIS_ENCODING_EMBSTR_SIZE_LIMIT) and the
+ * string itself are stored just after the robj structure, in the same
+ * allocation, so there is one malloc() (and one free()) per object and the
+ * string is in the same cache line of the object header. The sds is sized
+ * exactly (no free space) and must never be modified in a way that requires
+ * reallocating it. Such objects are not recycled using the objects free
+ * list as they are bigger than a plain robj. */
+//创建嵌入式字符串对象，robj与sds在同一块内存中
+static robj *createEmbeddedStringObject(char *ptr, size_t len) {
+    robj *o = zmalloc(sizeof(robj)+sizeof(struct sdshdr8)+len+1);
+    struct sdshdr8 *sh;
+
+    if (!o) oom("createEmbeddedStringObject");
+    sh = (void*)(o+1);
+    o->type = REDIS_STRING;
+    o->encoding = REDIS_ENCODING_EMBSTR;
+    o->ptr = sh->buf;
+    o->refcount = 1;
+    sh->len = len;
+    sh->alloc = len;
+    sh->flags = SDS_TYPE_8;
+    if (ptr)
+        memcpy(sh->buf,ptr,len);
+    else
+        memset(sh->buf,0,len);
+    sh->buf[len] = '\0';
+    return o;
+}
+
+//创建一个保存整数的字符串对象，能放进long时直接编码为整数
+static robj *createStringObjectFromLongLong(long long value) {
+    robj *o;
+
+    if (value >= 0 && value < server.sharedintegers) {
+        o = shared.integers[value];
+        incrRefCount(o);
+    } else if (value >= LONG_MIN && value <= LONG_MAX) {
+        o = createObject(REDIS_STRING,NULL);
+        o->encoding = REDIS_ENCODING_INT;
+        o->ptr = (void*)((long)value);
+    } else {
+        o = createObject(REDIS_STRING,sdscatprintf(sdsempty(),"%lld",value));
+    }
+    return o;
+}
+
+//创建一个quicklist编码的list对象
+static robj *createQuicklistObject(void) {
+    robj *o = createObject(REDIS_LIST,
+        quicklistCreate(server.listmaxziplistentries));
 
-    if (!l) oom("listCreate");
-    listSetFreeMethod(l,decrRefCount);
-    return createObject(REDIS_LIST,l);
+    o->encoding = REDIS_ENCODING_QUICKLIST;
+    return o;
+}
+
+//创建一个ziplist编码的list对象
+static robj *createZiplistObject(void) {
+    robj *o = createObject(REDIS_LIST,ziplistNew());
+
+    o->encoding = REDIS_ENCODING_ZIPLIST;
+    return o;
 }
 
 static robj *createSetObject(void) {
     dict *d = dictCreate(&setDictType,NULL);
+    robj *o;
+
     if (!d) oom("dictCreate");
-    return createObject(REDIS_SET,d);
+    o = createObject(REDIS_SET,d);
+    o->encoding = REDIS_ENCODING_HT;
+    return o;
+}
+
+//创建一个intset编码的set对象
+static robj *createIntsetObject(void) {
+    robj *o = createObject(REDIS_SET,intsetNew());
+
+    o->encoding = REDIS_ENCODING_INTSET;
+    return o;
+}
+
+//创建一个ziplist编码的hash对象
+static robj *createHashObject(void) {
+    robj *o = createObject(REDIS_HASH,ziplistNew());
+
+    o->encoding = REDIS_ENCODING_ZIPLIST;
+    return o;
+}
+
+//创建一个空的有序集合对象
+static robj *createZsetObject(void) {
+    zset *zs = zmalloc(sizeof(*zs));
+    robj *o;
+
+    if (!zs) oom("createZsetObject");
+    zs->dict = dictCreate(&zsetDictType,NULL);
+    if (!zs->dict) oom("dictCreate");
+    zs->zsl = zslCreate();
+    o = createObject(REDIS_ZSET,zs);
+    o->encoding = REDIS_ENCODING_SKIPLIST;
+    return o;
 }
 //robj的void *ptr;可以储存任意redis数据结构
 //释放robj中的String对象
 static void freeStringObject(robj *o) {
-    sdsfree(o->ptr);
+    /* Embedded strings are released together with the object */
+    if (o->encoding == REDIS_ENCODING_RAW) sdsfree(o->ptr);
+    else if (o->encoding == REDIS_ENCODING_LZF) zfree(o->ptr);
 }
 //释放robj中的String对象
 static void freeListObject(robj *o) {
-    listRelease((list*) o->ptr);
+    if (o->encoding == REDIS_ENCODING_ZIPLIST)
+        zfree(o->ptr);
+    else
+        quicklistRelease(o->ptr);
 }
 //释放哈希表
 static void freeSetObject(robj *o) {
-    dictRelease((dict*) o->ptr);
+    if (o->encoding == REDIS_ENCODING_INTSET)
+        zfree(o->ptr);
+    else
+        dictRelease((dict*) o->ptr);
 }
-//释放哈希表
+//释放有序集合，成员由跳表释放
+static void freeZsetObject(robj *o) {
+    zset *zs = o->ptr;
+
+    dictRelease(zs->dict);
+    zslFree(zs->zsl,decrRefCount);
+    zfree(zs);
+}
+//释放hash
 static void freeHashObject(robj *o) {
-    dictRelease((dict*) o->ptr);
+    if (o->encoding == REDIS_ENCODING_ZIPLIST)
+        zfree(o->ptr);
+    else
+        dictRelease((dict*) o->ptr);
 }
 /*typedef struct redisObject {
     void *ptr;
-    int type;
+    unsigned char type;
+    unsigned char encoding; //编码方式，见REDIS_ENCODING_*
+    unsigned char notused[2];
     int refcount;
 } robj;
 */
+/* The lazy free thread releases the references held by the values it frees
+ * while the main thread may take or release references to the same shared
+ * objects (shared integers, strings queued in the clients output lists), so
+ * the reference count is updated atomically. Without atomic builtins the
+ * lazy free is disabled and everything is freed by the main thread. */
+#ifdef HAVE_ATOMIC
+#define objectIncrRefCount(o) __sync_add_and_fetch(&(o)->refcount,1)
+#define objectDecrRefCount(o) __sync_sub_and_fetch(&(o)->refcount,1)
+#else
+#define objectIncrRefCount(o) (++(o)->refcount)
+#define objectDecrRefCount(o) (--(o)->refcount)
+#endif
+
 //引用计数+1
 static void incrRefCount(robj *o) {
-    o->refcount++;
+    objectIncrRefCount(o);
 #ifdef DEBUG_REFCOUNT
     if (o->type == REDIS_STRING)
         printf("Increment '%s'(%p), now is: %d\n",o->ptr,o,o->refcount);
@@ -1798,20 +2613,417 @@ static void decrRefCount(void *obj) {
     if (o->type == REDIS_STRING)
         printf("Decrement '%s'(%p), now is: %d\n",o->ptr,o,o->refcount-1);
 #endif
-    if (--(o->refcount) == 0) {
+    if (objectDecrRefCount(o) == 0) {
         switch(o->type) {
         case REDIS_STRING: freeStringObject(o); break;
         case REDIS_LIST: freeListObject(o); break;
         case REDIS_SET: freeSetObject(o); break;
-        case REDIS_HASH: freeHashObject(o); break;    //应该不会出现HASH类型
+        case REDIS_ZSET: freeZsetObject(o); break;
+        case REDIS_HASH: freeHashObject(o); break;
         default: assert(0 != 0); break;
         }
-        //在释放对象后，Redis尝试将对象添加到一个名为server.objfreelist的列表中，以便后续重用。
-        //如果server.objfreelist的长度超过了预设的最大值REDIS_OBJFREELIST_MAX，
-        //或者由于某种原因无法将对象添加到列表中（!listAddNodeHead(server.objfreelist,o)返回非零值），则直接调用zfree(o)释放对象所占用的内存。
-        if (listLength(server.objfreelist) > REDIS_OBJFREELIST_MAX ||
-            !listAddNodeHead(server.objfreelist,o))
+        /* Embedded strings are bigger than a plain object */
+        if (o->encoding == REDIS_ENCODING_EMBSTR) {
+            zfree(o);
+            return;
+        }
+        //在释放对象后，Redis尝试将对象添加到server.objfreelist中，以便后续重用。
+        //objfreelist直接使用对象的ptr字段作为next指针，不需要额外分配内存。
+        //如果server.objfreelist的长度达到了server.objfreelistmax，则直接调用zfree(o)释放对象所占用的内存。
+        if (server.objfreelistlen >= server.objfreelistmax) {
             zfree(o);
+        } else {
+            o->ptr = server.objfreelist;
+            server.objfreelist = o;
+            server.objfreelistlen++;
+        }
+    }
+}
+
+/* Release up to 'count' cached objects from the objects free list, returning
+ * the number of objects actually freed. */
+//释放objfreelist中最多count个对象
+static unsigned long trimObjFreelist(unsigned long count) {
+    unsigned long freed = 0;
+
+    while (server.objfreelist && freed < count) {
+        robj *o = server.objfreelist;
+
+        server.objfreelist = o->ptr;
+        zfree(o);
+        freed++;
+    }
+    server.objfreelistlen -= freed;
+    if (server.objfreelistmin > server.objfreelistlen)
+        server.objfreelistmin = server.objfreelistlen;
+    return freed;
+}
+
+/* ================================ Lazy free =============================== */
+
+/* Freeing a list or a set with millions of elements means calling free()
+ * millions of times, and doing it in the main thread blocks every client
+ * for the whole time. When the last reference to a value with more than
+ * 'lazyfreethreshold' elements is released, the value is already unlinked
+ * from the key space, so it is queued to a background thread that is the
+ * only one touching it from now on. The same is done with the whole key
+ * space for FLUSHDB ASYNC and FLUSHALL ASYNC.
+ *
+ * The thread never uses the objects free list, see lazyfreeDecrRefCount().
+ * zmalloc is switched to thread safe accounting by lazyfreeInit(). */
+
+#define REDIS_LAZYFREE_OBJECT 0 /* Job is a robj */
+#define REDIS_LAZYFREE_DICT 1   /* Job is a key space dict (keys or expires) */
+
+typedef struct lazyfreeJob {
+    int type;
+    void *ptr;
+} lazyfreeJob;
+
+/* Release an object from the lazy free thread: like decrRefCount() but the
+ * memory goes back to the allocator and not to the objects free list. */
+//后台线程使用的decrRefCount，不使用objfreelist
+static void lazyfreeDecrRefCount(void *obj) {
+    robj *o = obj;
+
+    if (objectDecrRefCount(o) != 0) return;
+    switch(o->type) {
+    case REDIS_STRING:
+        freeStringObject(o);
+        break;
+    case REDIS_LIST:
+        if (o->encoding == REDIS_ENCODING_ZIPLIST)
+            zfree(o->ptr);
+        else
+            quicklistRelease(o->ptr);
+        break;
+    case REDIS_SET:
+        if (o->encoding == REDIS_ENCODING_INTSET)
+            zfree(o->ptr);
+        else
+            lazyfreeReleaseDict(o->ptr);
+        break;
+    case REDIS_ZSET: {
+        /* The dict holds no references, the skiplist releases them */
+        zset *zs = o->ptr;
+
+        dictRelease(zs->dict);
+        zslFree(zs->zsl,lazyfreeDecrRefCount);
+        zfree(zs);
+        break;
+    }
+    case REDIS_HASH:
+        if (o->encoding == REDIS_ENCODING_ZIPLIST)
+            zfree(o->ptr);
+        else
+            lazyfreeReleaseDict(o->ptr);
+        break;
+    default: assert(0 != 0); break;
+    }
+    zfree(o);
+}
+
+/* Release a dict of objects from the lazy free thread */
+static void lazyfreeReleaseDict(dict *d) {
+    d->type = (d->type == &hashDictType) ? &lazyfreeHashDictType :
+                                           &lazyfreeSetDictType;
+    dictRelease(d);
+}
+
+//后台释放线程的主循环
+static void *lazyfreeThreadMain(void *arg) {
+    REDIS_NOTUSED(arg);
+
+    while(1) {
+        listNode *ln;
+        lazyfreeJob *job;
+
+        pthread_mutex_lock(&server.lazyfree_mutex);
+        while (listLength(server.lazyfree_jobs) == 0)
+            pthread_cond_wait(&server.lazyfree_cond,&server.lazyfree_mutex);
+        ln = listFirst(server.lazyfree_jobs);
+        job = listNodeValue(ln);
+        listDelNode(server.lazyfree_jobs,ln);
+        pthread_mutex_unlock(&server.lazyfree_mutex);
+
+        if (job->type == REDIS_LAZYFREE_OBJECT) {
+            lazyfreeDecrRefCount(job->ptr);
+        } else {
+            lazyfreeReleaseDict(job->ptr);
+        }
+        zfree(job);
+
+        pthread_mutex_lock(&server.lazyfree_mutex);
+        server.lazyfree_pending--;
+        server.stat_lazyfreed_objects++;
+        pthread_mutex_unlock(&server.lazyfree_mutex);
+    }
+    return NULL;
+}
+
+//启动后台释放线程
+static void lazyfreeInit(void) {
+    server.lazyfree_jobs = listCreate();
+    server.lazyfree_pending = 0;
+    server.stat_lazyfreed_objects = 0;
+    if (!server.lazyfree_jobs) oom("lazyfreeInit");
+#ifdef HAVE_ATOMIC
+    zmalloc_enable_thread_safeness();
+    pthread_mutex_init(&server.lazyfree_mutex,NULL);
+    pthread_cond_init(&server.lazyfree_cond,NULL);
+    if (pthread_create(&server.lazyfree_thread,NULL,lazyfreeThreadMain,NULL)) {
+        redisLog(REDIS_WARNING,"Can't create the lazy free thread: %s",
+            strerror(errno));
+        exit(1);
+    }
+#endif
+}
+
+//将一个释放任务交给后台线程
+static void lazyfreeCreateJob(int type, void *ptr) {
+    lazyfreeJob *job = zmalloc(sizeof(*job));
+
+    if (!job) oom("lazyfreeCreateJob");
+    job->type = type;
+    job->ptr = ptr;
+    pthread_mutex_lock(&server.lazyfree_mutex);
+    if (!listAddNodeTail(server.lazyfree_jobs,job)) oom("listAddNodeTail");
+    server.lazyfree_pending++;
+    pthread_cond_signal(&server.lazyfree_cond);
+    pthread_mutex_unlock(&server.lazyfree_mutex);
+}
+
+/* Number of elements freeing the object would have to visit */
+//释放对象时需要处理的元素个数
+static unsigned long lazyfreeGetFreeEffort(robj *o) {
+    switch(o->type) {
+    case REDIS_LIST:
+        /* A ziplist is a single allocation, a quicklist one per node */
+        if (o->encoding == REDIS_ENCODING_ZIPLIST) return 1;
+        return quicklistNodeCount((quicklist*)o->ptr);
+    case REDIS_SET:
+        /* An intset is a single allocation as well */
+        if (o->encoding == REDIS_ENCODING_INTSET) return 1;
+        return dictSize((dict*)o->ptr);
+    case REDIS_ZSET: return ((zset*)o->ptr)->zsl->length;
+    case REDIS_HASH:
+        if (o->encoding == REDIS_ENCODING_ZIPLIST) return 1;
+        return dictSize((dict*)o->ptr);
+    default: return 1;
+    }
+}
+
+/* Release a reference to a value just removed from the key space. If this
+ * is the last reference and the value is big it is freed by the lazy free
+ * thread, otherwise this is just decrRefCount(). Values are never shared by
+ * other values, so when the count is 1 the main thread is the only owner. */
+//释放一个从数据库中删除的值，大对象交给后台线程释放
+static void lazyfreeObject(robj *o) {
+#ifdef HAVE_ATOMIC
+    if (o->refcount == 1 && server.lazyfreethreshold &&
+        lazyfreeGetFreeEffort(o) > server.lazyfreethreshold)
+    {
+        lazyfreeCreateJob(REDIS_LAZYFREE_OBJECT,o);
+        return;
+    }
+#endif
+    decrRefCount(o);
+}
+
+/* Release a key space dict (db->dict or db->expires) in background. The
+ * dict must be already replaced by a new one. */
+//在后台线程中释放整个dict
+static void lazyfreeDict(dict *d) {
+#ifdef HAVE_ATOMIC
+    lazyfreeCreateJob(REDIS_LAZYFREE_DICT,d);
+#else
+    dictRelease(d);
+#endif
+}
+
+//返回还没有释放完成的任务个数
+static unsigned long lazyfreePendingJobs(long long *freed) {
+    unsigned long pending = 0;
+
+    if (freed) *freed = 0;
+#ifdef HAVE_ATOMIC
+    pthread_mutex_lock(&server.lazyfree_mutex);
+    pending = server.lazyfree_pending;
+    if (freed) *freed = server.stat_lazyfreed_objects;
+    pthread_mutex_unlock(&server.lazyfree_mutex);
+#endif
+    return pending;
+}
+
+/* Check if the sds string 's' is the canonical decimal representation of
+ * a long: no spaces, no leading zeroes, no '+' sign, no overflow. */
+static int isStringRepresentableAsLong(sds s, long *longval) {
+    char buf[REDIS_LONGSTR_SIZE], *endptr;
+    long value;
+    int slen;
+
+    value = strtol(s, &endptr, 10);
+    if (endptr[0] != '\0') return REDIS_ERR;
+    slen = snprintf(buf,sizeof(buf),"%ld",value);
+    if (sdslen(s) != (unsigned)slen || memcmp(buf,s,slen)) return REDIS_ERR;
+    if (longval) *longval = value;
+    return REDIS_OK;
+}
+
+/* Try to encode a string object in order to save space. The returned
+ * object must be used in place of 'o':
+ *
+ * - If the value is in the range of the shared integers the reference to
+ *   'o' is released and the shared object is returned instead.
+ * - Otherwise if 'o' is not referenced elsewhere it is integer encoded in
+ *   place (the ptr field changes meaning, so shared objects are skipped).
+ * - Otherwise 'o' is returned untouched. */
+//尝试将字符串对象编码为整数以节省内存，返回值用来替换o
+static robj *tryObjectEncoding(robj *o) {
+    long value;
+    sds s = o->ptr;
+
+    if (o->type != REDIS_STRING || !sdsEncodedObject(o))
+        return o; /* Already encoded, or not a string */
+
+    /* 20 chars are enough for any 64 bit long with the sign */
+    if (sdslen(s) > 20 || isStringRepresentableAsLong(s,&value) == REDIS_ERR)
+        return o;
+
+    if (value >= 0 && value < server.sharedintegers) {
+        decrRefCount(o);
+        incrRefCount(shared.integers[value]);
+        return shared.integers[value];
+    }
+    if (o->refcount > 1) return o; /* Shared object */
+    if (o->encoding == REDIS_ENCODING_EMBSTR) {
+        /* The string lives inside the object, so the object can't be
+         * converted in place. A bare integer object is smaller anyway. */
+        decrRefCount(o);
+        return createStringObjectFromLongLong(value);
+    }
+    o->encoding = REDIS_ENCODING_INT;
+    sdsfree(o->ptr);
+    o->ptr = (void*) value;
+    return o;
+}
+
+/* Try to store the string value 'o' LZF compressed. Only raw strings longer
+ * than 'compressthreshold' not referenced elsewhere are compressed, and the
+ * compressed version is kept only if it saves at least 1/4 of the space.
+ * The object is converted in place.
+ *
+ * Only values of the key space are compressed: list elements, set members
+ * and keys are never REDIS_ENCODING_LZF objects, so code handling them is
+ * free to use stringObjectBytes(). The compressed value is inflated on the
+ * fly by getDecodedObject() when addReply() or SORT BY need the bytes. */
+//尝试使用LZF压缩保存较长的字符串值
+static void tryObjectCompression(robj *o) {
+    redisLzfString *lzs;
+    size_t len, outlen, clen;
+
+    if (!server.compressthreshold || o->type != REDIS_STRING ||
+        o->encoding != REDIS_ENCODING_RAW || o->refcount > 1) return;
+    len = sdslen(o->ptr);
+    if (len <= server.compressthreshold || len > UINT32_MAX) return;
+
+    outlen = len-len/4;
+    if ((lzs = zmalloc(sizeof(*lzs)+outlen)) == NULL) return;
+    clen = lzf_compress(o->ptr,len,lzs->data,outlen);
+    if (clen == 0) {
+        zfree(lzs);
+        server.stat_lzf_uncompressible++;
+        return;
+    }
+    if ((lzs = zrealloc(lzs,sizeof(*lzs)+clen)) == NULL) oom("zrealloc");
+    lzs->len = len;
+    lzs->clen = clen;
+    sdsfree(o->ptr);
+    o->ptr = lzs;
+    o->encoding = REDIS_ENCODING_LZF;
+    server.stat_lzf_compressed++;
+    server.stat_lzf_rawbytes += len;
+    server.stat_lzf_compressedbytes += clen;
+}
+
+/* Get a decoded version of an encoded object (returned as a new object).
+ * If the object is already raw-encoded just increment the ref count. */
+//返回对象的sds表示，使用后需要decrRefCount
+static robj *getDecodedObject(robj *o) {
+    if (sdsEncodedObject(o)) {
+        incrRefCount(o);
+        return o;
+    }
+    assert(o->type == REDIS_STRING);
+    if (o->encoding == REDIS_ENCODING_LZF) {
+        redisLzfString *lzs = o->ptr;
+        robj *dec = createStringObject(NULL,lzs->len);
+
+        if (lzf_decompress(lzs->data,lzs->clen,dec->ptr,lzs->len) != lzs->len)
+            assert(0 != 0); /* Corrupted in memory value */
+        server.stat_lzf_decompressions++;
+        return dec;
+    }
+    assert(o->encoding == REDIS_ENCODING_INT);
+    return createObject(REDIS_STRING,
+        sdscatprintf(sdsempty(),"%ld",(long)o->ptr));
+}
+
+/* Return a pointer to the bytes of the string object 'o', setting *len to
+ * the string length. Integer encoded objects are formatted into 'buf', that
+ * must be at least REDIS_LONGSTR_SIZE bytes. No allocation is performed, so
+ * LZF compressed values must be decoded with getDecodedObject() instead. */
+static char *stringObjectBytes(robj *o, char *buf, size_t *len) {
+    if (sdsEncodedObject(o)) {
+        *len = sdslen(o->ptr);
+        return o->ptr;
+    }
+    assert(o->encoding == REDIS_ENCODING_INT);
+    *len = snprintf(buf,REDIS_LONGSTR_SIZE,"%ld",(long)o->ptr);
+    return buf;
+}
+
+//返回字符串对象的长度
+static size_t stringObjectLen(robj *o) {
+    char buf[REDIS_LONGSTR_SIZE];
+    size_t len;
+
+    if (o->encoding == REDIS_ENCODING_LZF)
+        return ((redisLzfString*)o->ptr)->len;
+    stringObjectBytes(o,buf,&len);
+    return len;
+}
+
+/* Compare two string objects like sdscmp() does on their string
+ * representations. */
+static int compareStringObjects(robj *a, robj *b) {
+    char bufa[REDIS_LONGSTR_SIZE], bufb[REDIS_LONGSTR_SIZE];
+    size_t alen, blen, minlen;
+    char *astr, *bstr;
+    int cmp;
+
+    if (a == b) return 0;
+    astr = stringObjectBytes(a,bufa,&alen);
+    bstr = stringObjectBytes(b,bufb,&blen);
+    minlen = (alen < blen) ? alen : blen;
+    cmp = memcmp(astr,bstr,minlen);
+    if (cmp == 0) return (alen < blen) ? -1 : (alen > blen);
+    return cmp;
+}
+
+//返回编码方式的名字
+static char *strEncoding(int encoding) {
+    switch(encoding) {
+    case REDIS_ENCODING_RAW: return "raw";
+    case REDIS_ENCODING_INT: return "int";
+    case REDIS_ENCODING_EMBSTR: return "embstr";
+    case REDIS_ENCODING_LZF: return "lzf";
+    case REDIS_ENCODING_QUICKLIST: return "quicklist";
+    case REDIS_ENCODING_ZIPLIST: return "ziplist";
+    case REDIS_ENCODING_HT: return "hashtable";
+    case REDIS_ENCODING_INTSET: return "intset";
+    case REDIS_ENCODING_SKIPLIST: return "skiplist";
+    default: return "unknown";
     }
 }
 
@@ -1884,7 +3096,15 @@ static robj *lookupKeyWrite(redisDb *db, robj *key) {
 }
 
 static int deleteKey(redisDb *db, robj *key) {
+    return deleteKeyGeneric(db,key,1);
+}
+
+/* Remove 'key' from the DB. If 'lazy' is true the value is released with
+ * lazyfreeObject(), so big values are freed by the lazy free thread. */
+//删除key，lazy为真时大对象在后台释放
+static int deleteKeyGeneric(redisDb *db, robj *key, int lazy) {
     int retval;
+    robj *val = NULL;
 
     /* We need to protect key from destruction: after the first dictDelete()
      * it may happen that 'key' is no longer valid if we don't increment
@@ -1892,12 +3112,54 @@ static int deleteKey(redisDb *db, robj *key) {
      * from the hash table with dictRandomKey() or dict iterators */
     incrRefCount(key);
     if (dictSize(db->expires)) dictDelete(db->expires,key);
-    retval = dictDelete(db->dict,key);
-    decrRefCount(key);
+    if (lazy && server.lazyfreethreshold) {
+        dictEntry *de = dictFind(db->dict,key);
+
+        /* Take a reference so that dictDelete() does not free the value */
+        if (de) {
+            val = dictGetEntryVal(de);
+            incrRefCount(val);
+        }
+    }
+    retval = dictDelete(db->dict,key);
+    if (val) lazyfreeObject(val);
+    decrRefCount(key);
 
     return retval == DICT_OK;
 }
 
+/* Set 'val' as the value of the existing 'key', like dictReplace() does,
+ * releasing the old value with lazyfreeObject(). As with dictReplace() the
+ * caller is in charge of incrementing the reference count of 'val'. */
+//覆盖已经存在的key的值，旧值可能在后台释放
+static void dbOverwrite(redisDb *db, robj *key, robj *val) {
+    dictEntry *de = dictFind(db->dict,key);
+    robj *old;
+
+    assert(de != NULL);
+    old = dictGetEntryVal(de);
+    dictGetEntryVal(de) = val;
+    lazyfreeObject(old);
+}
+
+/* Commands modifying a string value in place (SETBIT, PFADD, ...) need a
+ * raw sds that nobody else references: 'o', the value stored at 'key', is
+ * returned as it is if it is already so, otherwise it is replaced by a
+ * private raw copy of integer encoded, LZF compressed, embedded or shared
+ * values, that is returned. */
+//确保key的字符串值可以原地修改，必要时替换为一个raw编码的拷贝
+static robj *dbUnshareStringValue(redisDb *db, robj *key, robj *o) {
+    robj *dec;
+
+    assert(o->type == REDIS_STRING);
+    if (o->encoding == REDIS_ENCODING_RAW && o->refcount == 1) return o;
+    dec = getDecodedObject(o);
+    o = createObject(REDIS_STRING,sdsnewlen(dec->ptr,sdslen(dec->ptr)));
+    decrRefCount(dec);
+    dbOverwrite(db,key,o);
+    return o;
+}
+
 /*============================ DB saving/loading ============================ */
 //数据类型保存到文件
 static int rdbSaveType(FILE *fp, unsigned char type) {
@@ -1937,22 +3199,8 @@ static int rdbSaveLen(FILE *fp, uint32_t len) {
 /* String objects in the form "2391" "-100" without any space and with a
  * range of values that can fit in an 8, 16 or 32 bit signed value can be
  * encoded as integers to save space */
- //用于尝试将一个字符串（SDS 类型，即 Redis 中的动态字符串）编码为一个整数，并确定其适合的整数编码类型（8位、16位、32位）
-static int rdbTryIntegerEncoding(sds s, unsigned char *enc) {
-    long long value;
-    char *endptr, buf[32];
-
-    /* Check if it's possible to encode this value as a number */
-    value = strtoll(s, &endptr, 10);
-    if (endptr[0] != '\0') return 0;
-    snprintf(buf,32,"%lld",value);
-
-    /* If the number converted back into a string is not identical
-     * then it's not possible to encode the string as integer */
-     //接下来，函数将转换得到的 value 再次转换回字符串，并与原 SDS 字符串进行比较。如果转换后的字符串长度与原 SDS 字符串长度不同，或者内容不完全一致，则返回 0
-    if (strlen(buf) != sdslen(s) || memcmp(buf,s,sdslen(s))) return 0;
-    //在确认原字符串可以安全地解释为整数后，函数接下来检查这个整数是否适合用 8 位、16 位或 32 位整数来表示。
-    /* Finally check if it fits in our ranges */
+ //将整数编码为8位、16位或32位，返回编码后的长度，放不下时返回0
+static int rdbEncodeInteger(long long value, unsigned char *enc) {
     if (value >= -(1<<7) && value <= (1<<7)-1) {
         enc[0] = (REDIS_RDB_ENCVAL<<6)|REDIS_RDB_ENC_INT8;
         enc[1] = value&0xFF;
@@ -1973,6 +3221,25 @@ static int rdbTryIntegerEncoding(sds s, unsigned char *enc) {
         return 0;
     }
 }
+
+//用于尝试将一个字符串（SDS 类型，即 Redis 中的动态字符串）编码为一个整数，并确定其适合的整数编码类型（8位、16位、32位）
+static int rdbTryIntegerEncoding(sds s, unsigned char *enc) {
+    long long value;
+    char *endptr, buf[32];
+
+    /* Check if it's possible to encode this value as a number */
+    value = strtoll(s, &endptr, 10);
+    if (endptr[0] != '\0') return 0;
+    snprintf(buf,32,"%lld",value);
+
+    /* If the number converted back into a string is not identical
+     * then it's not possible to encode the string as integer */
+     //接下来，函数将转换得到的 value 再次转换回字符串，并与原 SDS 字符串进行比较。如果转换后的字符串长度与原 SDS 字符串长度不同，或者内容不完全一致，则返回 0
+    if (strlen(buf) != sdslen(s) || memcmp(buf,s,sdslen(s))) return 0;
+    //在确认原字符串可以安全地解释为整数后，函数接下来检查这个整数是否适合用 8 位、16 位或 32 位整数来表示。
+    /* Finally check if it fits in our ranges */
+    return rdbEncodeInteger(value,enc);
+}
 //用于将字符串对象（robj 类型的 obj）使用 LZF 压缩算法压缩后保存到文件中的函数。
 static int rdbSaveLzfStringObject(FILE *fp, robj *obj) {
     unsigned int comprlen, outlen;
@@ -2004,7 +3271,7 @@ writeerr:
 
 /* Save a string objet as [len][data] on disk. If the object is a string
  * representation of an integer value we try to safe it in a special form */
-static int rdbSaveStringObject(FILE *fp, robj *obj) {
+static int rdbSaveRawStringObject(FILE *fp, robj *obj) {
     size_t len = sdslen(obj->ptr);
     int enclen;
 
@@ -2034,6 +3301,56 @@ static int rdbSaveStringObject(FILE *fp, robj *obj) {
     return 0;
 }
 
+/* Like rdbSaveRawStringObject() but handles encoded objects. Integer
+ * encoded objects are written in the on disk integer encoding directly,
+ * without going through the string representation. */
+static int rdbSaveStringObject(FILE *fp, robj *obj) {
+    int retval;
+
+    if (obj->encoding == REDIS_ENCODING_INT) {
+        unsigned char buf[5];
+        int enclen = rdbEncodeInteger((long)obj->ptr,buf);
+
+        if (enclen > 0) return (fwrite(buf,enclen,1,fp) == 0) ? -1 : 0;
+    } else if (obj->encoding == REDIS_ENCODING_LZF) {
+        /* Already compressed: use the on disk LZF format as it is */
+        redisLzfString *lzs = obj->ptr;
+        unsigned char byte = (REDIS_RDB_ENCVAL<<6)|REDIS_RDB_ENC_LZF;
+
+        if (fwrite(&byte,1,1,fp) == 0) return -1;
+        if (rdbSaveLen(fp,lzs->clen) == -1) return -1;
+        if (rdbSaveLen(fp,lzs->len) == -1) return -1;
+        if (fwrite(lzs->data,lzs->clen,1,fp) == 0) return -1;
+        return 0;
+    }
+    obj = getDecodedObject(obj);
+    retval = rdbSaveRawStringObject(fp,obj);
+    decrRefCount(obj);
+    return retval;
+}
+
+/* Save a double value. Doubles are saved as strings prefixed by a one byte
+ * length, the special lengths 253, 254 and 255 are used to store NaN, +inf
+ * and -inf without any string. */
+static int rdbSaveDoubleValue(FILE *fp, double val) {
+    unsigned char buf[128];
+    int len;
+
+    if (isnan(val)) {
+        buf[0] = 253;
+        len = 1;
+    } else if (!isfinite(val)) {
+        buf[0] = (val < 0) ? 255 : 254;
+        len = 1;
+    } else {
+        snprintf((char*)buf+1,sizeof(buf)-1,"%.17g",val);
+        buf[0] = strlen((char*)buf+1);
+        len = buf[0]+1;
+    }
+    if (fwrite(buf,len,1,fp) == 0) return -1;
+    return 0;
+}
+
 /* Save the DB on disk. Return REDIS_ERR on error, REDIS_OK on success */
 static int rdbSave(char *filename) {
     dictIterator *di = NULL;
@@ -2049,7 +3366,7 @@ static int rdbSave(char *filename) {
         redisLog(REDIS_WARNING, "Failed saving the DB: %s", strerror(errno));
         return REDIS_ERR;
     }
-    if (fwrite("REDIS0001",9,1,fp) == 0) goto werr;
+    if (fwrite("REDIS0002",9,1,fp) == 0) goto werr;
     for (j = 0; j < server.dbnum; j++) {
         redisDb *db = server.db+j;
         dict *d = db->dict;
@@ -2064,6 +3381,13 @@ static int rdbSave(char *filename) {
         if (rdbSaveType(fp,REDIS_SELECTDB) == -1) goto werr;//数据类型保存到文件
         if (rdbSaveLen(fp,j) == -1) goto werr;//对不同大小的uint32_t进行保存
 
+        /* Write the RESIZEDB opcode with the number of keys and volatile
+         * keys, so that rdbLoad() can size the hash tables just one time
+         * instead of growing them by doubling while loading. */
+        if (rdbSaveType(fp,REDIS_RESIZEDB) == -1) goto werr;
+        if (rdbSaveLen(fp,dictSize(d)) == -1) goto werr;
+        if (rdbSaveLen(fp,dictSize(db->expires)) == -1) goto werr;
+
         /* Iterate this DB writing every entry */
         while((de = dictNext(di)) != NULL) {
             robj *key = dictGetEntryKey(de);//获取key
@@ -2084,31 +3408,72 @@ static int rdbSave(char *filename) {
                 /* Save a string value */
                 if (rdbSaveStringObject(fp,o) == -1) goto werr;
             } else if (o->type == REDIS_LIST) {
-                /* Save a list value */
-                list *list = o->ptr;
-                listNode *ln;
-
-                listRewind(list);//将链表中的迭代器变为正向迭代器
-                if (rdbSaveLen(fp,listLength(list)) == -1) goto werr;//保存链表格式
-                while((ln = listYield(list))) {
-                    robj *eleobj = listNodeValue(ln);
-
-                    if (rdbSaveStringObject(fp,eleobj) == -1) goto werr;//保存字符串
+                /* Save a list value. The on disk format does not depend on
+                 * the encoding. */
+                listTypeIterator li;
+                listTypeEntry entry;
+
+                if (rdbSaveLen(fp,listTypeLength(o)) == -1) goto werr;
+                listTypeInitIterator(&li,o,0,REDIS_TAIL);
+                while(listTypeNext(&li,&entry)) {
+                    robj *eleobj = listTypeGet(&entry);
+
+                    if (rdbSaveStringObject(fp,eleobj) == -1) {
+                        decrRefCount(eleobj);
+                        goto werr;
+                    }
+                    decrRefCount(eleobj);
                 }
             } else if (o->type == REDIS_SET) {//集合一个key对应多个value,key已经在上面保存过了
-                /* Save a set value */
-                dict *set = o->ptr;
-                dictIterator *di = dictGetIterator(set);
-                dictEntry *de;
-
-                if (!set) oom("dictGetIteraotr");
-                if (rdbSaveLen(fp,dictSize(set)) == -1) goto werr;
-                while((de = dictNext(di)) != NULL) {
-                    robj *eleobj = dictGetEntryKey(de);
-
-                    if (rdbSaveStringObject(fp,eleobj) == -1) goto werr;
+                /* Save a set value. Intsets are saved element by element
+                 * like hash tables, the format does not depend on the
+                 * encoding. */
+                setTypeIterator si;
+                robj *eleobj;
+
+                if (rdbSaveLen(fp,setTypeSize(o)) == -1) goto werr;
+                setTypeInitIterator(&si,o);
+                while((eleobj = setTypeNext(&si)) != NULL) {
+                    if (rdbSaveStringObject(fp,eleobj) == -1) {
+                        decrRefCount(eleobj);
+                        setTypeReleaseIterator(&si);
+                        goto werr;
+                    }
+                    decrRefCount(eleobj);
+                }
+                setTypeReleaseIterator(&si);
+            } else if (o->type == REDIS_ZSET) {
+                /* Save a sorted set value as members followed by their
+                 * score, in skiplist order */
+                zskiplistNode *ln = ((zset*)o->ptr)->zsl->header;
+
+                if (rdbSaveLen(fp,((zset*)o->ptr)->zsl->length) == -1)
+                    goto werr;
+                while((ln = ln->level[0].forward) != NULL) {
+                    if (rdbSaveStringObject(fp,ln->obj) == -1) goto werr;
+                    if (rdbSaveDoubleValue(fp,ln->score) == -1) goto werr;
+                }
+            } else if (o->type == REDIS_HASH) {
+                /* Save a hash value as the number of fields followed by
+                 * fields and values, whatever the encoding */
+                hashTypeIterator hi;
+
+                if (rdbSaveLen(fp,hashTypeLength(o)) == -1) goto werr;
+                hashTypeInitIterator(&hi,o);
+                while(hashTypeNext(&hi)) {
+                    robj *field = hashTypeCurrent(&hi,0);
+                    robj *value = hashTypeCurrent(&hi,1);
+                    int err = rdbSaveStringObject(fp,field) == -1 ||
+                              rdbSaveStringObject(fp,value) == -1;
+
+                    decrRefCount(field);
+                    decrRefCount(value);
+                    if (err) {
+                        hashTypeReleaseIterator(&hi);
+                        goto werr;
+                    }
                 }
-                dictReleaseIterator(di);
+                hashTypeReleaseIterator(&hi);
             } else {
                 assert(0 != 0);
             }
@@ -2228,7 +3593,7 @@ static uint32_t rdbLoadLen(FILE *fp, int rdbver, int *isencoded) {
     }
 }
 //创建int类型变量
-static robj *rdbLoadIntegerObject(FILE *fp, int enctype) {
+static robj *rdbLoadIntegerObject(FILE *fp, int enctype, int encode) {
     unsigned char enc[4];
     long long val;
 
@@ -2249,32 +3614,36 @@ static robj *rdbLoadIntegerObject(FILE *fp, int enctype) {
         val = 0; /* anti-warning */
         assert(0!=0);
     }
+    if (encode) return createStringObjectFromLongLong(val);
     return createObject(REDIS_STRING,sdscatprintf(sdsempty(),"%lld",val));
 }
 //创建字符串
 static robj *rdbLoadLzfStringObject(FILE*fp, int rdbver) {
     unsigned int len, clen;
     unsigned char *c = NULL;
-    sds val = NULL;
+    robj *o = NULL;
 
     if ((clen = rdbLoadLen(fp,rdbver,NULL)) == REDIS_RDB_LENERR) return NULL;
     if ((len = rdbLoadLen(fp,rdbver,NULL)) == REDIS_RDB_LENERR) return NULL;
     if ((c = zmalloc(clen)) == NULL) goto err;
-    if ((val = sdsnewlen(NULL,len)) == NULL) goto err;
+    o = createStringObject(NULL,len);
     if (fread(c,clen,1,fp) == 0) goto err;
-    if (lzf_decompress(c,clen,val,len) == 0) goto err;
+    if (lzf_decompress(c,clen,o->ptr,len) == 0) goto err;
     zfree(c);
-    return createObject(REDIS_STRING,val);
+    return o;
 err:
     zfree(c);
-    sdsfree(val);
+    if (o) decrRefCount(o);
     return NULL;
 }
+/* Load a string object. If 'encode' is true integers are returned as
+ * integer encoded objects, possibly shared (used for values and list/set
+ * elements), otherwise the object is always a plain sds string (keys). */
 //创建字符串robj，根据是否压缩然后判断保存为int还是string，如果没压缩则完全读取。
-static robj *rdbLoadStringObject(FILE*fp, int rdbver) {
+static robj *rdbGenericLoadStringObject(FILE*fp, int rdbver, int encode) {
     int isencoded;
     uint32_t len;
-    sds val;
+    robj *o;
 
     len = rdbLoadLen(fp,rdbver,&isencoded);//读取一个长度，如果isencoded=1说明下一个是string转化的int
     if (isencoded) {
@@ -2282,7 +3651,8 @@ static robj *rdbLoadStringObject(FILE*fp, int rdbver) {
         case REDIS_RDB_ENC_INT8://8 16 32都执行rdbLoadIntegerObject，因为没有break
         case REDIS_RDB_ENC_INT16:
         case REDIS_RDB_ENC_INT32:
-            return tryObjectSharing(rdbLoadIntegerObject(fp,len));
+            if (encode) return rdbLoadIntegerObject(fp,len,1);
+            return tryObjectSharing(rdbLoadIntegerObject(fp,len,0));
         case REDIS_RDB_ENC_LZF:
             return tryObjectSharing(rdbLoadLzfStringObject(fp,rdbver));  //使用共享池哈希表，共享robj对象,基于引用计数的原理
         default:
@@ -2291,12 +3661,44 @@ static robj *rdbLoadStringObject(FILE*fp, int rdbver) {
     }
 
     if (len == REDIS_RDB_LENERR) return NULL;
-    val = sdsnewlen(NULL,len);
-    if (len && fread(val,len,1,fp) == 0) {
-        sdsfree(val);
+    /* Read the string directly inside the (possibly embedded) object */
+    o = createStringObject(NULL,len);
+    if (len && fread(o->ptr,len,1,fp) == 0) {
+        decrRefCount(o);
         return NULL;
     }
-    return tryObjectSharing(createObject(REDIS_STRING,val));
+    /* Numbers not fitting the 32 bit on disk encoding are saved verbatim */
+    if (encode) {
+        o = tryObjectEncoding(o);
+        if (o->encoding == REDIS_ENCODING_INT) return o;
+    }
+    return tryObjectSharing(o);
+}
+
+static robj *rdbLoadStringObject(FILE*fp, int rdbver) {
+    return rdbGenericLoadStringObject(fp,rdbver,0);
+}
+
+static robj *rdbLoadEncodedStringObject(FILE*fp, int rdbver) {
+    return rdbGenericLoadStringObject(fp,rdbver,1);
+}
+
+/* Load a double value saved by rdbSaveDoubleValue() */
+static int rdbLoadDoubleValue(FILE *fp, double *val) {
+    char buf[256];
+    unsigned char len;
+
+    if (fread(&len,1,1,fp) == 0) return -1;
+    switch(len) {
+    case 255: *val = -INFINITY; return 0;
+    case 254: *val = INFINITY; return 0;
+    case 253: *val = NAN; return 0;
+    default:
+        if (fread(buf,len,1,fp) == 0) return -1;
+        buf[len] = '\0';
+        *val = strtod(buf,NULL);
+        return 0;
+    }
 }
 
 static int rdbLoad(char *filename) {
@@ -2319,7 +3721,7 @@ static int rdbLoad(char *filename) {
         return REDIS_ERR;
     }
     rdbver = atoi(buf+5);
-    if (rdbver > 1) {
+    if (rdbver > 2) {
         fclose(fp);
         redisLog(REDIS_WARNING,"Can't handle RDB format version %d",rdbver);
         return REDIS_ERR;
@@ -2347,30 +3749,119 @@ static int rdbLoad(char *filename) {
             d = db->dict;
             continue;
         }
+        /* RESIZEDB opcode: presize the tables of the selected DB */
+        if (type == REDIS_RESIZEDB) {
+            uint32_t dbsize, expiressize;
+
+            if ((dbsize = rdbLoadLen(fp,rdbver,NULL)) == REDIS_RDB_LENERR)
+                goto eoferr;
+            if ((expiressize = rdbLoadLen(fp,rdbver,NULL)) == REDIS_RDB_LENERR)
+                goto eoferr;
+            if (dbsize > dictSlots(d)) dictExpand(d,dbsize);
+            if (expiressize > dictSlots(db->expires))
+                dictExpand(db->expires,expiressize);
+            continue;
+        }
         /* Read key */
         if ((keyobj = rdbLoadStringObject(fp,rdbver)) == NULL) goto eoferr;
 
         if (type == REDIS_STRING) {
             /* Read string value */
-            if ((o = rdbLoadStringObject(fp,rdbver)) == NULL) goto eoferr;
+            if ((o = rdbLoadEncodedStringObject(fp,rdbver)) == NULL) goto eoferr;
+            tryObjectCompression(o);
         } else if (type == REDIS_LIST || type == REDIS_SET) {
             /* Read list/set value */
             uint32_t listlen;
 
             if ((listlen = rdbLoadLen(fp,rdbver,NULL)) == REDIS_RDB_LENERR)
                 goto eoferr;
-            o = (type == REDIS_LIST) ? createListObject() : createSetObject();
+            /* Small lists are loaded as ziplists, they are converted
+             * while loading if an element is too long */
+            if (type == REDIS_LIST)
+                o = (listlen <= server.listmaxziplistentries) ?
+                    createZiplistObject() : createQuicklistObject();
+            else
+                o = (listlen <= server.setmaxintsetentries) ?
+                    createIntsetObject() : createSetObject();
+            /* The set length is known in advance, so resize the hash table
+             * just one time */
+            if (type == REDIS_SET && o->encoding == REDIS_ENCODING_HT &&
+                listlen > DICT_HT_INITIAL_SIZE)
+                dictExpand(o->ptr,listlen);
             /* Load every single element of the list/set */
             while(listlen--) {
                 robj *ele;
 
-                if ((ele = rdbLoadStringObject(fp,rdbver)) == NULL) goto eoferr;
+                if ((ele = rdbLoadEncodedStringObject(fp,rdbver)) == NULL) goto eoferr;
                 if (type == REDIS_LIST) {
-                    if (!listAddNodeTail((list*)o->ptr,ele))
-                        oom("listAddNodeTail");
-                } else {
+                    listTypePush(o,ele,REDIS_TAIL);
+                    decrRefCount(ele);
+                } else if (o->encoding == REDIS_ENCODING_HT) {
                     if (dictAdd((dict*)o->ptr,ele,NULL) == DICT_ERR)
                         oom("dictAdd");
+                } else {
+                    /* Converted to a hash table by the first non integer */
+                    ele = tryObjectEncoding(ele);
+                    setTypeAdd(o,ele);
+                    decrRefCount(ele);
+                }
+            }
+        } else if (type == REDIS_ZSET) {
+            /* Read sorted set value */
+            uint32_t zsetlen;
+            zset *zs;
+
+            if ((zsetlen = rdbLoadLen(fp,rdbver,NULL)) == REDIS_RDB_LENERR)
+                goto eoferr;
+            o = createZsetObject();
+            zs = o->ptr;
+            if (zsetlen > DICT_HT_INITIAL_SIZE) dictExpand(zs->dict,zsetlen);
+            /* Load every member with its score. The skiplist takes the
+             * reference returned by the load function. */
+            while(zsetlen--) {
+                robj *ele;
+                double score;
+
+                if ((ele = rdbLoadEncodedStringObject(fp,rdbver)) == NULL) goto eoferr;
+                if (rdbLoadDoubleValue(fp,&score) == -1) goto eoferr;
+                if (dictAdd(zs->dict,ele,zslInsert(zs->zsl,score,ele)) == DICT_ERR)
+                    oom("dictAdd");
+            }
+        } else if (type == REDIS_HASH) {
+            /* Read hash value. Small hashes are loaded as ziplists and
+             * converted while loading if a field or value is too long. */
+            uint32_t hashlen;
+
+            if ((hashlen = rdbLoadLen(fp,rdbver,NULL)) == REDIS_RDB_LENERR)
+                goto eoferr;
+            o = createHashObject();
+            if (hashlen > server.hashmaxziplistentries) {
+                hashTypeConvert(o);
+                if (hashlen > DICT_HT_INITIAL_SIZE) dictExpand(o->ptr,hashlen);
+            }
+            while(hashlen--) {
+                robj *field, *value;
+
+                if ((field = rdbLoadEncodedStringObject(fp,rdbver)) == NULL) goto eoferr;
+                if ((value = rdbLoadEncodedStringObject(fp,rdbver)) == NULL) goto eoferr;
+                if (o->encoding == REDIS_ENCODING_ZIPLIST &&
+                    (stringObjectLen(field) > server.hashmaxziplistvalue ||
+                     stringObjectLen(value) > server.hashmaxziplistvalue))
+                    hashTypeConvert(o);
+                if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+                    char buf[REDIS_LONGSTR_SIZE], *s;
+                    size_t len;
+
+                    /* Fields are unique, just append them */
+                    s = stringObjectBytes(field,buf,&len);
+                    o->ptr = ziplistPush(o->ptr,(unsigned char*)s,len,ZIPLIST_TAIL);
+                    s = stringObjectBytes(value,buf,&len);
+                    o->ptr = ziplistPush(o->ptr,(unsigned char*)s,len,ZIPLIST_TAIL);
+                    decrRefCount(field);
+                    decrRefCount(value);
+                } else {
+                    if (dictAdd((dict*)o->ptr,field,value) == DICT_ERR)
+                        oom("dictAdd");
                 }
             }
         } else {
@@ -2418,8 +3909,7 @@ static void pingCommand(redisClient *c) {
 }
 
 static void echoCommand(redisClient *c) {
-    addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",
-        (int)sdslen(c->argv[1]->ptr)));
+    addReplyBulkLen(c,c->argv[1]);
     addReply(c,c->argv[1]);
     addReply(c,shared.crlf);
 }
@@ -2429,10 +3919,12 @@ static void echoCommand(redisClient *c) {
 static void setGenericCommand(redisClient *c, int nx) {//nx为1,插入会失败
     int retval;
 
+    c->argv[2] = tryObjectEncoding(c->argv[2]);
+    tryObjectCompression(c->argv[2]);
     retval = dictAdd(c->db->dict,c->argv[1],c->argv[2]);//向Hash表中增加键值
     if (retval == DICT_ERR) {
         if (!nx) {
-            dictReplace(c->db->dict,c->argv[1],c->argv[2]);
+            dbOverwrite(c->db,c->argv[1],c->argv[2]);
             incrRefCount(c->argv[2]);
         } else {
             addReply(c,shared.czero);
@@ -2464,7 +3956,7 @@ static void getCommand(redisClient *c) {
         if (o->type != REDIS_STRING) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",(int)sdslen(o->ptr)));//告诉接受长度
+            addReplyBulkLen(c,o);//告诉接受长度
             addReply(c,o);
             addReply(c,shared.crlf);
         }
@@ -2473,8 +3965,10 @@ static void getCommand(redisClient *c) {
 //得到key保存的value，并更新
 static void getSetCommand(redisClient *c) {
     getCommand(c);
+    c->argv[2] = tryObjectEncoding(c->argv[2]);
+    tryObjectCompression(c->argv[2]);
     if (dictAdd(c->db->dict,c->argv[1],c->argv[2]) == DICT_ERR) {
-        dictReplace(c->db->dict,c->argv[1],c->argv[2]);
+        dbOverwrite(c->db,c->argv[1],c->argv[2]);
     } else {
         incrRefCount(c->argv[1]);
     }
@@ -2495,7 +3989,7 @@ static void mgetCommand(redisClient *c) {
             if (o->type != REDIS_STRING) {
                 addReply(c,shared.nullbulk);
             } else {
-                addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",(int)sdslen(o->ptr)));
+                addReplyBulkLen(c,o);
                 addReply(c,o);
                 addReply(c,shared.crlf);
             }
@@ -2514,26 +4008,36 @@ static void incrDecrCommand(redisClient *c, long long incr) {
     } else {
         if (o->type != REDIS_STRING) {
             value = 0;
+        } else if (o->encoding == REDIS_ENCODING_INT) {
+            value = (long)o->ptr;
         } else {
-            char *eptr;
+            robj *dec = getDecodedObject(o);
 
-            value = strtoll(o->ptr, &eptr, 10);
+            value = strtoll(dec->ptr, NULL, 10);
+            decrRefCount(dec);
         }
     }
 
     value += incr;
-    o = createObject(REDIS_STRING,sdscatprintf(sdsempty(),"%lld",value));
-    retval = dictAdd(c->db->dict,c->argv[1],o);
-    if (retval == DICT_ERR) {
-        dictReplace(c->db->dict,c->argv[1],o);
+    if (o && o->type == REDIS_STRING && o->encoding == REDIS_ENCODING_INT &&
+        o->refcount == 1 && value >= LONG_MIN && value <= LONG_MAX)
+    {
+        /* The counter is not referenced elsewhere: update it in place.
+         * Like dictReplace() would do we remove the expire. */
+        o->ptr = (void*)((long)value);
         removeExpire(c->db,c->argv[1]);
     } else {
-        incrRefCount(c->argv[1]);
+        o = createStringObjectFromLongLong(value);
+        retval = dictAdd(c->db->dict,c->argv[1],o);
+        if (retval == DICT_ERR) {
+            dictReplace(c->db->dict,c->argv[1],o);
+            removeExpire(c->db,c->argv[1]);
+        } else {
+            incrRefCount(c->argv[1]);
+        }
     }
     server.dirty++;
-    addReply(c,shared.colon);
-    addReply(c,o);
-    addReply(c,shared.crlf);
+    addReplySds(c,sdscatprintf(sdsempty(),":%lld\r\n",value));
 }
 //+1
 static void incrCommand(redisClient *c) {
@@ -2651,22 +4155,29 @@ static void lastsaveCommand(redisClient *c) {
         sdscatprintf(sdsempty(),":%lu\r\n",server.lastsave));
 }
 //查看key类型
+//返回类型的名字
+static char *typeName(int type) {
+    switch(type) {
+    case REDIS_STRING: return "string";
+    case REDIS_LIST: return "list";
+    case REDIS_SET: return "set";
+    case REDIS_HASH: return "hash";
+    case REDIS_ZSET: return "zset";
+    default: return "unknown";
+    }
+}
+
 static void typeCommand(redisClient *c) {
     robj *o;
     char *type;
 
     o = lookupKeyRead(c->db,c->argv[1]);
     if (o == NULL) {
-        type = "+none";
+        type = "none";
     } else {
-        switch(o->type) {
-        case REDIS_STRING: type = "+string"; break;
-        case REDIS_LIST: type = "+list"; break;
-        case REDIS_SET: type = "+set"; break;
-        default: type = "unknown"; break;
-        }
+        type = typeName(o->type);
     }
-    addReplySds(c,sdsnew(type));
+    addReplySds(c,sdscatprintf(sdsempty(),"+%s",type));
     addReply(c,shared.crlf);
 }
 //保存rdb
@@ -2743,7 +4254,7 @@ static void renameGenericCommand(redisClient *c, int nx) {
             addReply(c,shared.czero);
             return;
         }
-        dictReplace(c->db->dict,c->argv[2],o);
+        dbOverwrite(c->db,c->argv[2],o);
     } else {
         incrRefCount(c->argv[2]);
     }
@@ -2805,36 +4316,250 @@ static void moveCommand(redisClient *c) {
 }
 
 /* =================================== Lists ================================ */
-static void pushGenericCommand(redisClient *c, int where) {
-    robj *lobj;
-    list *list;
 
-    lobj = lookupKeyWrite(c->db,c->argv[1]);
-    if (lobj == NULL) {
-        lobj = createListObject();
-        list = lobj->ptr;
-        if (where == REDIS_HEAD) {
-            if (!listAddNodeHead(list,c->argv[2])) oom("listAddNodeHead");
-        } else {
-            if (!listAddNodeTail(list,c->argv[2])) oom("listAddNodeTail");
+/* Lists are stored as a ziplist (REDIS_ENCODING_ZIPLIST) while they have at
+ * most 'listmaxziplistentries' elements and no element is longer than
+ * 'listmaxziplistvalue' bytes, and as a quicklist (REDIS_ENCODING_QUICKLIST)
+ * otherwise, that is a linked list of ziplists of up to the same number of
+ * elements, see quicklist.c. A ziplist holds the elements back to back
+ * (integers are stored as integers), so both the encodings cost a few bytes
+ * per element, and big lists can be accessed by index skipping whole nodes.
+ * The conversion is one way only: once a list is a quicklist it stays a
+ * quicklist.
+ *
+ * The listType*() functions hide the encoding to the commands. Elements
+ * returned as objects are new references the caller has to release. */
+
+/* Create an object holding the ziplist element at 'p' */
+//用ziplist中p指向的元素创建一个字符串对象
+static robj *ziplistEntryObject(unsigned char *p) {
+    unsigned char *vstr;
+    unsigned int vlen;
+    long long vlong;
+
+    ziplistGet(p,&vstr,&vlen,&vlong);
+    if (vstr) return createStringObject((char*)vstr,vlen);
+    return createStringObjectFromLongLong(vlong);
+}
+
+/* Send the ziplist element at 'p' as a bulk reply. The whole reply is built
+ * in a single sds, there is no need to create an object for the element. */
+//将ziplist中p指向的元素作为bulk回复发送
+static void addReplyZiplistEntry(redisClient *c, unsigned char *p) {
+    unsigned char *vstr;
+    unsigned int vlen;
+    long long vlong;
+    char buf[REDIS_LONGSTR_SIZE];
+    sds reply;
+
+    ziplistGet(p,&vstr,&vlen,&vlong);
+    if (!vstr) {
+        vlen = snprintf(buf,sizeof(buf),"%lld",vlong);
+        vstr = (unsigned char*)buf;
+    }
+    reply = sdscatprintf(sdsempty(),"$%u\r\n",vlen);
+    reply = sdscatlen(reply,vstr,vlen);
+    reply = sdscatlen(reply,"\r\n",2);
+    addReplySds(c,reply);
+}
+
+/* Convert the list to a quicklist if 'value' does not fit a ziplist */
+//如果value太长则将ziplist转换为quicklist
+static void listTypeTryConversion(robj *subject, robj *value) {
+    if (subject->encoding != REDIS_ENCODING_ZIPLIST) return;
+    if (sdsEncodedObject(value) &&
+        sdslen(value->ptr) > server.listmaxziplistvalue)
+        listTypeConvert(subject,REDIS_ENCODING_QUICKLIST);
+}
+
+/* Convert a ziplist encoded list to 'enc'. This is O(1): the ziplist just
+ * becomes the first node of the quicklist. */
+//将ziplist编码的list转换为enc编码
+static void listTypeConvert(robj *subject, int enc) {
+    quicklist *ql;
+
+    assert(subject->encoding == REDIS_ENCODING_ZIPLIST &&
+           enc == REDIS_ENCODING_QUICKLIST);
+    ql = quicklistCreate(server.listmaxziplistentries);
+    quicklistAppendZiplist(ql,subject->ptr);
+    subject->ptr = ql;
+    subject->encoding = REDIS_ENCODING_QUICKLIST;
+}
+
+/* Add 'value' at the head or tail of the list, converting the list to a
+ * quicklist first if the ziplist limits would be exceeded */
+//在list的头部或者尾部添加value
+static void listTypePush(robj *subject, robj *value, int where) {
+    char buf[REDIS_LONGSTR_SIZE], *s;
+    size_t len;
+
+    listTypeTryConversion(subject,value);
+    if (subject->encoding == REDIS_ENCODING_ZIPLIST &&
+        ziplistLen(subject->ptr) >= server.listmaxziplistentries)
+        listTypeConvert(subject,REDIS_ENCODING_QUICKLIST);
+
+    s = stringObjectBytes(value,buf,&len);
+    if (subject->encoding == REDIS_ENCODING_ZIPLIST) {
+        subject->ptr = ziplistPush(subject->ptr,(unsigned char*)s,len,
+            (where == REDIS_HEAD) ? ZIPLIST_HEAD : ZIPLIST_TAIL);
+    } else {
+        quicklistPush(subject->ptr,(unsigned char*)s,len,
+            (where == REDIS_HEAD) ? QUICKLIST_HEAD : QUICKLIST_TAIL);
+    }
+}
+
+/* Remove and return the head or tail element, NULL if the list is empty */
+//弹出list头部或者尾部的元素
+static robj *listTypePop(robj *subject, int where) {
+    robj *value = NULL;
+
+    if (subject->encoding == REDIS_ENCODING_ZIPLIST) {
+        unsigned char *p;
+
+        p = ziplistIndex(subject->ptr,(where == REDIS_HEAD) ? 0 : -1);
+        if (p) {
+            value = ziplistEntryObject(p);
+            subject->ptr = ziplistDelete(subject->ptr,&p);
         }
-        dictAdd(c->db->dict,c->argv[1],lobj);
-        incrRefCount(c->argv[1]);
-        incrRefCount(c->argv[2]);
     } else {
-        if (lobj->type != REDIS_LIST) {
-            addReply(c,shared.wrongtypeerr);
-            return;
+        quicklistEntry entry;
+
+        if (quicklistIndex(subject->ptr,(where == REDIS_HEAD) ? 0 : -1,
+                           &entry))
+        {
+            value = ziplistEntryObject(entry.zi);
+            quicklistDelIndex(subject->ptr,&entry);
         }
-        list = lobj->ptr;
-        if (where == REDIS_HEAD) {
-            if (!listAddNodeHead(list,c->argv[2])) oom("listAddNodeHead");
-        } else {
-            if (!listAddNodeTail(list,c->argv[2])) oom("listAddNodeTail");
+    }
+    return value;
+}
+
+//list的元素个数
+static unsigned long listTypeLength(robj *subject) {
+    if (subject->encoding == REDIS_ENCODING_ZIPLIST)
+        return ziplistLen(subject->ptr);
+    return quicklistCount((quicklist*)subject->ptr);
+}
+
+/* Return the element at 'index' inside its ziplist, NULL if out of range */
+//获取index位置的元素
+static unsigned char *listTypeIndex(robj *subject, int index) {
+    quicklistEntry entry;
+
+    if (subject->encoding == REDIS_ENCODING_ZIPLIST)
+        return ziplistIndex(subject->ptr,index);
+    if (!quicklistIndex(subject->ptr,index,&entry)) return NULL;
+    return entry.zi;
+}
+
+/* Initialize an iterator starting at 'index', moving towards the tail when
+ * 'direction' is REDIS_TAIL, towards the head when it is REDIS_HEAD */
+//初始化list的迭代器
+static void listTypeInitIterator(listTypeIterator *li, robj *subject,
+                                 int index, int direction)
+{
+    li->subject = subject;
+    li->encoding = subject->encoding;
+    li->direction = direction;
+    li->zi = NULL;
+    if (li->encoding == REDIS_ENCODING_ZIPLIST)
+        li->zi = ziplistIndex(subject->ptr,index);
+    else
+        quicklistInitIterator(&li->iter,subject->ptr,index,
+            (direction == REDIS_TAIL) ? QUICKLIST_TAIL : QUICKLIST_HEAD);
+}
+
+/* Store the current element in 'entry' and advance the iterator. Returns 0
+ * when there are no more elements. */
+//获取迭代器当前的元素并前进
+static int listTypeNext(listTypeIterator *li, listTypeEntry *entry) {
+    entry->li = li;
+    if (li->encoding == REDIS_ENCODING_ZIPLIST) {
+        entry->zi = li->zi;
+        if (entry->zi == NULL) return 0;
+        li->zi = (li->direction == REDIS_TAIL) ?
+            ziplistNext(li->subject->ptr,li->zi) :
+            ziplistPrev(li->subject->ptr,li->zi);
+    } else {
+        if (!quicklistNext(&li->iter,&entry->entry)) return 0;
+        entry->zi = entry->entry.zi;
+    }
+    return 1;
+}
+
+/* Return the element of 'entry' as an object (a new reference) */
+//获取entry的元素
+static robj *listTypeGet(listTypeEntry *entry) {
+    return ziplistEntryObject(entry->zi);
+}
+
+//判断entry的元素是否等于o
+static int listTypeEqual(listTypeEntry *entry, robj *o) {
+    char buf[REDIS_LONGSTR_SIZE], *s;
+    size_t len;
+
+    s = stringObjectBytes(o,buf,&len);
+    return ziplistCompare(entry->zi,(unsigned char*)s,len);
+}
+
+/* Delete the element of 'entry'. The iterator can be used to go on with
+ * the iteration: the ziplist may have been reallocated, so the position of
+ * the next element is computed again. */
+//删除entry的元素，迭代器仍然可用
+static void listTypeDelete(listTypeEntry *entry) {
+    listTypeIterator *li = entry->li;
+
+    if (li->encoding == REDIS_ENCODING_ZIPLIST) {
+        unsigned char *p = entry->zi;
+        int hasnext = li->zi != NULL;
+
+        li->subject->ptr = ziplistDelete(li->subject->ptr,&p);
+        /* 'p' now points to the element that followed the deleted one */
+        if (!hasnext)
+            li->zi = NULL;
+        else if (li->direction == REDIS_TAIL)
+            li->zi = p;
+        else
+            li->zi = ziplistPrev(li->subject->ptr,p);
+    } else {
+        quicklistDelEntry(&li->iter,&entry->entry);
+    }
+}
+
+/* LPUSH/RPUSH key value1 value2 ... valueN: the elements are pushed one
+ * after the other, so LPUSH stores them in reverse order. */
+static void pushGenericCommand(redisClient *c, int where) {
+    robj *lobj;
+    int j, pushed = 2;
+
+    lobj = lookupKeyWrite(c->db,c->argv[1]);
+    if (lobj != NULL && lobj->type != REDIS_LIST) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    for (j = 2; j < c->argc; j++) {
+        robj *ele = c->argv[j];
+
+        /* If a client is blocked waiting for this key the element is
+         * handed to it directly, and the dataset is not modified */
+        if (handleClientsWaitingListPush(c,c->argv[1],ele)) continue;
+        if (lobj == NULL) {
+            lobj = createZiplistObject();
+            dictAdd(c->db->dict,c->argv[1],lobj);
+            incrRefCount(c->argv[1]);
         }
-        incrRefCount(c->argv[2]);
+        listTypePush(lobj,ele,where);
+        server.dirty++;
+        /* Keep the pushed elements at the start of argv, in order */
+        c->argv[j] = c->argv[pushed];
+        c->argv[pushed++] = ele;
+    }
+    /* If some elements were handed to blocked clients only the others are
+     * replicated. When no element was pushed nothing is replicated. */
+    if (pushed > 2 && pushed < c->argc) {
+        for (j = pushed; j < c->argc; j++) decrRefCount(c->argv[j]);
+        c->argc = pushed;
     }
-    server.dirty++;
     addReply(c,shared.ok);
 }
 //lpush
@@ -2848,7 +4573,6 @@ static void rpushCommand(redisClient *c) {
 //list长度
 static void llenCommand(redisClient *c) {
     robj *o;
-    list *l;
 
     o = lookupKeyRead(c->db,c->argv[1]);
     if (o == NULL) {
@@ -2858,8 +4582,8 @@ static void llenCommand(redisClient *c) {
         if (o->type != REDIS_LIST) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            l = o->ptr;
-            addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",listLength(l)));
+            addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",
+                listTypeLength(o)));
         }
     }
 }
@@ -2875,18 +4599,12 @@ static void lindexCommand(redisClient *c) {
         if (o->type != REDIS_LIST) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            list *list = o->ptr;
-            listNode *ln;
+            unsigned char *p = listTypeIndex(o,index);
 
-            ln = listIndex(list, index);//返回index位置的节点
-            if (ln == NULL) {
+            if (p == NULL)
                 addReply(c,shared.nullbulk);
-            } else {
-                robj *ele = listNodeValue(ln);
-                addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",(int)sdslen(ele->ptr)));
-                addReply(c,ele);
-                addReply(c,shared.crlf);
-            }
+            else
+                addReplyZiplistEntry(c,p);
         }
     }
 }
@@ -2894,6 +4612,8 @@ static void lindexCommand(redisClient *c) {
 static void lsetCommand(redisClient *c) {
     robj *o;
     int index = atoi(c->argv[2]->ptr);
+    char buf[REDIS_LONGSTR_SIZE], *s;
+    size_t len;
 
     o = lookupKeyWrite(c->db,c->argv[1]);
     if (o == NULL) {
@@ -2901,23 +4621,32 @@ static void lsetCommand(redisClient *c) {
     } else {
         if (o->type != REDIS_LIST) {
             addReply(c,shared.wrongtypeerr);
-        } else {
-            list *list = o->ptr;
-            listNode *ln;
+            return;
+        }
+        listTypeTryConversion(o,c->argv[3]);
+        s = stringObjectBytes(c->argv[3],buf,&len);
+        if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+            unsigned char *p = ziplistIndex(o->ptr,index);
 
-            ln = listIndex(list, index);
-            if (ln == NULL) {
+            if (p == NULL) {
                 addReply(c,shared.outofrangeerr);
-            } else {
-                robj *ele = listNodeValue(ln);
+                return;
+            }
+            /* Replace the element: delete it and insert the new one in the
+             * same position */
+            o->ptr = ziplistDelete(o->ptr,&p);
+            o->ptr = ziplistInsert(o->ptr,p,(unsigned char*)s,len);
+        } else {
+            quicklistEntry entry;
 
-                decrRefCount(ele);
-                listNodeValue(ln) = c->argv[3];//获取链表当前节点的值(注意此处获取的指针)
-                incrRefCount(c->argv[3]);
-                addReply(c,shared.ok);
-                server.dirty++;
+            if (!quicklistIndex(o->ptr,index,&entry)) {
+                addReply(c,shared.outofrangeerr);
+                return;
             }
+            quicklistReplaceEntry(o->ptr,&entry,(unsigned char*)s,len);
         }
+        addReply(c,shared.ok);
+        server.dirty++;
     }
 }
 
@@ -2931,22 +4660,15 @@ static void popGenericCommand(redisClient *c, int where) {
         if (o->type != REDIS_LIST) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            list *list = o->ptr;
-            listNode *ln;
-
-            if (where == REDIS_HEAD)
-                ln = listFirst(list);
-            else
-                ln = listLast(list);
+            robj *ele = listTypePop(o,where);
 
-            if (ln == NULL) {
+            if (ele == NULL) {
                 addReply(c,shared.nullbulk);
             } else {
-                robj *ele = listNodeValue(ln);
-                addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",(int)sdslen(ele->ptr)));
+                addReplyBulkLen(c,ele);
                 addReply(c,ele);
                 addReply(c,shared.crlf);
-                listDelNode(list,ln);
+                decrRefCount(ele);
                 server.dirty++;
             }
         }
@@ -2960,6 +4682,190 @@ static void lpopCommand(redisClient *c) {
 static void rpopCommand(redisClient *c) {
     popGenericCommand(c,REDIS_TAIL);
 }
+
+/* Blocking pops. BLPOP/BRPOP key1 key2 ... keyN timeout pop an element from
+ * the first non empty list among the given keys. If all the lists are empty
+ * the client is blocked: it is added to the FIFO of waiting clients of every
+ * key in c->db->blockingkeys, and the first LPUSH/RPUSH against one of the
+ * keys hands the new element directly to the client that is waiting since
+ * more time. A timeout greater than zero registers a time event that
+ * unblocks the client with a nil reply, zero means forever.
+ *
+ * An element popped without blocking is replicated as the equivalent
+ * LPOP/RPOP. An element handed to a waiting client never enters the list,
+ * so in this case neither the push nor the pop are replicated. */
+
+/* Replace the command the client is executing with 'argv' (new references
+ * now owned by the client, the arguments vector grows if needed), so that
+ * processCommand() replicates it instead of the original command. */
+//把客户端正在执行的命令改写为argv
+static void rewriteClientCommand(redisClient *c, int argc, robj **argv) {
+    int j;
+
+    if (argc > c->argc) {
+        c->argv = zrealloc(c->argv,sizeof(robj*)*argc);
+        if (c->argv == NULL) oom("rewriteClientCommand");
+    }
+    freeClientArgv(c);
+    for (j = 0; j < argc; j++) c->argv[j] = argv[j];
+    c->argc = argc;
+    c->cmd = lookupCommand(argv[0]->ptr);
+    assert(c->cmd != NULL);
+}
+
+//阻塞超时的定时器回调函数，回复nil并解除阻塞
+static int blockedClientTimeout(struct aeEventLoop *eventLoop, long long id, void *clientData) {
+    redisClient *c = clientData;
+    REDIS_NOTUSED(eventLoop);
+    REDIS_NOTUSED(id);
+
+    c->blocktimer = -1; /* The time event is deleted by the event loop */
+    addReply(c,shared.nullmultibulk);
+    unblockClient(c);
+    return AE_NOMORE;
+}
+
+/* Block the client waiting for a push against one of the 'numkeys' keys */
+//阻塞客户端，等待keys中的任意一个key被push
+static void blockForKeys(redisClient *c, robj **keys, int numkeys, time_t timeout, int where) {
+    dictEntry *de;
+    list *l;
+    int j;
+
+    c->blockingkeys = zmalloc(sizeof(robj*)*numkeys);
+    if (c->blockingkeys == NULL) oom("blockForKeys");
+    c->blockingkeysnum = 0;
+    c->blockingwhere = where;
+    for (j = 0; j < numkeys; j++) {
+        /* The same key may be given more than once */
+        de = dictFind(c->db->blockingkeys,keys[j]);
+        if (de) {
+            l = dictGetEntryVal(de);
+            if (listSearchKey(l,c)) continue;
+        } else {
+            l = listCreate();
+            if (l == NULL || dictAdd(c->db->blockingkeys,keys[j],l) != DICT_OK)
+                oom("blockForKeys");
+            incrRefCount(keys[j]);
+        }
+        if (!listAddNodeTail(l,c)) oom("listAddNodeTail");
+        c->blockingkeys[c->blockingkeysnum++] = keys[j];
+        incrRefCount(keys[j]);
+    }
+    if (timeout > 0) {
+        c->blocktimer = aeCreateTimeEvent(server.el,(long long)timeout*1000,
+            blockedClientTimeout,c,NULL);
+        if (c->blocktimer == AE_ERR) oom("blockForKeys");
+    }
+    c->flags |= REDIS_BLOCKED;
+    server.blockedclients++;
+}
+
+/* Remove the client from the FIFOs of all the keys it is waiting for and
+ * queue it so that beforeSleep() processes its pending commands */
+//解除客户端的阻塞状态
+static void unblockClient(redisClient *c) {
+    dictEntry *de;
+    listNode *ln;
+    list *l;
+    int j;
+
+    for (j = 0; j < c->blockingkeysnum; j++) {
+        de = dictFind(c->db->blockingkeys,c->blockingkeys[j]);
+        assert(de != NULL);
+        l = dictGetEntryVal(de);
+        ln = listSearchKey(l,c);
+        assert(ln != NULL);
+        listDelNode(l,ln);
+        if (listLength(l) == 0)
+            dictDelete(c->db->blockingkeys,c->blockingkeys[j]);
+        decrRefCount(c->blockingkeys[j]);
+    }
+    zfree(c->blockingkeys);
+    c->blockingkeys = NULL;
+    c->blockingkeysnum = 0;
+    if (c->blocktimer != -1) {
+        aeDeleteTimeEvent(server.el,c->blocktimer);
+        c->blocktimer = -1;
+    }
+    c->flags &= ~REDIS_BLOCKED;
+    c->flags |= REDIS_UNBLOCKED;
+    if (!listAddNodeTail(server.unblocked_clients,c)) oom("listAddNodeTail");
+    server.blockedclients--;
+}
+
+/* Called by LPUSH/RPUSH: if some client is waiting for 'key' the element is
+ * sent to the one that is waiting since more time and 1 is returned, the
+ * caller must not add the element to the list. Otherwise 0 is returned. */
+//如果有客户端在等待key，直接把ele交给等待最久的客户端
+static int handleClientsWaitingListPush(redisClient *c, robj *key, robj *ele) {
+    dictEntry *de;
+    redisClient *receiver;
+    list *l;
+
+    de = dictFind(c->db->blockingkeys,key);
+    if (de == NULL) return 0;
+    l = dictGetEntryVal(de);
+    receiver = listNodeValue(listFirst(l));
+
+    addReplySds(receiver,sdsnew("*2\r\n"));
+    addReplyBulkLen(receiver,key);
+    addReply(receiver,key);
+    addReply(receiver,shared.crlf);
+    addReplyBulkLen(receiver,ele);
+    addReply(receiver,ele);
+    addReply(receiver,shared.crlf);
+    unblockClient(receiver);
+    return 1;
+}
+
+static void blockingPopGenericCommand(redisClient *c, int where) {
+    robj *o;
+    int j, timeout = atoi(c->argv[c->argc-1]->ptr);
+
+    if (timeout < 0) {
+        addReplySds(c,sdsnew("-ERR timeout is negative\r\n"));
+        return;
+    }
+    for (j = 1; j < c->argc-1; j++) {
+        o = lookupKeyWrite(c->db,c->argv[j]);
+        if (o == NULL) continue;
+        if (o->type != REDIS_LIST) {
+            addReply(c,shared.wrongtypeerr);
+            return;
+        }
+        if (listTypeLength(o) != 0) {
+            robj *ele = listTypePop(o,where), *argv[2];
+
+            addReplySds(c,sdsnew("*2\r\n"));
+            addReplyBulkLen(c,c->argv[j]);
+            addReply(c,c->argv[j]);
+            addReply(c,shared.crlf);
+            addReplyBulkLen(c,ele);
+            addReply(c,ele);
+            addReply(c,shared.crlf);
+            decrRefCount(ele);
+            server.dirty++;
+
+            /* Replicate as LPOP/RPOP key */
+            argv[0] = createStringObject(where == REDIS_HEAD ? "lpop" : "rpop",4);
+            argv[1] = c->argv[j];
+            incrRefCount(argv[1]);
+            rewriteClientCommand(c,2,argv);
+            return;
+        }
+    }
+    /* All the lists are empty or missing: block */
+    blockForKeys(c,c->argv+1,c->argc-2,timeout,where);
+}
+//阻塞的lpop
+static void blpopCommand(redisClient *c) {
+    blockingPopGenericCommand(c,REDIS_HEAD);
+}
+//阻塞的rpop
+static void brpopCommand(redisClient *c) {
+    blockingPopGenericCommand(c,REDIS_TAIL);
+}
 //在list中获取下标left-right的值
 static void lrangeCommand(redisClient *c) {
     robj *o;
@@ -2973,11 +4879,10 @@ static void lrangeCommand(redisClient *c) {
         if (o->type != REDIS_LIST) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            list *list = o->ptr;
-            listNode *ln;
-            int llen = listLength(list);
+            listTypeIterator li;
+            listTypeEntry entry;
+            int llen = listTypeLength(o);
             int rangelen, j;
-            robj *ele;
 
             /* convert negative indexes */
             if (start < 0) start = llen+start;
@@ -2995,15 +4900,10 @@ static void lrangeCommand(redisClient *c) {
             rangelen = (end-start)+1;
 
             /* Return the result in form of a multi-bulk reply */
-            ln = listIndex(list, start);
             addReplySds(c,sdscatprintf(sdsempty(),"*%d\r\n",rangelen));
-            for (j = 0; j < rangelen; j++) {
-                ele = listNodeValue(ln);
-                addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",(int)sdslen(ele->ptr)));
-                addReply(c,ele);
-                addReply(c,shared.crlf);
-                ln = ln->next;
-            }
+            listTypeInitIterator(&li,o,start,REDIS_TAIL);
+            for (j = 0; j < rangelen && listTypeNext(&li,&entry); j++)
+                addReplyZiplistEntry(c,entry.zi);
         }
     }
 }
@@ -3020,10 +4920,8 @@ static void ltrimCommand(redisClient *c) {
         if (o->type != REDIS_LIST) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            list *list = o->ptr;
-            listNode *ln;
-            int llen = listLength(list);
-            int j, ltrim, rtrim;
+            int llen = listTypeLength(o);
+            int ltrim, rtrim;
 
             /* convert negative indexes */
             if (start < 0) start = llen+start;
@@ -3042,14 +4940,29 @@ static void ltrimCommand(redisClient *c) {
                 rtrim = llen-end-1;
             }
 
-            /* Remove list elements to perform the trim */
-            for (j = 0; j < ltrim; j++) {
-                ln = listFirst(list);
-                listDelNode(list,ln);
-            }
-            for (j = 0; j < rtrim; j++) {
-                ln = listLast(list);
-                listDelNode(list,ln);
+            /* Remove list elements to perform the trim. When many nodes
+             * of a quicklist are removed they are just moved to a new
+             * quicklist, that is released by the lazy free thread. */
+            if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+                o->ptr = ziplistDeleteRange(o->ptr,0,ltrim);
+                o->ptr = ziplistDeleteRange(o->ptr,-rtrim,rtrim);
+            } else {
+                quicklist *ql = o->ptr;
+
+                if (server.lazyfreethreshold && llen &&
+                    (double)(ltrim+rtrim)*quicklistNodeCount(ql)/llen >
+                    server.lazyfreethreshold)
+                {
+                    robj *trimmed = createQuicklistObject();
+
+                    ltrim -= quicklistMoveNodes(ql,trimmed->ptr,
+                                                QUICKLIST_HEAD,ltrim);
+                    rtrim -= quicklistMoveNodes(ql,trimmed->ptr,
+                                                QUICKLIST_TAIL,rtrim);
+                    lazyfreeObject(trimmed);
+                }
+                quicklistDelRange(ql,0,ltrim);
+                quicklistDelRange(ql,-rtrim,rtrim);
             }
             server.dirty++;
             addReply(c,shared.ok);
@@ -3069,28 +4982,24 @@ static void lremCommand(redisClient *c) {
         if (o->type != REDIS_LIST) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            list *list = o->ptr;
-            listNode *ln, *next;
+            listTypeIterator li;
+            listTypeEntry entry;
             int toremove = atoi(c->argv[2]->ptr);
             int removed = 0;
-            int fromtail = 0;
 
             if (toremove < 0) {
                 toremove = -toremove;
-                fromtail = 1;
+                listTypeInitIterator(&li,o,-1,REDIS_HEAD);
+            } else {
+                listTypeInitIterator(&li,o,0,REDIS_TAIL);
             }
-            ln = fromtail ? list->tail : list->head;
-            while (ln) {
-                robj *ele = listNodeValue(ln);
-
-                next = fromtail ? ln->prev : ln->next;
-                if (sdscmp(ele->ptr,c->argv[3]->ptr) == 0) {
-                    listDelNode(list,ln);
+            while (listTypeNext(&li,&entry)) {
+                if (listTypeEqual(&entry,c->argv[3])) {
+                    listTypeDelete(&entry);
                     server.dirty++;
                     removed++;
                     if (toremove && removed == toremove) break;
                 }
-                ln = next;
             }
             addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",removed));
         }
@@ -3098,13 +5007,202 @@ static void lremCommand(redisClient *c) {
 }
 
 /* ==================================== Sets ================================ */
-//set中增加一个key
+
+/* Sets made only of integers are intsets (a sorted array of integers) as
+ * long as they have at most 'setmaxintsetentries' elements, otherwise hash
+ * tables of objects. The setType*() functions hide the encoding to the
+ * commands. */
+
+/* Like isStringRepresentableAsLong() for a string object of any encoding */
+//判断字符串对象是否可以表示为long
+static int isObjectRepresentableAsLong(robj *o, long *longval) {
+    if (o->encoding == REDIS_ENCODING_INT) {
+        if (longval) *longval = (long) o->ptr;
+        return REDIS_OK;
+    }
+    if (!sdsEncodedObject(o) || sdslen(o->ptr) > 20) return REDIS_ERR;
+    return isStringRepresentableAsLong(o->ptr,longval);
+}
+
+/* Create an empty set able to hold 'value': an intset if it is an integer */
+//创建一个能保存value的空set
+static robj *setTypeCreate(robj *value) {
+    if (isObjectRepresentableAsLong(value,NULL) == REDIS_OK)
+        return createIntsetObject();
+    return createSetObject();
+}
+
+/* Convert an intset encoded set to a hash table */
+//将intset编码的set转换为哈希表
+static void setTypeConvert(robj *subject, int enc) {
+    intset *is = subject->ptr;
+    dict *d;
+    int64_t value;
+    uint32_t j;
+
+    assert(subject->encoding == REDIS_ENCODING_INTSET &&
+           enc == REDIS_ENCODING_HT);
+    d = dictCreate(&setDictType,NULL);
+    if (!d) oom("dictCreate");
+    /* The size is known, so the table is resized just one time */
+    if (intsetLen(is) > DICT_HT_INITIAL_SIZE) dictExpand(d,intsetLen(is));
+    for (j = 0; intsetGet(is,j,&value); j++) {
+        if (dictAdd(d,createStringObjectFromLongLong(value),NULL) != DICT_OK)
+            oom("dictAdd");
+    }
+    zfree(is);
+    subject->ptr = d;
+    subject->encoding = REDIS_ENCODING_HT;
+}
+
+/* Add 'value' to the set, converting it to a hash table if the value is not
+ * an integer or the intset would be too big. Returns 1 if the element was
+ * added, 0 if it was already a member. */
+//向set中添加value，返回是否添加成功
+static int setTypeAdd(robj *subject, robj *value) {
+    long longval;
+
+    if (subject->encoding == REDIS_ENCODING_INTSET) {
+        if (isObjectRepresentableAsLong(value,&longval) == REDIS_OK) {
+            int success;
+
+            subject->ptr = intsetAdd(subject->ptr,longval,&success);
+            if (success && intsetLen(subject->ptr) > server.setmaxintsetentries)
+                setTypeConvert(subject,REDIS_ENCODING_HT);
+            return success;
+        }
+        setTypeConvert(subject,REDIS_ENCODING_HT);
+    }
+    if (dictAdd(subject->ptr,value,NULL) == DICT_OK) {
+        incrRefCount(value);
+        return 1;
+    }
+    return 0;
+}
+
+/* Remove 'value' from the set. Returns 1 if it was a member */
+//从set中删除value，返回是否删除成功
+static int setTypeRemove(robj *subject, robj *value) {
+    long longval;
+
+    if (subject->encoding == REDIS_ENCODING_INTSET) {
+        int success;
+
+        if (isObjectRepresentableAsLong(value,&longval) == REDIS_ERR)
+            return 0;
+        subject->ptr = intsetRemove(subject->ptr,longval,&success);
+        return success;
+    }
+    if (dictDelete(subject->ptr,value) == DICT_ERR) return 0;
+    if (htNeedsResize(subject->ptr)) dictResize(subject->ptr);
+    return 1;
+}
+
+//判断value是否是set的成员
+static int setTypeIsMember(robj *subject, robj *value) {
+    long longval;
+
+    if (subject->encoding == REDIS_ENCODING_INTSET) {
+        if (isObjectRepresentableAsLong(value,&longval) == REDIS_ERR)
+            return 0;
+        return intsetFind(subject->ptr,longval);
+    }
+    return dictFind(subject->ptr,value) != NULL;
+}
+
+//set的元素个数
+static unsigned long setTypeSize(robj *subject) {
+    if (subject->encoding == REDIS_ENCODING_INTSET)
+        return intsetLen(subject->ptr);
+    return dictSize((dict*)subject->ptr);
+}
+
+/* Return a random element (a new reference), NULL if the set is empty */
+//随机返回set中的一个元素
+static robj *setTypeRandomElement(robj *subject) {
+    dictEntry *de;
+
+    if (subject->encoding == REDIS_ENCODING_INTSET) {
+        if (intsetLen(subject->ptr) == 0) return NULL;
+        return createStringObjectFromLongLong(intsetRandom(subject->ptr));
+    }
+    if ((de = dictGetRandomKey(subject->ptr)) == NULL) return NULL;
+    incrRefCount(dictGetEntryKey(de));
+    return dictGetEntryKey(de);
+}
+
+/* Return a copy of the set */
+//复制一个set
+static robj *setTypeDup(robj *subject) {
+    robj *o;
+
+    if (subject->encoding == REDIS_ENCODING_INTSET) {
+        size_t len = intsetBlobLen(subject->ptr);
+        intset *is = zmalloc(len);
+
+        if (!is) oom("setTypeDup");
+        memcpy(is,subject->ptr,len);
+        o = createObject(REDIS_SET,is);
+        o->encoding = REDIS_ENCODING_INTSET;
+    } else {
+        setTypeIterator si;
+        robj *ele;
+
+        o = createSetObject();
+        dictExpand(o->ptr,setTypeSize(subject));
+        setTypeInitIterator(&si,subject);
+        while((ele = setTypeNext(&si)) != NULL) {
+            dictAdd(o->ptr,ele,NULL); /* The new reference is the set's */
+        }
+        setTypeReleaseIterator(&si);
+    }
+    return o;
+}
+
+/* The set can't be modified while it is iterated */
+//初始化set的迭代器
+static void setTypeInitIterator(setTypeIterator *si, robj *subject) {
+    si->subject = subject;
+    si->encoding = subject->encoding;
+    si->ii = 0;
+    si->di = NULL;
+    if (si->encoding == REDIS_ENCODING_HT) {
+        si->di = dictGetIterator(subject->ptr);
+        if (!si->di) oom("dictGetIterator");
+    }
+}
+
+/* Return the next element (a new reference), NULL when done */
+//获取迭代器的下一个元素
+static robj *setTypeNext(setTypeIterator *si) {
+    if (si->encoding == REDIS_ENCODING_INTSET) {
+        int64_t value;
+
+        if (!intsetGet(si->subject->ptr,si->ii,&value)) return NULL;
+        si->ii++;
+        return createStringObjectFromLongLong(value);
+    } else {
+        dictEntry *de = dictNext(si->di);
+
+        if (de == NULL) return NULL;
+        incrRefCount(dictGetEntryKey(de));
+        return dictGetEntryKey(de);
+    }
+}
+
+//释放set的迭代器
+static void setTypeReleaseIterator(setTypeIterator *si) {
+    if (si->di) dictReleaseIterator(si->di);
+}
+
+//set中增加一个或多个元素，返回新增的元素个数
 static void saddCommand(redisClient *c) {
     robj *set;
+    int j, added = 0;
 
     set = lookupKeyWrite(c->db,c->argv[1]);
     if (set == NULL) {
-        set = createSetObject();
+        set = setTypeCreate(c->argv[2]);
         dictAdd(c->db->dict,c->argv[1],set);
         incrRefCount(c->argv[1]);
     } else {
@@ -3113,17 +5211,17 @@ static void saddCommand(redisClient *c) {
             return;
         }
     }
-    if (dictAdd(set->ptr,c->argv[2],NULL) == DICT_OK) {
-        incrRefCount(c->argv[2]);
-        server.dirty++;
-        addReply(c,shared.cone);
-    } else {
-        addReply(c,shared.czero);
+    for (j = 2; j < c->argc; j++) {
+        c->argv[j] = tryObjectEncoding(c->argv[j]);
+        added += setTypeAdd(set,c->argv[j]);
     }
+    server.dirty += added;
+    addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",added));
 }
-//删除key
+//删除set中的一个或多个元素，返回删除的元素个数
 static void sremCommand(redisClient *c) {
     robj *set;
+    int j, removed = 0;
 
     set = lookupKeyWrite(c->db,c->argv[1]);
     if (set == NULL) {
@@ -3133,13 +5231,10 @@ static void sremCommand(redisClient *c) {
             addReply(c,shared.wrongtypeerr);
             return;
         }
-        if (dictDelete(set->ptr,c->argv[2]) == DICT_OK) {
-            server.dirty++;
-            if (htNeedsResize(set->ptr)) dictResize(set->ptr);
-            addReply(c,shared.cone);
-        } else {
-            addReply(c,shared.czero);
-        }
+        for (j = 2; j < c->argc; j++)
+            removed += setTypeRemove(set,c->argv[j]);
+        server.dirty += removed;
+        addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",removed));
     }
 }
 //将set a中元素x移到set b
@@ -3161,20 +5256,20 @@ static void smoveCommand(redisClient *c) {
         return;
     }
     /* Remove the element from the source set */
-    if (dictDelete(srcset->ptr,c->argv[3]) == DICT_ERR) {
+    if (!setTypeRemove(srcset,c->argv[3])) {
         /* Key not found in the src set! return zero */
         addReply(c,shared.czero);
         return;
     }
     server.dirty++;
     /* Add the element to the destination set */
+    c->argv[3] = tryObjectEncoding(c->argv[3]);
     if (!dstset) {
-        dstset = createSetObject();
+        dstset = setTypeCreate(c->argv[3]);
         dictAdd(c->db->dict,c->argv[2],dstset);
         incrRefCount(c->argv[2]);
     }
-    if (dictAdd(dstset->ptr,c->argv[3],NULL) == DICT_OK)
-        incrRefCount(c->argv[3]);
+    setTypeAdd(dstset,c->argv[3]);
     addReply(c,shared.cone);
 }
 //查看set a中是不是有元素x
@@ -3189,7 +5284,7 @@ static void sismemberCommand(redisClient *c) {
             addReply(c,shared.wrongtypeerr);
             return;
         }
-        if (dictFind(set->ptr,c->argv[2]))
+        if (setTypeIsMember(set,c->argv[2]))
             addReply(c,shared.cone);
         else
             addReply(c,shared.czero);
@@ -3198,7 +5293,6 @@ static void sismemberCommand(redisClient *c) {
 //求s的大小
 static void scardCommand(redisClient *c) {
     robj *o;
-    dict *s;
 
     o = lookupKeyRead(c->db,c->argv[1]);
     if (o == NULL) {
@@ -3208,57 +5302,278 @@ static void scardCommand(redisClient *c) {
         if (o->type != REDIS_SET) {
             addReply(c,shared.wrongtypeerr);
         } else {
-            s = o->ptr;
-            addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",
-                dictSize(s)));
+            addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",
+                setTypeSize(o)));
         }
     }
 }
-//SPOP命令用于从集合中随机移除一个元素
+/* SPOP key [count]. The popped elements are replicated as an SREM of the
+ * same elements, as the slaves would pick other random elements. */
+//SPOP命令用于从集合中随机移除一个或者count个元素
 static void spopCommand(redisClient *c) {
-    robj *set;
-    dictEntry *de;
+    robj *set, *ele, **argv;
+    unsigned long count, size, j, n = 0;
+    long value;
+    char *eptr;
+
+    if (c->argc > 3) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    if (c->argc == 3) {
+        errno = 0;
+        value = strtol(c->argv[2]->ptr,&eptr,10);
+        if (((char*)c->argv[2]->ptr)[0] == '\0' || *eptr != '\0' ||
+            errno == ERANGE)
+        {
+            addReplySds(c,sdsnew(
+                "-ERR value is not an integer or out of range\r\n"));
+            return;
+        }
+        if (value < 0) {
+            addReplySds(c,sdsnew("-ERR count can't be negative\r\n"));
+            return;
+        }
+        count = value;
+    } else {
+        count = 1;
+    }
 
     set = lookupKeyWrite(c->db,c->argv[1]);
     if (set == NULL) {
-        addReply(c,shared.nullbulk);
+        addReply(c,c->argc == 3 ? shared.emptymultibulk : shared.nullbulk);
+        return;
+    }
+    if (set->type != REDIS_SET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    size = setTypeSize(set);
+    if (count > size) count = size;
+    if (count == 0) {
+        addReply(c,c->argc == 3 ? shared.emptymultibulk : shared.nullbulk);
+        return;
+    }
+
+    argv = zmalloc(sizeof(robj*)*(count+2));
+    if (!argv) oom("spopCommand");
+    if (c->argc == 3)
+        addReplySds(c,sdscatprintf(sdsempty(),"*%lu\r\n",count));
+    if (count*REDIS_SETRANDOM_COPY_MUL > size) {
+        /* Popping most of the set: move the elements to keep to a new set,
+         * the elements left in the old one are the popped ones */
+        robj *keepset = createIntsetObject();
+        setTypeIterator si;
+        void *ptr;
+        unsigned char encoding;
+
+        for (j = 0; j < size-count; j++) {
+            ele = setTypeRandomElement(set);
+            setTypeRemove(set,ele);
+            setTypeAdd(keepset,ele);
+            decrRefCount(ele);
+        }
+        setTypeInitIterator(&si,set);
+        while((ele = setTypeNext(&si)) != NULL) argv[2+n++] = ele;
+        setTypeReleaseIterator(&si);
+        /* The old elements are released by the lazy free thread if many */
+        ptr = set->ptr;
+        encoding = set->encoding;
+        set->ptr = keepset->ptr;
+        set->encoding = keepset->encoding;
+        keepset->ptr = ptr;
+        keepset->encoding = encoding;
+        lazyfreeObject(keepset);
     } else {
-        if (set->type != REDIS_SET) {
-            addReply(c,shared.wrongtypeerr);
+        while(n < count) {
+            ele = setTypeRandomElement(set);
+            setTypeRemove(set,ele);
+            argv[2+n++] = ele;
+        }
+    }
+    for (j = 0; j < n; j++) {
+        addReplyBulkLen(c,argv[2+j]);
+        addReply(c,argv[2+j]);
+        addReply(c,shared.crlf);
+    }
+    server.dirty += n;
+
+    /* Replicate as SREM key element ... */
+    argv[0] = createStringObject("srem",4);
+    argv[1] = c->argv[1];
+    incrRefCount(argv[1]);
+    rewriteClientCommand(c,n+2,argv);
+    zfree(argv);
+}
+
+/* SRANDMEMBER key [count]. A positive count returns up to count distinct
+ * elements, a negative count returns -count elements that may repeat.
+ * Repeated elements are not bounded by the size of the set, so -count is
+ * limited to REDIS_SETRANDOM_MAX_REPEAT: otherwise a single command could
+ * queue a reply bigger than the available memory. */
+//随机返回set中的一个或者count个元素，不删除元素
+static void srandmemberCommand(redisClient *c) {
+    robj *set, *ele, *tmpset;
+    setTypeIterator si;
+    unsigned long count, size;
+    long value = 1;
+    char *eptr;
+    int unique = 1;
+
+    if (c->argc > 3) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    if (c->argc == 3) {
+        errno = 0;
+        value = strtol(c->argv[2]->ptr,&eptr,10);
+        if (((char*)c->argv[2]->ptr)[0] == '\0' || *eptr != '\0' ||
+            errno == ERANGE)
+        {
+            addReplySds(c,sdsnew(
+                "-ERR value is not an integer or out of range\r\n"));
+            return;
+        }
+        if (value < -REDIS_SETRANDOM_MAX_REPEAT) {
+            addReplySds(c,sdsnew("-ERR count is out of range\r\n"));
             return;
         }
-        de = dictGetRandomKey(set->ptr);
-        if (de == NULL) {
+    }
+    if (value < 0) unique = 0;
+    count = unique ? (unsigned long)value : -(unsigned long)value;
+
+    set = lookupKeyRead(c->db,c->argv[1]);
+    if (set == NULL) {
+        addReply(c,c->argc == 3 ? shared.emptymultibulk : shared.nullbulk);
+        return;
+    }
+    if (set->type != REDIS_SET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    size = setTypeSize(set);
+    if (c->argc == 2) {
+        ele = setTypeRandomElement(set);
+        if (ele == NULL) {
             addReply(c,shared.nullbulk);
         } else {
-            robj *ele = dictGetEntryKey(de);
+            addReplyBulkLen(c,ele);
+            addReply(c,ele);
+            addReply(c,shared.crlf);
+            decrRefCount(ele);
+        }
+        return;
+    }
+    if (count == 0 || size == 0) {
+        addReply(c,shared.emptymultibulk);
+        return;
+    }
 
-            addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",sdslen(ele->ptr)));
+    if (!unique) {
+        /* Elements may repeat: just pick count random elements */
+        addReplySds(c,sdscatprintf(sdsempty(),"*%lu\r\n",count));
+        while(count--) {
+            ele = setTypeRandomElement(set);
+            addReplyBulkLen(c,ele);
             addReply(c,ele);
             addReply(c,shared.crlf);
-            dictDelete(set->ptr,ele);
-            if (htNeedsResize(set->ptr)) dictResize(set->ptr);
-            server.dirty++;
+            decrRefCount(ele);
+        }
+        return;
+    }
+
+    if (count >= size) {
+        /* The whole set */
+        tmpset = set;
+        incrRefCount(tmpset);
+    } else if (count*REDIS_SETRANDOM_COPY_MUL > size) {
+        /* Most of the set: copy it, then remove random elements until
+         * count elements are left */
+        tmpset = setTypeDup(set);
+        while(setTypeSize(tmpset) > count) {
+            ele = setTypeRandomElement(tmpset);
+            setTypeRemove(tmpset,ele);
+            decrRefCount(ele);
+        }
+    } else {
+        /* A few elements: pick random elements until count distinct ones
+         * are found, few picks are wasted on duplicates */
+        tmpset = createSetObject();
+        while(setTypeSize(tmpset) < count) {
+            ele = setTypeRandomElement(set);
+            setTypeAdd(tmpset,ele);
+            decrRefCount(ele);
+        }
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),"*%lu\r\n",setTypeSize(tmpset)));
+    setTypeInitIterator(&si,tmpset);
+    while((ele = setTypeNext(&si)) != NULL) {
+        addReplyBulkLen(c,ele);
+        addReply(c,ele);
+        addReply(c,shared.crlf);
+        decrRefCount(ele);
+    }
+    setTypeReleaseIterator(&si);
+    decrRefCount(tmpset);
+}
+/* SINTER and SINTERSTORE when all the sets are intsets, sorted from the
+ * smallest to the largest. The result is an intset as well: it is stored
+ * as it is, or sent to the client in a single reply buffer. */
+//求多个intset的交集
+static void sinterIntsets(redisClient *c, robj **sv, int setsnum, robj *dstkey) {
+    intset *is = intsetIntersect(sv[0]->ptr,sv[1]->ptr);
+    int j;
+
+    for (j = 2; j < setsnum && intsetLen(is); j++) {
+        intset *tmp = intsetIntersect(is,sv[j]->ptr);
+
+        zfree(is);
+        is = tmp;
+    }
+    if (dstkey) {
+        robj *dstset = createObject(REDIS_SET,is);
+
+        dstset->encoding = REDIS_ENCODING_INTSET;
+        deleteKey(c->db,dstkey);
+        dictAdd(c->db->dict,dstkey,dstset);
+        incrRefCount(dstkey);
+        addReplySds(c,sdscatprintf(sdsempty(),":%u\r\n",intsetLen(is)));
+        server.dirty++;
+    } else {
+        sds reply = sdscatprintf(sdsempty(),"*%u\r\n",intsetLen(is));
+        char buf[REDIS_LONGSTR_SIZE];
+        int64_t value;
+        uint32_t i;
+
+        for (i = 0; intsetGet(is,i,&value); i++) {
+            int len = snprintf(buf,sizeof(buf),"%lld",(long long)value);
+
+            reply = sdscatprintf(reply,"$%d\r\n",len);
+            reply = sdscatlen(reply,buf,len);
+            reply = sdscatlen(reply,"\r\n",2);
         }
+        addReplySds(c,reply);
+        zfree(is);
     }
 }
+
 //比较函数
 static int qsortCompareSetsByCardinality(const void *s1, const void *s2) {
-    dict **d1 = (void*) s1, **d2 = (void*) s2;
+    robj **o1 = (void*) s1, **o2 = (void*) s2;
+    unsigned long l1 = setTypeSize(*o1), l2 = setTypeSize(*o2);
 
-    return dictSize(*d1)-dictSize(*d2);
+    return (l1 > l2) - (l1 < l2);
 }
 //这段代码实现了 Redis 中处理集合交集（SINTER）命令的通用逻辑，
 //它既可以用于计算多个集合的交集并将结果返回给客户端，也可以将结果存储到指定的键中。
 //该命令可以求多个set的交集
 static void sinterGenericCommand(redisClient *c, robj **setskeys, int setsnum, robj *dstkey) {
-    dict **dv = zmalloc(sizeof(dict*)*setsnum);//将多个集合储存在这个里面
-    dictIterator *di;
-    dictEntry *de;
-    robj *lenobj = NULL, *dstset = NULL;
+    robj **sv = zmalloc(sizeof(robj*)*setsnum);//将多个集合储存在这个里面
+    setTypeIterator si;
+    robj *ele, *lenobj = NULL, *dstset = NULL;
     int j, cardinality = 0;
 
-    if (!dv) oom("sinterGenericCommand");
+    if (!sv) oom("sinterGenericCommand");
     for (j = 0; j < setsnum; j++) {
         robj *setobj;
 
@@ -3266,7 +5581,7 @@ static void sinterGenericCommand(redisClient *c, robj **setskeys, int setsnum, r
                     lookupKeyWrite(c->db,setskeys[j]) :
                     lookupKeyRead(c->db,setskeys[j]);
         if (!setobj) {
-            zfree(dv);
+            zfree(sv);
             if (dstkey) {
                 deleteKey(c->db,dstkey);
                 addReply(c,shared.ok);
@@ -3276,15 +5591,26 @@ static void sinterGenericCommand(redisClient *c, robj **setskeys, int setsnum, r
             return;
         }
         if (setobj->type != REDIS_SET) {
-            zfree(dv);
+            zfree(sv);
             addReply(c,shared.wrongtypeerr);
             return;
         }
-        dv[j] = setobj->ptr;
+        sv[j] = setobj;
     }
     /* Sort sets from the smallest to largest, this will improve our
      * algorithm's performace */
-    qsort(dv,setsnum,sizeof(dict*),qsortCompareSetsByCardinality);
+    qsort(sv,setsnum,sizeof(robj*),qsortCompareSetsByCardinality);
+
+    /* Sets that are all intsets are intersected as sorted arrays, see
+     * intsetIntersect(), without looking up every element of the smallest
+     * set in the other ones */
+    for (j = 0; j < setsnum; j++)
+        if (sv[j]->encoding != REDIS_ENCODING_INTSET) break;
+    if (setsnum > 1 && j == setsnum) {
+        sinterIntsets(c,sv,setsnum,dstkey);
+        zfree(sv);
+        return;
+    }
 
     /* The first thing we should output is the total number of elements...
      * since this is a multi-bulk write, but at this stage we don't know
@@ -3297,35 +5623,33 @@ static void sinterGenericCommand(redisClient *c, robj **setskeys, int setsnum, r
         decrRefCount(lenobj);
     } else {
         /* If we have a target key where to store the resulting set
-         * create this key with an empty set inside */
-        dstset = createSetObject();
+         * create this key with an empty set inside. The intersection of
+         * integer sets is made of integers, so start with an intset. */
+        dstset = createIntsetObject();
     }
 
     /* Iterate all the elements of the first (smallest) set, and test
      * the element against all the other sets, if at least one set does
      * not include the element it is discarded */
-    di = dictGetIterator(dv[0]);
-    if (!di) oom("dictGetIterator");
-
-    while((de = dictNext(di)) != NULL) {
-        robj *ele;
-
+    setTypeInitIterator(&si,sv[0]);
+    while((ele = setTypeNext(&si)) != NULL) {
         for (j = 1; j < setsnum; j++)
-            if (dictFind(dv[j],dictGetEntryKey(de)) == NULL) break;
-        if (j != setsnum)
+            if (!setTypeIsMember(sv[j],ele)) break;
+        if (j != setsnum) {
+            decrRefCount(ele);
             continue; /* at least one set does not contain the member */
-        ele = dictGetEntryKey(de);
+        }
         if (!dstkey) {
-            addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",sdslen(ele->ptr)));
+            addReplyBulkLen(c,ele);
             addReply(c,ele);
             addReply(c,shared.crlf);
             cardinality++;
         } else {
-            dictAdd(dstset->ptr,ele,NULL);
-            incrRefCount(ele);
+            setTypeAdd(dstset,ele);
         }
+        decrRefCount(ele);
     }
-    dictReleaseIterator(di);
+    setTypeReleaseIterator(&si);
 
     if (dstkey) {
         /* Store the resulting set into the target */
@@ -3337,11 +5661,11 @@ static void sinterGenericCommand(redisClient *c, robj **setskeys, int setsnum, r
     if (!dstkey) {
         lenobj->ptr = sdscatprintf(sdsempty(),"*%d\r\n",cardinality);
     } else {
-        addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",
-            dictSize((dict*)dstset->ptr)));
+        addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",
+            setTypeSize(dstset)));
         server.dirty++;
     }
-    zfree(dv);
+    zfree(sv);
 }
 
 static void sinterCommand(redisClient *c) {
@@ -3352,17 +5676,141 @@ static void sinterstoreCommand(redisClient *c) {
     sinterGenericCommand(c,c->argv+2,c->argc-2,c->argv[1]);
 }
 
+/* SINTERCARD numkeys key [key ...] [LIMIT limit]
+ *
+ * Reply with the size of the intersection without building it. With a
+ * LIMIT greater than zero the count stops as soon as it reaches the limit,
+ * so "is the intersection at least N elements" does not need to scan the
+ * whole smallest set. */
+//求多个集合交集的元素个数，LIMIT指定时数到limit就停止
+static void sintercardCommand(redisClient *c) {
+    robj **sv;
+    long numkeys, limit = 0;
+    unsigned long cardinality = 0;
+    char *eptr;
+    int j;
+
+    numkeys = strtol(c->argv[1]->ptr,&eptr,10);
+    if (*eptr != '\0' || numkeys <= 0 || numkeys > c->argc-2) {
+        addReplySds(c,sdsnew("-ERR numkeys should be greater than 0 and "
+                             "not greater than the number of keys\r\n"));
+        return;
+    }
+    if (c->argc-2 != numkeys) {
+        if (c->argc-2 != numkeys+2 ||
+            strcasecmp(c->argv[numkeys+2]->ptr,"limit"))
+        {
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+        limit = strtol(c->argv[numkeys+3]->ptr,&eptr,10);
+        if (*eptr != '\0' || limit < 0) {
+            addReplySds(c,sdsnew("-ERR LIMIT can't be negative\r\n"));
+            return;
+        }
+    }
+
+    sv = zmalloc(sizeof(robj*)*numkeys);
+    if (!sv) oom("sintercardCommand");
+    for (j = 0; j < numkeys; j++) {
+        robj *setobj = lookupKeyRead(c->db,c->argv[j+2]);
+
+        if (setobj && setobj->type != REDIS_SET) {
+            zfree(sv);
+            addReply(c,shared.wrongtypeerr);
+            return;
+        }
+        sv[j] = setobj;
+        if (!setobj) break; /* Non existing keys are empty sets */
+    }
+    if (j != numkeys) {
+        zfree(sv);
+        addReply(c,shared.czero);
+        return;
+    }
+    /* Smallest set first, like SINTER */
+    qsort(sv,numkeys,sizeof(robj*),qsortCompareSetsByCardinality);
+
+    for (j = 0; j < numkeys; j++)
+        if (sv[j]->encoding != REDIS_ENCODING_INTSET) break;
+    if (numkeys > 1 && j == numkeys &&
+        (limit == 0 || (unsigned long)limit >= setTypeSize(sv[0])))
+    {
+        /* The limit can't be reached before the end: count the result
+         * of the sorted arrays intersection, see sinterIntsets() */
+        intset *is = intsetIntersect(sv[0]->ptr,sv[1]->ptr);
+
+        for (j = 2; j < numkeys && intsetLen(is); j++) {
+            intset *tmp = intsetIntersect(is,sv[j]->ptr);
+
+            zfree(is);
+            is = tmp;
+        }
+        cardinality = intsetLen(is);
+        zfree(is);
+    } else {
+        setTypeIterator si;
+        robj *ele;
+
+        setTypeInitIterator(&si,sv[0]);
+        while((ele = setTypeNext(&si)) != NULL) {
+            for (j = 1; j < numkeys; j++)
+                if (!setTypeIsMember(sv[j],ele)) break;
+            decrRefCount(ele);
+            if (j == numkeys && ++cardinality == (unsigned long)limit) break;
+        }
+        setTypeReleaseIterator(&si);
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",cardinality));
+    zfree(sv);
+}
+
 #define REDIS_OP_UNION 0
 #define REDIS_OP_DIFF 1
 
+/* Adding or removing an element of a set costs about this many lookups */
+#define REDIS_SETOP_UPDATE_COST 2
+
+//比较函数，按元素个数从大到小排序，不存在的set当作空set
+static int qsortCompareSetsByRevCardinality(const void *s1, const void *s2) {
+    robj *o1 = *(robj**)s1, *o2 = *(robj**)s2;
+    unsigned long l1 = o1 ? setTypeSize(o1) : 0, l2 = o2 ? setTypeSize(o2) : 0;
+
+    return (l1 < l2) - (l1 > l2);
+}
+
+/* Add an element of the result to the reply, or to the target set */
+//将结果中的一个元素发送给客户端或者添加到目标set
+static void setOpEmit(redisClient *c, robj *dstset, robj *ele) {
+    if (dstset) {
+        setTypeAdd(dstset,ele);
+    } else {
+        addReplyBulkLen(c,ele);
+        addReply(c,ele);
+        addReply(c,shared.crlf);
+    }
+}
+
+/* SUNION and SDIFF pick the cheaper of two algorithms:
+ *
+ * - Probing: an element is part of the result depending on whether it is
+ *   a member of the other sets. The union emits the elements of every set
+ *   not found in the sets before it, the difference the elements of the
+ *   first set not found in any other set. No temporary set is needed.
+ * - Building: the result is built in a temporary set, adding the elements
+ *   of every set for the union, copying the first set and removing the
+ *   elements of the others for the difference.
+ *
+ * Without a target key the elements are sent as they are found, the total
+ * is fixed in the multi bulk header at the end like SINTER does. */
 static void sunionDiffGenericCommand(redisClient *c, robj **setskeys, int setsnum, robj *dstkey, int op) {
-    dict **dv = zmalloc(sizeof(dict*)*setsnum);
-    dictIterator *di;
-    dictEntry *de;
-    robj *dstset = NULL;
-    int j, cardinality = 0;
+    robj **sv = zmalloc(sizeof(robj*)*setsnum);
+    setTypeIterator si;
+    robj *ele, *lenobj = NULL, *dstset = NULL;
+    unsigned long probework = 0, buildwork = 0, cardinality = 0;
+    int j, k, probe;
 
-    if (!dv) oom("sunionDiffGenericCommand");
+    if (!sv) oom("sunionDiffGenericCommand");
     for (j = 0; j < setsnum; j++) {
         robj *setobj;
 
@@ -3370,84 +5818,123 @@ static void sunionDiffGenericCommand(redisClient *c, robj **setskeys, int setsnu
                     lookupKeyWrite(c->db,setskeys[j]) :
                     lookupKeyRead(c->db,setskeys[j]);
         if (!setobj) {
-            dv[j] = NULL;
+            sv[j] = NULL;
             continue;
         }
         if (setobj->type != REDIS_SET) {
-            zfree(dv);
+            zfree(sv);
             addReply(c,shared.wrongtypeerr);
             return;
         }
-        dv[j] = setobj->ptr;
+        sv[j] = setobj;
     }
 
-    /* We need a temp set object to store our union. If the dstkey
-     * is not NULL (that is, we are inside an SUNIONSTORE operation) then
-     * this set object will be the resulting object to set into the target key*/
-    dstset = createSetObject();
-
-    /* Iterate all the elements of all the sets, add every element a single
-     * time to the result set */
-    for (j = 0; j < setsnum; j++) {
-        if (op == REDIS_OP_DIFF && j == 0 && !dv[j]) break; /* result set is empty */
-        if (!dv[j]) continue; /* non existing keys are like empty sets */
-
-        di = dictGetIterator(dv[j]);
-        if (!di) oom("dictGetIterator");
+    /* Estimate the cost of the two algorithms in number of lookups */
+    if (op == REDIS_OP_UNION) {
+        /* Probing the largest sets first means fewer lookups, the elements
+         * of every set are looked up in all the sets before it */
+        qsort(sv,setsnum,sizeof(robj*),qsortCompareSetsByRevCardinality);
+        for (j = 0; j < setsnum && sv[j]; j++) {
+            probework += setTypeSize(sv[j])*j;
+            buildwork += setTypeSize(sv[j])*REDIS_SETOP_UPDATE_COST;
+        }
+        /* The target needs the whole set anyway */
+        probe = !dstkey && probework <= buildwork;
+    } else if (sv[0]) {
+        /* Every element of the first set is looked up in the other sets,
+         * that are sorted from the largest as it is the most likely to
+         * contain the element */
+        qsort(sv+1,setsnum-1,sizeof(robj*),qsortCompareSetsByRevCardinality);
+        for (j = 0; j < setsnum && sv[j]; j++) {
+            probework += setTypeSize(sv[0]);
+            buildwork += setTypeSize(sv[j])*REDIS_SETOP_UPDATE_COST;
+        }
+        probe = probework <= buildwork;
+    } else {
+        probe = 1; /* The result is empty */
+    }
 
-        while((de = dictNext(di)) != NULL) {
-            robj *ele;
-
-            /* dictAdd will not add the same element multiple times */
-            ele = dictGetEntryKey(de);
-            if (op == REDIS_OP_UNION || j == 0) {
-                if (dictAdd(dstset->ptr,ele,NULL) == DICT_OK) {
-                    incrRefCount(ele);
-                    cardinality++;
+    if (!dstkey) {
+        lenobj = createObject(REDIS_STRING,NULL);
+        addReply(c,lenobj);
+        decrRefCount(lenobj);
+    } else {
+        /* The result of integer sets is made of integers */
+        dstset = createIntsetObject();
+    }
+
+    if (probe) {
+        for (j = 0; j < setsnum && sv[j]; j++) {
+            if (op == REDIS_OP_DIFF && j > 0) break;
+            setTypeInitIterator(&si,sv[j]);
+            while((ele = setTypeNext(&si)) != NULL) {
+                if (op == REDIS_OP_UNION) {
+                    for (k = 0; k < j; k++)
+                        if (setTypeIsMember(sv[k],ele)) break;
+                    if (k == j) {
+                        setOpEmit(c,dstset,ele);
+                        cardinality++;
+                    }
+                } else {
+                    for (k = 1; k < setsnum && sv[k]; k++)
+                        if (setTypeIsMember(sv[k],ele)) break;
+                    if (k == setsnum || !sv[k]) {
+                        setOpEmit(c,dstset,ele);
+                        cardinality++;
+                    }
                 }
-            } else if (op == REDIS_OP_DIFF) {
-                if (dictDelete(dstset->ptr,ele) == DICT_OK) {
-                    cardinality--;
+                decrRefCount(ele);
+            }
+            setTypeReleaseIterator(&si);
+        }
+    } else {
+        /* Build the result in the target set, or in a temporary set */
+        robj *tmpset = dstset ? dstset : createIntsetObject();
+
+        for (j = 0; j < setsnum && sv[j]; j++) {
+            setTypeInitIterator(&si,sv[j]);
+            while((ele = setTypeNext(&si)) != NULL) {
+                if (op == REDIS_OP_UNION) {
+                    /* An element is emitted when it is first added */
+                    if (setTypeAdd(tmpset,ele) && !dstset) {
+                        setOpEmit(c,NULL,ele);
+                        cardinality++;
+                    }
+                } else if (j == 0) {
+                    setTypeAdd(tmpset,ele);
+                } else {
+                    setTypeRemove(tmpset,ele);
                 }
+                decrRefCount(ele);
             }
+            setTypeReleaseIterator(&si);
+            /* Nothing more to remove from an empty difference */
+            if (op == REDIS_OP_DIFF && setTypeSize(tmpset) == 0) break;
         }
-        dictReleaseIterator(di);
-
-        if (op == REDIS_OP_DIFF && cardinality == 0) break; /* result set is empty */
+        if (op == REDIS_OP_DIFF && !dstset) {
+            setTypeInitIterator(&si,tmpset);
+            while((ele = setTypeNext(&si)) != NULL) {
+                setOpEmit(c,NULL,ele);
+                cardinality++;
+                decrRefCount(ele);
+            }
+            setTypeReleaseIterator(&si);
+        }
+        if (!dstset) decrRefCount(tmpset);
     }
 
-    /* Output the content of the resulting set, if not in STORE mode */
     if (!dstkey) {
-        addReplySds(c,sdscatprintf(sdsempty(),"*%d\r\n",cardinality));
-        di = dictGetIterator(dstset->ptr);
-        if (!di) oom("dictGetIterator");
-        while((de = dictNext(di)) != NULL) {
-            robj *ele;
-
-            ele = dictGetEntryKey(de);
-            addReplySds(c,sdscatprintf(sdsempty(),
-                    "$%d\r\n",sdslen(ele->ptr)));
-            addReply(c,ele);
-            addReply(c,shared.crlf);
-        }
-        dictReleaseIterator(di);
+        lenobj->ptr = sdscatprintf(sdsempty(),"*%lu\r\n",cardinality);
     } else {
-        /* If we have a target key where to store the resulting set
-         * create this key with the result set inside */
+        /* Store the resulting set into the target */
         deleteKey(c->db,dstkey);
         dictAdd(c->db->dict,dstkey,dstset);
         incrRefCount(dstkey);
-    }
-
-    /* Cleanup */
-    if (!dstkey) {
-        decrRefCount(dstset);
-    } else {
-        addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",
-            dictSize((dict*)dstset->ptr)));
+        addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",
+            setTypeSize(dstset)));
         server.dirty++;
     }
-    zfree(dv);
+    zfree(sv);
 }
 
 static void sunionCommand(redisClient *c) {
@@ -3465,17 +5952,44 @@ static void sdiffCommand(redisClient *c) {
 static void sdiffstoreCommand(redisClient *c) {
     sunionDiffGenericCommand(c,c->argv+2,c->argc-2,c->argv[1],REDIS_OP_DIFF);
 }
-//清空当前数据库
+/* Parse the optional ASYNC argument of FLUSHDB and FLUSHALL. Returns -1
+ * (after replying with an error) on syntax error. */
+//解析FLUSHDB/FLUSHALL的ASYNC参数
+static int getFlushAsyncFlag(redisClient *c) {
+    if (c->argc == 1) return 0;
+    if (c->argc == 2 && !strcasecmp(c->argv[1]->ptr,"async")) return 1;
+    addReply(c,shared.syntaxerr);
+    return -1;
+}
+
+//清空当前数据库，ASYNC时在后台释放
 static void flushdbCommand(redisClient *c) {
+    int async = getFlushAsyncFlag(c);
+
+    if (async == -1) return;
     server.dirty += dictSize(c->db->dict);
-    dictEmpty(c->db->dict);
-    dictEmpty(c->db->expires);
+    if (async) {
+        emptyDbAsync(c->db);
+    } else {
+        dictEmpty(c->db->dict);
+        dictEmpty(c->db->expires);
+    }
     addReply(c,shared.ok);
 }
-//清空所有数据库
+//清空所有数据库，ASYNC时在后台释放
 static void flushallCommand(redisClient *c) {
-    server.dirty += emptyDb();
-    addReply(c,shared.ok);
+    int async = getFlushAsyncFlag(c);
+
+    if (async == -1) return;
+    if (async) {
+        int j;
+
+        for (j = 0; j < server.dbnum; j++)
+            server.dirty += emptyDbAsync(server.db+j);
+    } else {
+        server.dirty += emptyDb();
+    }
+    addReply(c,shared.ok);
     rdbSave(server.dbfilename);
     server.dirty++;
 }
@@ -3491,37 +6005,39 @@ static redisSortOperation *createSortOperation(int type, robj *pattern) {
 /* Return the value associated to the key with a name obtained
  * substituting the first occurence of '*' in 'pattern' with 'subst' */
 static robj *lookupKeyByPattern(redisDb *db, robj *pattern, robj *subst) {
-    char *p;
-    sds spat, ssub;
+    char *p, *ssub, subbuf[REDIS_LONGSTR_SIZE];
+    sds spat;
     robj keyobj;
-    int prefixlen, sublen, postfixlen;
-    /* Expoit the internal sds representation to create a sds string allocated on the stack in order to make this function faster */
-    struct {
-        long len;
-        long free;
-        char buf[REDIS_SORTKEY_MAX+1];
-    } keyname;
+    size_t sublen;
+    int prefixlen, postfixlen;
+    /* Expoit the internal sds representation to create a sds string allocated on the stack in order to make this function faster.
+     * REDIS_SORTKEY_MAX fits the 16 bit header (the headers are packed, so
+     * a char buffer is fine alignment-wise). */
+    char keybuf[sizeof(struct sdshdr16)+REDIS_SORTKEY_MAX+1];
+    struct sdshdr16 *keyname = (void*) keybuf;
 
     spat = pattern->ptr;
-    ssub = subst->ptr;
-    if (sdslen(spat)+sdslen(ssub)-1 > REDIS_SORTKEY_MAX) return NULL;
+    ssub = stringObjectBytes(subst,subbuf,&sublen);
+    if (sdslen(spat)+sublen-1 > REDIS_SORTKEY_MAX) return NULL;
     p = strchr(spat,'*');
     if (!p) return NULL;
 
     prefixlen = p-spat;
-    sublen = sdslen(ssub);
     postfixlen = sdslen(spat)-(prefixlen+1);
-    memcpy(keyname.buf,spat,prefixlen);
-    memcpy(keyname.buf+prefixlen,ssub,sublen);
-    memcpy(keyname.buf+prefixlen+sublen,p+1,postfixlen);
-    keyname.buf[prefixlen+sublen+postfixlen] = '\0';
-    keyname.len = prefixlen+sublen+postfixlen;
+    memcpy(keyname->buf,spat,prefixlen);
+    memcpy(keyname->buf+prefixlen,ssub,sublen);
+    memcpy(keyname->buf+prefixlen+sublen,p+1,postfixlen);
+    keyname->buf[prefixlen+sublen+postfixlen] = '\0';
+    keyname->len = prefixlen+sublen+postfixlen;
+    keyname->alloc = REDIS_SORTKEY_MAX;
+    keyname->flags = SDS_TYPE_16;
 
     keyobj.refcount = 1;
     keyobj.type = REDIS_STRING;
-    keyobj.ptr = ((char*)&keyname)+(sizeof(long)*2);
+    keyobj.encoding = REDIS_ENCODING_RAW;
+    keyobj.ptr = keyname->buf;
 
-    /* printf("lookup '%s' => %p\n", keyname.buf,de); */
+    /* printf("lookup '%s' => %p\n", keyname->buf,de); */
     return lookupKeyRead(db,&keyobj);
 }
 
@@ -3559,10 +6075,17 @@ static int sortCompare(const void *s1, const void *s2) {
                 cmp = strcoll(so1->u.cmpobj->ptr,so2->u.cmpobj->ptr);//用来排序
             }
         } else {
-            /* Compare elements directly */
-            cmp = strcoll(so1->obj->ptr,so2->obj->ptr);
+            /* Compare elements directly. Elements may be integer encoded */
+            char buf1[REDIS_LONGSTR_SIZE], buf2[REDIS_LONGSTR_SIZE];
+            size_t len;
+
+            cmp = strcoll(stringObjectBytes(so1->obj,buf1,&len),
+                          stringObjectBytes(so2->obj,buf2,&len));
         }
     }
+    /* Break ties comparing the elements themselves, so that the output does
+     * not depend on the order of the input (see SORT ... STORE) */
+    if (cmp == 0) cmp = compareStringObjects(so1->obj,so2->obj);
     return server.sort_desc ? -cmp : cmp;
 }
 
@@ -3575,7 +6098,7 @@ static void sortCommand(redisClient *c) {
     int limit_start = 0, limit_count = -1, start, end;
     int j, dontsort = 0, vectorlen;
     int getop = 0; /* GET operation counter */
-    robj *sortval, *sortby = NULL;
+    robj *sortval, *sortby = NULL, *storekey = NULL;
     redisSortObject *vector; /* Resulting vector to sort */
 
     /* Lookup the key to sort. It must be of the right types */
@@ -3584,7 +6107,9 @@ static void sortCommand(redisClient *c) {
         addReply(c,shared.nokeyerr);
         return;
     }
-    if (sortval->type != REDIS_SET && sortval->type != REDIS_LIST) {
+    if (sortval->type != REDIS_SET && sortval->type != REDIS_LIST &&
+        sortval->type != REDIS_ZSET)
+    {
         addReply(c,shared.wrongtypeerr);
         return;
     }
@@ -3613,6 +6138,9 @@ static void sortCommand(redisClient *c) {
             limit_start = atoi(c->argv[j+1]->ptr);
             limit_count = atoi(c->argv[j+2]->ptr);
             j+=2;
+        } else if (!strcasecmp(c->argv[j]->ptr,"store") && leftargs >= 1) {
+            storekey = c->argv[j+1];
+            j++;
         } else if (!strcasecmp(c->argv[j]->ptr,"by") && leftargs >= 1) {
             sortby = c->argv[j+1];
             /* If the BY pattern does not contain '*', i.e. it is constant,
@@ -3645,39 +6173,61 @@ static void sortCommand(redisClient *c) {
         j++;
     }
 
+    /* SORT ... STORE is replicated as it is, so slaves must store the same
+     * list. Without sorting the order of a set depends on its hash table,
+     * that may differ on the slave, so sort the members lexicographically
+     * instead. */
+    if (storekey && dontsort && sortval->type == REDIS_SET) {
+        dontsort = 0;
+        alpha = 1;
+        sortby = NULL;
+    }
+
     /* Load the sorting vector with all the objects to sort */
-    vectorlen = (sortval->type == REDIS_LIST) ?
-        listLength((list*)sortval->ptr) :
-        dictSize((dict*)sortval->ptr);
+    switch(sortval->type) {
+    case REDIS_LIST: vectorlen = listTypeLength(sortval); break;
+    case REDIS_SET: vectorlen = setTypeSize(sortval); break;
+    default: vectorlen = ((zset*)sortval->ptr)->zsl->length; break;
+    }
     vector = zmalloc(sizeof(redisSortObject)*vectorlen);
     if (!vector) oom("allocating objects vector for SORT");
     j = 0;
     if (sortval->type == REDIS_LIST) {
-        list *list = sortval->ptr;
-        listNode *ln;
+        listTypeIterator li;
+        listTypeEntry entry;
+
+        /* List elements are new references, released at the end */
+        listTypeInitIterator(&li,sortval,0,REDIS_TAIL);
+        while(listTypeNext(&li,&entry)) {
+            vector[j].obj = listTypeGet(&entry);
+            vector[j].u.score = 0;
+            vector[j].u.cmpobj = NULL;
+            j++;
+        }
+    } else if (sortval->type == REDIS_SET) {
+        setTypeIterator si;
+        robj *ele;
 
-        listRewind(list);
-        while((ln = listYield(list))) {
-            robj *ele = ln->value;
+        /* Set elements are new references as well */
+        setTypeInitIterator(&si,sortval);
+        while((ele = setTypeNext(&si)) != NULL) {
             vector[j].obj = ele;
             vector[j].u.score = 0;
             vector[j].u.cmpobj = NULL;
             j++;
         }
+        setTypeReleaseIterator(&si);
     } else {
-        dict *set = sortval->ptr;
-        dictIterator *di;
-        dictEntry *setele;
+        zskiplistNode *ln = ((zset*)sortval->ptr)->zsl->header;
 
-        di = dictGetIterator(set);
-        if (!di) oom("dictGetIterator");
-        while((setele = dictNext(di)) != NULL) {
-            vector[j].obj = dictGetEntryKey(setele);
+        /* Take a reference to the sorted set members too */
+        while((ln = ln->level[0].forward) != NULL) {
+            incrRefCount(ln->obj);
+            vector[j].obj = ln->obj;
             vector[j].u.score = 0;
             vector[j].u.cmpobj = NULL;
             j++;
         }
-        dictReleaseIterator(di);
     }
     assert(j == vectorlen);
 
@@ -3690,146 +6240,1884 @@ static void sortCommand(redisClient *c) {
                 byval = lookupKeyByPattern(c->db,sortby,vector[j].obj);
                 if (!byval || byval->type != REDIS_STRING) continue;
                 if (alpha) {
-                    vector[j].u.cmpobj = byval;
-                    incrRefCount(byval);
+                    /* strcoll() needs the bytes, so decode it now */
+                    vector[j].u.cmpobj = getDecodedObject(byval);
+                } else if (byval->encoding == REDIS_ENCODING_INT) {
+                    vector[j].u.score = (long)byval->ptr;
+                } else if (byval->encoding == REDIS_ENCODING_LZF) {
+                    robj *dec = getDecodedObject(byval);
+
+                    vector[j].u.score = strtod(dec->ptr,NULL);
+                    decrRefCount(dec);
                 } else {
                     vector[j].u.score = strtod(byval->ptr,NULL);
                 }
             } else {
-                if (!alpha) vector[j].u.score = strtod(vector[j].obj->ptr,NULL);
+                if (alpha) continue;
+                if (vector[j].obj->encoding == REDIS_ENCODING_INT)
+                    vector[j].u.score = (long)vector[j].obj->ptr;
+                else
+                    vector[j].u.score = strtod(vector[j].obj->ptr,NULL);
+            }
+        }
+    }
+
+    /* We are ready to sort the vector... perform a bit of sanity check
+     * on the LIMIT option too. We'll use a partial version of quicksort. */
+    start = (limit_start < 0) ? 0 : limit_start;
+    end = (limit_count < 0) ? vectorlen-1 : start+limit_count-1;
+    if (start >= vectorlen) {
+        start = vectorlen-1;
+        end = vectorlen-2;
+    }
+    if (end >= vectorlen) end = vectorlen-1;
+
+    if (dontsort == 0) {
+        server.sort_desc = desc;
+        server.sort_alpha = alpha;
+        server.sort_bypattern = sortby ? 1 : 0;
+        if (sortby && (start != 0 || end != vectorlen-1))
+            pqsort(vector,vectorlen,sizeof(redisSortObject),sortCompare, start,end);
+        else
+            qsort(vector,vectorlen,sizeof(redisSortObject),sortCompare);
+    }
+
+    outputlen = getop ? getop*(end-start+1) : end-start+1;
+
+    /* With STORE the output becomes a list stored at storekey, replacing
+     * its old value and expire. An empty output deletes the key. GET of
+     * missing keys stores empty strings. */
+    if (storekey) {
+        robj *sobj = createZiplistObject();
+        robj *empty = createStringObject("",0);
+
+        for (j = start; j <= end; j++) {
+            listNode *ln;
+
+            if (!getop) {
+                listTypePush(sobj,vector[j].obj,REDIS_TAIL);
+                continue;
+            }
+            listRewind(operations);
+            while((ln = listYield(operations))) {
+                redisSortOperation *sop = ln->value;
+                robj *val;
+
+                if (sop->type != REDIS_SORT_GET) continue;
+                val = lookupKeyByPattern(c->db,sop->pattern,vector[j].obj);
+                if (!val || val->type != REDIS_STRING) val = empty;
+                /* GET values may be LZF compressed, decode them before
+                 * the push as list elements are always plain strings */
+                val = getDecodedObject(val);
+                listTypePush(sobj,val,REDIS_TAIL);
+                decrRefCount(val);
+            }
+        }
+        decrRefCount(empty);
+        if (outputlen) {
+            if (dictAdd(c->db->dict,storekey,sobj) == DICT_ERR) {
+                dbOverwrite(c->db,storekey,sobj);
+            } else {
+                incrRefCount(storekey);
+            }
+            removeExpire(c->db,storekey);
+        } else {
+            decrRefCount(sobj);
+            deleteKey(c->db,storekey);
+        }
+        /* Always replicate SORT ... STORE, even when the output is empty */
+        server.dirty += 1+outputlen;
+        addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",outputlen));
+        goto cleanup;
+    }
+
+    /* Send command output to the output buffer, performing the specified
+     * GET/DEL/INCR/DECR operations if any. */
+    addReplySds(c,sdscatprintf(sdsempty(),"*%d\r\n",outputlen));
+    for (j = start; j <= end; j++) {
+        listNode *ln;
+        if (!getop) {
+            addReplyBulkLen(c,vector[j].obj);
+            addReply(c,vector[j].obj);
+            addReply(c,shared.crlf);
+        }
+        listRewind(operations);
+        while((ln = listYield(operations))) {
+            redisSortOperation *sop = ln->value;
+            robj *val = lookupKeyByPattern(c->db,sop->pattern,
+                vector[j].obj);
+
+            if (sop->type == REDIS_SORT_GET) {
+                if (!val || val->type != REDIS_STRING) {
+                    addReply(c,shared.nullbulk);
+                } else {
+                    addReplyBulkLen(c,val);
+                    addReply(c,val);
+                    addReply(c,shared.crlf);
+                }
+            } else if (sop->type == REDIS_SORT_DEL) {
+                /* TODO */
+            }
+        }
+    }
+
+cleanup:
+    listRelease(operations);
+    for (j = 0; j < vectorlen; j++) {
+        if (sortby && alpha && vector[j].u.cmpobj)
+            decrRefCount(vector[j].u.cmpobj);
+        decrRefCount(vector[j].obj);
+    }
+    decrRefCount(sortval);
+    zfree(vector);
+}
+//打印一些日志
+static void infoCommand(redisClient *c) {
+    sds info;
+    time_t uptime = time(NULL)-server.stat_starttime;
+    size_t rss = zmalloc_get_rss();
+    long long lazyfreed;
+    unsigned long lazypending = lazyfreePendingJobs(&lazyfreed);
+    int j;
+
+    info = sdscatprintf(sdsempty(),
+        "redis_version:%s\r\n"
+        "uptime_in_seconds:%d\r\n"
+        "uptime_in_days:%d\r\n"
+        "connected_clients:%d\r\n"
+        "connected_slaves:%d\r\n"
+        "blocked_clients:%u\r\n"
+        "used_memory:%zu\r\n"
+        "used_memory_rss:%zu\r\n"
+        "mem_fragmentation_ratio:%.2f\r\n"
+        "mem_allocator:%s\r\n"
+        "changes_since_last_save:%lld\r\n"
+        "bgsave_in_progress:%d\r\n"
+        "last_save_time:%d\r\n"
+        "total_connections_received:%lld\r\n"
+        "total_commands_processed:%lld\r\n"
+        "objfreelist_len:%lu\r\n"
+        "objfreelist_hits:%lld\r\n"
+        "objfreelist_misses:%lld\r\n"
+        "objfreelist_trimmed:%lld\r\n"
+        "lazyfree_pending_objects:%lu\r\n"
+        "lazyfreed_objects:%lld\r\n"
+        "lzf_compressed_values:%lld\r\n"
+        "lzf_uncompressible_values:%lld\r\n"
+        "lzf_compression_ratio:%.2f\r\n"
+        "lzf_decompressions:%lld\r\n"
+        "role:%s\r\n"
+        ,REDIS_VERSION,
+        uptime,
+        uptime/(3600*24),
+        listLength(server.clients)-listLength(server.slaves),
+        listLength(server.slaves),
+        server.blockedclients,
+        server.usedmemory,
+        rss,
+        server.usedmemory ? (float)rss/server.usedmemory : 0,
+        ZMALLOC_LIB,
+        server.dirty,
+        server.bgsaveinprogress,
+        server.lastsave,
+        server.stat_numconnections,
+        server.stat_numcommands,
+        server.objfreelistlen,
+        server.stat_objfreelist_hits,
+        server.stat_objfreelist_misses,
+        server.stat_objfreelist_trimmed,
+        lazypending,
+        lazyfreed,
+        server.stat_lzf_compressed,
+        server.stat_lzf_uncompressible,
+        server.stat_lzf_compressedbytes ?
+            (float)server.stat_lzf_rawbytes/server.stat_lzf_compressedbytes : 0,
+        server.stat_lzf_decompressions,
+        server.masterhost == NULL ? "master" : "slave"
+    );
+    if (server.masterhost) {
+        info = sdscatprintf(info,
+            "master_host:%s\r\n"
+            "master_port:%d\r\n"
+            "master_link_status:%s\r\n"
+            "master_last_io_seconds_ago:%d\r\n"
+            ,server.masterhost,
+            server.masterport,
+            (server.replstate == REDIS_REPL_CONNECTED) ?
+                "up" : "down",
+            (int)(time(NULL)-server.master->lastinteraction)
+        );
+    }
+    for (j = 0; j < server.dbnum; j++) {
+        long long keys, vkeys;
+
+        keys = dictSize(server.db[j].dict);
+        vkeys = dictSize(server.db[j].expires);
+        if (keys || vkeys) {
+            info = sdscatprintf(info, "db%d: keys=%lld,expires=%lld\r\n",
+                j, keys, vkeys);
+        }
+    }
+    /* Estimated memory used by every type in every DB: the average size
+     * of the sampled keys of a given type, weighted by how often that type
+     * was sampled, times the number of keys. */
+    for (j = 0; j < server.dbnum; j++) {
+        redisDb *db = server.db+j;
+        int t;
+
+        if (!dictSize(db->dict) || !db->memsamplekeys) continue;
+        info = sdscatprintf(info, "db%d_memory:",j);
+        for (t = 0; t < REDIS_NUM_TYPES; t++) {
+            info = sdscatprintf(info, "%s%s=%llu", t ? "," : "",
+                typeName(t),
+                db->memsamplebytes[t]*dictSize(db->dict)/db->memsamplekeys);
+        }
+        info = sdscatlen(info,"\r\n",2);
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",sdslen(info)));
+    addReplySds(c,info);
+    addReply(c,shared.crlf);
+}
+
+static void monitorCommand(redisClient *c) {
+    /* ignore MONITOR if aleady slave or in monitor mode */
+    if (c->flags & REDIS_SLAVE) return;
+
+    c->flags |= (REDIS_SLAVE|REDIS_MONITOR);
+    c->slaveseldb = 0;
+    if (!listAddNodeTail(server.monitors,c)) oom("listAddNodeTail");
+    addReply(c,shared.ok);
+}
+
+/* =================================== ZSets ================================ */
+
+/* Sorted sets are implemented with a skiplist plus a hash table. The
+ * skiplist keeps the elements ordered by score, and by member for equal
+ * scores, so that ranges and ranks are O(log N). The hash table maps every
+ * member to its skiplist node, so the score of a member is found in O(1) and
+ * updating it is an O(log N) operation.
+ *
+ * This skiplist implementation is almost a C translation of the original
+ * algorithm described by William Pugh in "Skip Lists: A Probabilistic
+ * Alternative to Balanced Trees", with three changes: elements with the same
+ * score are allowed (the member is used to break ties), every level of a node
+ * also records how many nodes its forward pointer skips (the 'span'), so the
+ * rank of a node is computed while looking for it, and every node has a
+ * backward pointer to the previous node, so the list can be traversed from
+ * the tail to the head for the ZREV* commands.
+ *
+ * The member objects are owned by the skiplist: the dict uses the very same
+ * objects as keys without holding a reference, see zsetDictType. */
+
+//创建一个有level层的跳表节点
+static zskiplistNode *zslCreateNode(int level, double score, robj *obj) {
+    zskiplistNode *zn = zmalloc(sizeof(*zn)+level*sizeof(struct zskiplistLevel));
+
+    if (!zn) oom("zslCreateNode");
+    zn->score = score;
+    zn->obj = obj;
+    return zn;
+}
+
+//创建一个空的跳表
+static zskiplist *zslCreate(void) {
+    int j;
+    zskiplist *zsl;
+
+    zsl = zmalloc(sizeof(*zsl));
+    if (!zsl) oom("zslCreate");
+    zsl->level = 1;
+    zsl->length = 0;
+    zsl->header = zslCreateNode(ZSKIPLIST_MAXLEVEL,0,NULL);
+    for (j = 0; j < ZSKIPLIST_MAXLEVEL; j++) {
+        zsl->header->level[j].forward = NULL;
+        zsl->header->level[j].span = 0;
+    }
+    zsl->header->backward = NULL;
+    zsl->tail = NULL;
+    return zsl;
+}
+
+/* Free the skiplist, releasing the members with 'freeobj': decrRefCount()
+ * in the main thread, lazyfreeDecrRefCount() in the lazy free thread. */
+//释放跳表以及所有的成员
+static void zslFree(zskiplist *zsl, void (*freeobj)(void *)) {
+    zskiplistNode *node = zsl->header->level[0].forward, *next;
+
+    zfree(zsl->header);
+    while(node) {
+        next = node->level[0].forward;
+        freeobj(node->obj);
+        zfree(node);
+        node = next;
+    }
+    zfree(zsl);
+}
+
+/* Returns a random level for a new node, between 1 and ZSKIPLIST_MAXLEVEL.
+ * Every level is ZSKIPLIST_P times less likely than the previous one. */
+//随机生成新节点的层数
+static int zslRandomLevel(void) {
+    int level = 1;
+
+    while ((random()&0xFFFF) < (ZSKIPLIST_P * 0xFFFF))
+        level += 1;
+    return (level < ZSKIPLIST_MAXLEVEL) ? level : ZSKIPLIST_MAXLEVEL;
+}
+
+/* True if the node 'x' comes before the element (score,obj) */
+#define zslNodeBefore(x,s,o) ((x)->score < (s) || \
+    ((x)->score == (s) && compareStringObjects((x)->obj,(o)) < 0))
+
+/* Insert a new element. The element must not already exist, the skiplist
+ * takes over the reference to 'obj' of the caller. Returns the new node. */
+//插入一个新元素，返回新节点
+static zskiplistNode *zslInsert(zskiplist *zsl, double score, robj *obj) {
+    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x;
+    unsigned long rank[ZSKIPLIST_MAXLEVEL];
+    int i, level;
+
+    /* Find the node preceding the new one at every level, and its rank */
+    x = zsl->header;
+    for (i = zsl->level-1; i >= 0; i--) {
+        rank[i] = (i == zsl->level-1) ? 0 : rank[i+1];
+        while (x->level[i].forward &&
+               zslNodeBefore(x->level[i].forward,score,obj))
+        {
+            rank[i] += x->level[i].span;
+            x = x->level[i].forward;
+        }
+        update[i] = x;
+    }
+    level = zslRandomLevel();
+    if (level > zsl->level) {
+        for (i = zsl->level; i < level; i++) {
+            rank[i] = 0;
+            update[i] = zsl->header;
+            update[i]->level[i].span = zsl->length;
+        }
+        zsl->level = level;
+    }
+    x = zslCreateNode(level,score,obj);
+    for (i = 0; i < level; i++) {
+        x->level[i].forward = update[i]->level[i].forward;
+        update[i]->level[i].forward = x;
+
+        /* The new node splits the span of the preceding node */
+        x->level[i].span = update[i]->level[i].span - (rank[0] - rank[i]);
+        update[i]->level[i].span = (rank[0] - rank[i]) + 1;
+    }
+    /* Levels above the new node skip one more node */
+    for (i = level; i < zsl->level; i++)
+        update[i]->level[i].span++;
+
+    x->backward = (update[0] == zsl->header) ? NULL : update[0];
+    if (x->level[0].forward)
+        x->level[0].forward->backward = x;
+    else
+        zsl->tail = x;
+    zsl->length++;
+    return x;
+}
+
+/* Unlink the node 'x' from the skiplist. 'update' holds the node preceding
+ * 'x' at every level. The node is not freed. */
+//从跳表中摘除节点x，不释放节点
+static void zslDeleteNode(zskiplist *zsl, zskiplistNode *x, zskiplistNode **update) {
+    int i;
+
+    for (i = 0; i < zsl->level; i++) {
+        if (update[i]->level[i].forward == x) {
+            update[i]->level[i].span += x->level[i].span - 1;
+            update[i]->level[i].forward = x->level[i].forward;
+        } else {
+            update[i]->level[i].span -= 1;
+        }
+    }
+    if (x->level[0].forward)
+        x->level[0].forward->backward = x->backward;
+    else
+        zsl->tail = x->backward;
+    while(zsl->level > 1 && zsl->header->level[zsl->level-1].forward == NULL)
+        zsl->level--;
+    zsl->length--;
+}
+
+/* Find the nodes preceding the element (score,obj) at every level. Returns
+ * the node of the element if it exists, NULL otherwise. */
+//查找(score,obj)元素之前的节点，元素存在时返回它的节点
+static zskiplistNode *zslFindUpdate(zskiplist *zsl, double score, robj *obj, zskiplistNode **update) {
+    zskiplistNode *x = zsl->header;
+    int i;
+
+    for (i = zsl->level-1; i >= 0; i--) {
+        while (x->level[i].forward &&
+               zslNodeBefore(x->level[i].forward,score,obj))
+            x = x->level[i].forward;
+        update[i] = x;
+    }
+    x = x->level[0].forward;
+    if (x && x->score == score && compareStringObjects(x->obj,obj) == 0)
+        return x;
+    return NULL;
+}
+
+/* Delete the element with the given score and member. Returns 1 if it was
+ * found, the node and the skiplist reference to the member are released. */
+//删除一个元素，找到时返回1
+static int zslDelete(zskiplist *zsl, double score, robj *obj) {
+    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x;
+
+    x = zslFindUpdate(zsl,score,obj,update);
+    if (!x) return 0;
+    zslDeleteNode(zsl,x,update);
+    decrRefCount(x->obj);
+    zfree(x);
+    return 1;
+}
+
+/* Change the score of an existing element. When the element keeps its
+ * position the node is updated in place, otherwise it is moved. Returns
+ * the node of the element, that is not the old one if it was moved. */
+//修改一个元素的分数，返回元素的节点
+static zskiplistNode *zslUpdateScore(zskiplist *zsl, double curscore, robj *obj, double newscore) {
+    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x, *newnode;
+
+    x = zslFindUpdate(zsl,curscore,obj,update);
+    assert(x != NULL);
+    if ((x->backward == NULL || x->backward->score < newscore) &&
+        (x->level[0].forward == NULL || x->level[0].forward->score > newscore))
+    {
+        x->score = newscore;
+        return x;
+    }
+    zslDeleteNode(zsl,x,update);
+    newnode = zslInsert(zsl,newscore,x->obj);
+    zfree(x);
+    return newnode;
+}
+
+/* Rank of the element (score,obj), starting at 1 for the first element.
+ * Returns 0 when the element is not found. */
+//返回元素的排名，从1开始，不存在时返回0
+static unsigned long zslGetRank(zskiplist *zsl, double score, robj *obj) {
+    zskiplistNode *x = zsl->header;
+    unsigned long rank = 0;
+    int i;
+
+    for (i = zsl->level-1; i >= 0; i--) {
+        while (x->level[i].forward &&
+               (x->level[i].forward->score < score ||
+                (x->level[i].forward->score == score &&
+                 compareStringObjects(x->level[i].forward->obj,obj) <= 0)))
+        {
+            rank += x->level[i].span;
+            x = x->level[i].forward;
+        }
+        /* x may be the header, whose obj is NULL */
+        if (x->obj && compareStringObjects(x->obj,obj) == 0 &&
+            x->score == score) return rank;
+    }
+    return 0;
+}
+
+/* Node at 'rank', starting at 1 for the first element, or NULL */
+//返回排名为rank的节点，从1开始
+static zskiplistNode *zslGetElementByRank(zskiplist *zsl, unsigned long rank) {
+    zskiplistNode *x = zsl->header;
+    unsigned long traversed = 0;
+    int i;
+
+    for (i = zsl->level-1; i >= 0; i--) {
+        while (x->level[i].forward && traversed+x->level[i].span <= rank) {
+            traversed += x->level[i].span;
+            x = x->level[i].forward;
+        }
+        if (traversed == rank) return x;
+    }
+    return NULL;
+}
+
+static int zslValueGteMin(double value, zrangespec *spec) {
+    return spec->minex ? (value > spec->min) : (value >= spec->min);
+}
+
+static int zslValueLteMax(double value, zrangespec *spec) {
+    return spec->maxex ? (value < spec->max) : (value <= spec->max);
+}
+
+/* True if some part of the skiplist may be in range */
+//判断跳表是否有元素可能在范围内
+static int zslIsInRange(zskiplist *zsl, zrangespec *range) {
+    zskiplistNode *x;
+
+    if (range->min > range->max ||
+        (range->min == range->max && (range->minex || range->maxex)))
+        return 0;
+    x = zsl->tail;
+    if (x == NULL || !zslValueGteMin(x->score,range)) return 0;
+    x = zsl->header->level[0].forward;
+    if (x == NULL || !zslValueLteMax(x->score,range)) return 0;
+    return 1;
+}
+
+/* First node in the score range, or NULL */
+//返回第一个在范围内的节点
+static zskiplistNode *zslFirstInRange(zskiplist *zsl, zrangespec *range) {
+    zskiplistNode *x = zsl->header;
+    int i;
+
+    if (!zslIsInRange(zsl,range)) return NULL;
+    for (i = zsl->level-1; i >= 0; i--) {
+        /* Go forward while the next node is below the range */
+        while (x->level[i].forward &&
+               !zslValueGteMin(x->level[i].forward->score,range))
+            x = x->level[i].forward;
+    }
+    /* The range is not empty, so the next node exists */
+    x = x->level[0].forward;
+    return zslValueLteMax(x->score,range) ? x : NULL;
+}
+
+/* Last node in the score range, or NULL */
+//返回最后一个在范围内的节点
+static zskiplistNode *zslLastInRange(zskiplist *zsl, zrangespec *range) {
+    zskiplistNode *x = zsl->header;
+    int i;
+
+    if (!zslIsInRange(zsl,range)) return NULL;
+    for (i = zsl->level-1; i >= 0; i--) {
+        /* Go forward while the next node is still in range */
+        while (x->level[i].forward &&
+               zslValueLteMax(x->level[i].forward->score,range))
+            x = x->level[i].forward;
+    }
+    /* The range is not empty, so x is not the header */
+    return zslValueGteMin(x->score,range) ? x : NULL;
+}
+
+/* Delete all the elements in the score range, removing them from 'dict' as
+ * well. Returns the number of deleted elements. */
+//删除分数在范围内的元素，返回删除的个数
+static unsigned long zslDeleteRangeByScore(zskiplist *zsl, zrangespec *range, dict *dict) {
+    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x;
+    unsigned long removed = 0;
+    int i;
+
+    x = zsl->header;
+    for (i = zsl->level-1; i >= 0; i--) {
+        while (x->level[i].forward &&
+               !zslValueGteMin(x->level[i].forward->score,range))
+            x = x->level[i].forward;
+        update[i] = x;
+    }
+    x = x->level[0].forward;
+    while (x && zslValueLteMax(x->score,range)) {
+        zskiplistNode *next = x->level[0].forward;
+
+        zslDeleteNode(zsl,x,update);
+        dictDelete(dict,x->obj);
+        decrRefCount(x->obj);
+        zfree(x);
+        removed++;
+        x = next;
+    }
+    return removed;
+}
+
+/* Delete all the elements with rank between start and end, both included
+ * and starting at 1. Returns the number of deleted elements. */
+//删除排名在start和end之间的元素，返回删除的个数
+static unsigned long zslDeleteRangeByRank(zskiplist *zsl, unsigned long start, unsigned long end, dict *dict) {
+    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x;
+    unsigned long traversed = 0, removed = 0;
+    int i;
+
+    x = zsl->header;
+    for (i = zsl->level-1; i >= 0; i--) {
+        while (x->level[i].forward && traversed+x->level[i].span < start) {
+            traversed += x->level[i].span;
+            x = x->level[i].forward;
+        }
+        update[i] = x;
+    }
+    traversed++;
+    x = x->level[0].forward;
+    while (x && traversed <= end) {
+        zskiplistNode *next = x->level[0].forward;
+
+        zslDeleteNode(zsl,x,update);
+        dictDelete(dict,x->obj);
+        decrRefCount(x->obj);
+        zfree(x);
+        removed++;
+        traversed++;
+        x = next;
+    }
+    return removed;
+}
+
+/* Parse a score. NaN is refused as it can't be ordered. */
+//解析分数，出错时返回REDIS_ERR
+static int zsetParseScore(robj *o, double *score) {
+    char buf[REDIS_LONGSTR_SIZE], *s, *eptr;
+    size_t len;
+
+    s = stringObjectBytes(o,buf,&len);
+    *score = strtod(s,&eptr);
+    if (len == 0 || *eptr != '\0' || isnan(*score)) return REDIS_ERR;
+    return REDIS_OK;
+}
+
+/* Parse the min and max arguments of a score range. A bound prefixed by
+ * '(' is exclusive, "inf" and "-inf" are the unbounded ends. */
+//解析分数范围，出错时返回REDIS_ERR
+static int zslParseRange(robj *min, robj *max, zrangespec *spec) {
+    robj *bound[2];
+    double *value[2];
+    int *exclusive[2], j;
+
+    bound[0] = min; value[0] = &spec->min; exclusive[0] = &spec->minex;
+    bound[1] = max; value[1] = &spec->max; exclusive[1] = &spec->maxex;
+    for (j = 0; j < 2; j++) {
+        char buf[REDIS_LONGSTR_SIZE], *s, *eptr;
+        size_t len;
+
+        s = stringObjectBytes(bound[j],buf,&len);
+        *exclusive[j] = (s[0] == '(');
+        if (*exclusive[j]) s++;
+        *value[j] = strtod(s,&eptr);
+        if (*s == '\0' || *eptr != '\0' || isnan(*value[j]))
+            return REDIS_ERR;
+    }
+    return REDIS_OK;
+}
+
+/* ZADD key score member [score member ...] and ZINCRBY key increment member.
+ * All the scores are checked before touching the sorted set, so that an
+ * invalid score does not leave the command half executed. */
+static void zaddGenericCommand(redisClient *c, int incr) {
+    robj *zsetobj;
+    zset *zs;
+    double *scores;
+    int j, elements, added = 0;
+
+    if (c->argc % 2) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    elements = (c->argc-2)/2;
+    scores = zmalloc(sizeof(double)*elements);
+    if (!scores) oom("zaddGenericCommand");
+    for (j = 0; j < elements; j++) {
+        if (zsetParseScore(c->argv[2+j*2],scores+j) == REDIS_ERR) {
+            addReplySds(c,sdsnew("-ERR value is not a valid float\r\n"));
+            zfree(scores);
+            return;
+        }
+    }
+
+    zsetobj = lookupKeyWrite(c->db,c->argv[1]);
+    if (zsetobj == NULL) {
+        zsetobj = createZsetObject();
+        dictAdd(c->db->dict,c->argv[1],zsetobj);
+        incrRefCount(c->argv[1]);
+    } else if (zsetobj->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        zfree(scores);
+        return;
+    }
+    zs = zsetobj->ptr;
+
+    for (j = 0; j < elements; j++) {
+        robj *member;
+        double score = scores[j];
+        dictEntry *de;
+
+        member = c->argv[3+j*2] = tryObjectEncoding(c->argv[3+j*2]);
+        de = dictFind(zs->dict,member);
+        if (de) {
+            zskiplistNode *node = dictGetEntryVal(de);
+
+            if (incr) {
+                score += node->score;
+                if (isnan(score)) {
+                    addReplySds(c,sdsnew(
+                        "-ERR resulting score is not a number (NaN)\r\n"));
+                    zfree(scores);
+                    return;
+                }
+            }
+            if (score != node->score) {
+                dictGetEntryVal(de) =
+                    zslUpdateScore(zs->zsl,node->score,member,score);
+                server.dirty++;
             }
+        } else {
+            incrRefCount(member);
+            dictAdd(zs->dict,member,zslInsert(zs->zsl,score,member));
+            server.dirty++;
+            added++;
         }
+        scores[j] = score;
+    }
+    if (incr)
+        addReplyDouble(c,scores[0]);
+    else
+        addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",added));
+    zfree(scores);
+}
+
+//有序集合中增加一个或多个元素，元素已经存在时更新分数，返回新增的元素个数
+static void zaddCommand(redisClient *c) {
+    zaddGenericCommand(c,0);
+}
+
+//增加元素的分数，元素不存在时添加，返回新的分数
+static void zincrbyCommand(redisClient *c) {
+    zaddGenericCommand(c,1);
+}
+
+//删除有序集合中的一个或多个元素，返回删除的元素个数
+static void zremCommand(redisClient *c) {
+    robj *zsetobj;
+    zset *zs;
+    int j, removed = 0;
+
+    zsetobj = lookupKeyWrite(c->db,c->argv[1]);
+    if (zsetobj == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (zsetobj->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    zs = zsetobj->ptr;
+    for (j = 2; j < c->argc; j++) {
+        dictEntry *de = dictFind(zs->dict,c->argv[j]);
+        double score;
+
+        if (!de) continue;
+        /* The dict does not own the member, delete it from the skiplist
+         * only after the dict entry is gone */
+        score = ((zskiplistNode*)dictGetEntryVal(de))->score;
+        dictDelete(zs->dict,c->argv[j]);
+        zslDelete(zs->zsl,score,c->argv[j]);
+        removed++;
+    }
+    server.dirty += removed;
+    addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",removed));
+}
+
+/* Reply with the member of 'ln' and, if requested, its score */
+static void addReplyZsetNode(redisClient *c, zskiplistNode *ln, int withscores) {
+    addReplyBulkLen(c,ln->obj);
+    addReply(c,ln->obj);
+    addReply(c,shared.crlf);
+    if (withscores) addReplyDouble(c,ln->score);
+}
+
+/* ZRANGE and ZREVRANGE: elements by rank, with negative ranks counting
+ * from the end like LRANGE */
+static void zrangeGenericCommand(redisClient *c, int reverse) {
+    robj *o;
+    zskiplist *zsl;
+    zskiplistNode *ln;
+    int start = atoi(c->argv[2]->ptr);
+    int end = atoi(c->argv[3]->ptr);
+    int withscores = 0, llen, rangelen, j;
+
+    if (c->argc == 5 && !strcasecmp(c->argv[4]->ptr,"withscores")) {
+        withscores = 1;
+    } else if (c->argc >= 5) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.nullmultibulk);
+        return;
+    }
+    if (o->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    zsl = ((zset*)o->ptr)->zsl;
+    llen = zsl->length;
+
+    /* convert negative indexes */
+    if (start < 0) start = llen+start;
+    if (end < 0) end = llen+end;
+    if (start < 0) start = 0;
+    if (end < 0) end = 0;
+
+    /* indexes sanity checks */
+    if (start > end || start >= llen) {
+        /* Out of range start or start > end result in empty list */
+        addReply(c,shared.emptymultibulk);
+        return;
+    }
+    if (end >= llen) end = llen-1;
+    rangelen = (end-start)+1;
+
+    /* Find the first node with a single O(log N) lookup, then just
+     * follow the pointers */
+    if (reverse)
+        ln = zslGetElementByRank(zsl,llen-start);
+    else
+        ln = zslGetElementByRank(zsl,start+1);
+
+    addReplySds(c,sdscatprintf(sdsempty(),"*%d\r\n",
+        withscores ? rangelen*2 : rangelen));
+    for (j = 0; j < rangelen; j++) {
+        addReplyZsetNode(c,ln,withscores);
+        ln = reverse ? ln->backward : ln->level[0].forward;
+    }
+}
+
+//按排名返回元素，分数从小到大
+static void zrangeCommand(redisClient *c) {
+    zrangeGenericCommand(c,0);
+}
+
+//按排名返回元素，分数从大到小
+static void zrevrangeCommand(redisClient *c) {
+    zrangeGenericCommand(c,1);
+}
+
+/* ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count] and
+ * ZREVRANGEBYSCORE key max min [WITHSCORES] [LIMIT offset count] */
+static void zrangebyscoreGenericCommand(redisClient *c, int reverse) {
+    zrangespec range;
+    robj *o, *lenobj;
+    zskiplist *zsl;
+    zskiplistNode *ln;
+    int withscores = 0, offset = 0, limit = -1, j;
+    unsigned long rangelen = 0;
+
+    if (zslParseRange(c->argv[reverse ? 3 : 2],c->argv[reverse ? 2 : 3],
+                      &range) == REDIS_ERR)
+    {
+        addReplySds(c,sdsnew("-ERR min or max is not a valid float\r\n"));
+        return;
+    }
+    for (j = 4; j < c->argc; j++) {
+        int leftargs = c->argc-j-1;
+
+        if (!strcasecmp(c->argv[j]->ptr,"withscores")) {
+            withscores = 1;
+        } else if (!strcasecmp(c->argv[j]->ptr,"limit") && leftargs >= 2) {
+            offset = atoi(c->argv[j+1]->ptr);
+            limit = atoi(c->argv[j+2]->ptr);
+            j += 2;
+        } else {
+            addReply(c,shared.syntaxerr);
+            return;
+        }
+    }
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.nullmultibulk);
+        return;
+    }
+    if (o->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    zsl = ((zset*)o->ptr)->zsl;
+
+    ln = reverse ? zslLastInRange(zsl,&range) : zslFirstInRange(zsl,&range);
+    if (ln == NULL || offset < 0 || limit == 0) {
+        addReply(c,shared.emptymultibulk);
+        return;
+    }
+
+    /* We don't know in advance how many matching elements there are in
+     * the range, so we output a placeholder for the multi bulk length
+     * that is fixed at the end */
+    lenobj = createObject(REDIS_STRING,NULL);
+    addReply(c,lenobj);
+    decrRefCount(lenobj);
+
+    while (ln && offset--)
+        ln = reverse ? ln->backward : ln->level[0].forward;
+    while (ln && limit--) {
+        /* The other end of the range */
+        if (reverse ? !zslValueGteMin(ln->score,&range) :
+                      !zslValueLteMax(ln->score,&range)) break;
+        addReplyZsetNode(c,ln,withscores);
+        rangelen++;
+        ln = reverse ? ln->backward : ln->level[0].forward;
+    }
+    lenobj->ptr = sdscatprintf(sdsempty(),"*%lu\r\n",
+        withscores ? rangelen*2 : rangelen);
+}
+
+//返回分数在范围内的元素，分数从小到大
+static void zrangebyscoreCommand(redisClient *c) {
+    zrangebyscoreGenericCommand(c,0);
+}
+
+//返回分数在范围内的元素，分数从大到小
+static void zrevrangebyscoreCommand(redisClient *c) {
+    zrangebyscoreGenericCommand(c,1);
+}
+
+/* ZCOUNT key min max. The count is the difference of the ranks of the first
+ * and the last element in range, so it is O(log N) whatever the count. */
+//返回分数在范围内的元素个数
+static void zcountCommand(redisClient *c) {
+    zrangespec range;
+    robj *o;
+    zskiplist *zsl;
+    zskiplistNode *first, *last;
+    unsigned long count = 0;
+
+    if (zslParseRange(c->argv[2],c->argv[3],&range) == REDIS_ERR) {
+        addReplySds(c,sdsnew("-ERR min or max is not a valid float\r\n"));
+        return;
+    }
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    zsl = ((zset*)o->ptr)->zsl;
+    first = zslFirstInRange(zsl,&range);
+    if (first) {
+        last = zslLastInRange(zsl,&range);
+        count = zslGetRank(zsl,last->score,last->obj) -
+                zslGetRank(zsl,first->score,first->obj) + 1;
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",count));
+}
+
+//返回有序集合的元素个数
+static void zcardCommand(redisClient *c) {
+    robj *o;
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",
+        ((zset*)o->ptr)->zsl->length));
+}
+
+/* Lookup the node of a member for ZSCORE, ZRANK and ZREVRANK. Returns NULL
+ * after replying if the key or the member does not exist. */
+static zskiplistNode *zsetLookupMemberOrReply(redisClient *c, zset **zsp) {
+    robj *o;
+    dictEntry *de;
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.nullbulk);
+        return NULL;
+    }
+    if (o->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return NULL;
+    }
+    *zsp = o->ptr;
+    de = dictFind((*zsp)->dict,c->argv[2]);
+    if (de == NULL) {
+        addReply(c,shared.nullbulk);
+        return NULL;
+    }
+    return dictGetEntryVal(de);
+}
+
+//返回元素的分数
+static void zscoreCommand(redisClient *c) {
+    zskiplistNode *node;
+    zset *zs;
+
+    if ((node = zsetLookupMemberOrReply(c,&zs)) == NULL) return;
+    addReplyDouble(c,node->score);
+}
+
+static void zrankGenericCommand(redisClient *c, int reverse) {
+    zskiplistNode *node;
+    zset *zs;
+    unsigned long rank;
+
+    if ((node = zsetLookupMemberOrReply(c,&zs)) == NULL) return;
+    rank = zslGetRank(zs->zsl,node->score,node->obj);
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",
+        reverse ? zs->zsl->length-rank : rank-1));
+}
+
+//返回元素的排名，从0开始，分数从小到大
+static void zrankCommand(redisClient *c) {
+    zrankGenericCommand(c,0);
+}
+
+//返回元素的排名，从0开始，分数从大到小
+static void zrevrankCommand(redisClient *c) {
+    zrankGenericCommand(c,1);
+}
+
+//删除分数在范围内的元素，返回删除的个数
+static void zremrangebyscoreCommand(redisClient *c) {
+    zrangespec range;
+    robj *o;
+    zset *zs;
+    unsigned long removed;
+
+    if (zslParseRange(c->argv[2],c->argv[3],&range) == REDIS_ERR) {
+        addReplySds(c,sdsnew("-ERR min or max is not a valid float\r\n"));
+        return;
+    }
+    o = lookupKeyWrite(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    zs = o->ptr;
+    removed = zslIsInRange(zs->zsl,&range) ?
+        zslDeleteRangeByScore(zs->zsl,&range,zs->dict) : 0;
+    server.dirty += removed;
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",removed));
+}
+
+//删除排名在范围内的元素，返回删除的个数
+static void zremrangebyrankCommand(redisClient *c) {
+    robj *o;
+    zset *zs;
+    int start = atoi(c->argv[2]->ptr);
+    int end = atoi(c->argv[3]->ptr);
+    int llen;
+    unsigned long removed;
+
+    o = lookupKeyWrite(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_ZSET) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    zs = o->ptr;
+    llen = zs->zsl->length;
+
+    /* convert negative indexes */
+    if (start < 0) start = llen+start;
+    if (end < 0) end = llen+end;
+    if (start < 0) start = 0;
+    if (end < 0) end = 0;
+
+    /* indexes sanity checks */
+    if (start > end || start >= llen) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (end >= llen) end = llen-1;
+
+    /* Ranks of the skiplist start at 1 */
+    removed = zslDeleteRangeByRank(zs->zsl,start+1,end+1,zs->dict);
+    server.dirty += removed;
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",removed));
+}
+
+/* ================================== Hashes ================================ */
+
+/* Hashes are stored as a ziplist (REDIS_ENCODING_ZIPLIST) holding fields and
+ * values back to back (field1, value1, field2, value2, ...) while they have
+ * at most 'hashmaxziplistentries' fields and no field or value is longer
+ * than 'hashmaxziplistvalue' bytes, and as a hash table (REDIS_ENCODING_HT)
+ * of field -> value objects otherwise. A small hash costs a few bytes per
+ * field instead of two objects and a dict entry, finding a field is a scan
+ * of the ziplist but it is small enough to be about as fast as hashing.
+ * As for lists the conversion is one way only.
+ *
+ * The hashType*() functions hide the encoding to the commands. Objects
+ * returned are new references the caller has to release. */
+
+/* Convert the hash to a hash table if one of argv[start..end] is too long
+ * to be stored in a ziplist */
+//如果参数中有字符串太长则将ziplist转换为哈希表
+static void hashTypeTryConversion(robj *subject, robj **argv, int start, int end) {
+    int j;
+
+    if (subject->encoding != REDIS_ENCODING_ZIPLIST) return;
+    for (j = start; j <= end; j++) {
+        if (sdsEncodedObject(argv[j]) &&
+            sdslen(argv[j]->ptr) > server.hashmaxziplistvalue)
+        {
+            hashTypeConvert(subject);
+            return;
+        }
+    }
+}
+
+/* Convert a ziplist encoded hash to a hash table */
+//将ziplist编码的hash转换为哈希表
+static void hashTypeConvert(robj *subject) {
+    unsigned char *zl = subject->ptr, *p;
+    dict *d;
+
+    assert(subject->encoding == REDIS_ENCODING_ZIPLIST);
+    d = dictCreate(&hashDictType,NULL);
+    if (!d) oom("dictCreate");
+    if (ziplistLen(zl)/2 > DICT_HT_INITIAL_SIZE) dictExpand(d,ziplistLen(zl)/2);
+    p = ziplistIndex(zl,0);
+    while (p) {
+        robj *field = tryObjectEncoding(ziplistEntryObject(p));
+        robj *value;
+
+        p = ziplistNext(zl,p);
+        value = tryObjectEncoding(ziplistEntryObject(p));
+        if (dictAdd(d,field,value) == DICT_ERR) oom("dictAdd");
+        p = ziplistNext(zl,p);
+    }
+    zfree(zl);
+    subject->ptr = d;
+    subject->encoding = REDIS_ENCODING_HT;
+}
+
+/* Find 'field' in a ziplist encoded hash, returning the position of the
+ * field (the value is the next entry) or NULL */
+//在ziplist中查找field，返回field所在的位置
+static unsigned char *hashZiplistFind(unsigned char *zl, robj *field) {
+    char buf[REDIS_LONGSTR_SIZE], *s;
+    size_t len;
+    unsigned char *p = ziplistIndex(zl,0);
+
+    s = stringObjectBytes(field,buf,&len);
+    while (p) {
+        if (ziplistCompare(p,(unsigned char*)s,len)) return p;
+        /* Skip the value */
+        p = ziplistNext(zl,ziplistNext(zl,p));
+    }
+    return NULL;
+}
+
+/* Value of 'field', or NULL if the field does not exist */
+//获取field的值，不存在时返回NULL
+static robj *hashTypeGetValue(robj *o, robj *field) {
+    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+        unsigned char *p = hashZiplistFind(o->ptr,field);
+
+        if (p == NULL) return NULL;
+        return ziplistEntryObject(ziplistNext(o->ptr,p));
+    } else {
+        dictEntry *de = dictFind((dict*)o->ptr,field);
+        robj *value;
+
+        if (de == NULL) return NULL;
+        value = dictGetEntryVal(de);
+        incrRefCount(value);
+        return value;
+    }
+}
+
+/* Set 'field' to 'value'. Returns 1 if the field is new, 0 if its value was
+ * updated. Call hashTypeTryConversion() first for long fields and values. */
+//设置field的值，新增field时返回1，更新时返回0
+static int hashTypeSet(robj *o, robj *field, robj *value) {
+    int update = 0;
+
+    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+        unsigned char *zl = o->ptr, *p;
+        char fbuf[REDIS_LONGSTR_SIZE], vbuf[REDIS_LONGSTR_SIZE], *fs, *vs;
+        size_t flen, vlen;
+
+        fs = stringObjectBytes(field,fbuf,&flen);
+        vs = stringObjectBytes(value,vbuf,&vlen);
+        p = hashZiplistFind(zl,field);
+        if (p) {
+            /* Replace the value in place */
+            p = ziplistNext(zl,p);
+            zl = ziplistDelete(zl,&p);
+            zl = ziplistInsert(zl,p,(unsigned char*)vs,vlen);
+            update = 1;
+        } else {
+            zl = ziplistPush(zl,(unsigned char*)fs,flen,ZIPLIST_TAIL);
+            zl = ziplistPush(zl,(unsigned char*)vs,vlen,ZIPLIST_TAIL);
+        }
+        o->ptr = zl;
+        if (!update && ziplistLen(zl)/2 > server.hashmaxziplistentries)
+            hashTypeConvert(o);
+    } else {
+        dictEntry *de = dictFind((dict*)o->ptr,field);
+
+        incrRefCount(value);
+        if (de) {
+            decrRefCount(dictGetEntryVal(de));
+            dictGetEntryVal(de) = value;
+            update = 1;
+        } else {
+            incrRefCount(field);
+            if (dictAdd((dict*)o->ptr,field,value) == DICT_ERR)
+                oom("dictAdd");
+        }
+    }
+    return !update;
+}
+
+/* Delete 'field'. Returns 1 if it was found */
+//删除field，存在时返回1
+static int hashTypeDelete(robj *o, robj *field) {
+    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+        unsigned char *zl = o->ptr, *p = hashZiplistFind(zl,field);
+
+        if (p == NULL) return 0;
+        zl = ziplistDelete(zl,&p);
+        zl = ziplistDelete(zl,&p);
+        o->ptr = zl;
+        return 1;
+    }
+    return dictDelete((dict*)o->ptr,field) == DICT_OK;
+}
+
+//hash中field的个数
+static unsigned long hashTypeLength(robj *o) {
+    if (o->encoding == REDIS_ENCODING_ZIPLIST)
+        return ziplistLen(o->ptr)/2;
+    return dictSize((dict*)o->ptr);
+}
+
+//初始化hash迭代器
+static void hashTypeInitIterator(hashTypeIterator *hi, robj *subject) {
+    hi->subject = subject;
+    hi->encoding = subject->encoding;
+    hi->fptr = hi->vptr = NULL;
+    hi->di = NULL;
+    hi->de = NULL;
+    if (hi->encoding == REDIS_ENCODING_HT) {
+        hi->di = dictGetIterator(subject->ptr);
+        if (!hi->di) oom("dictGetIterator");
+    }
+}
+
+//释放hash迭代器
+static void hashTypeReleaseIterator(hashTypeIterator *hi) {
+    if (hi->di) dictReleaseIterator(hi->di);
+}
+
+/* Move to the next field. Returns 0 when there are no more fields. */
+//移动到下一个field，没有时返回0
+static int hashTypeNext(hashTypeIterator *hi) {
+    if (hi->encoding == REDIS_ENCODING_ZIPLIST) {
+        unsigned char *zl = hi->subject->ptr;
+
+        hi->fptr = hi->vptr ? ziplistNext(zl,hi->vptr) : ziplistIndex(zl,0);
+        if (hi->fptr == NULL) return 0;
+        hi->vptr = ziplistNext(zl,hi->fptr);
+        return 1;
+    }
+    hi->de = dictNext(hi->di);
+    return hi->de != NULL;
+}
+
+/* Reply with the current field or value of the iterator. Ziplist entries
+ * are sent without creating an object. */
+//发送迭代器当前的field(what为0)或者value(what为1)
+static void addReplyHashIteratorCurrent(redisClient *c, hashTypeIterator *hi, int what) {
+    if (hi->encoding == REDIS_ENCODING_ZIPLIST) {
+        addReplyZiplistEntry(c,what ? hi->vptr : hi->fptr);
+    } else {
+        robj *o = what ? dictGetEntryVal(hi->de) : dictGetEntryKey(hi->de);
+
+        addReplyBulkLen(c,o);
+        addReply(c,o);
+        addReply(c,shared.crlf);
+    }
+}
+
+/* Current field or value of the iterator as a new object */
+//返回迭代器当前的field(what为0)或者value(what为1)
+static robj *hashTypeCurrent(hashTypeIterator *hi, int what) {
+    robj *o;
+
+    if (hi->encoding == REDIS_ENCODING_ZIPLIST)
+        return ziplistEntryObject(what ? hi->vptr : hi->fptr);
+    o = what ? dictGetEntryVal(hi->de) : dictGetEntryKey(hi->de);
+    incrRefCount(o);
+    return o;
+}
+
+/* Lookup the hash for a write, creating it if it does not exist. Returns
+ * NULL after replying if the key holds another type. */
+static robj *hashTypeLookupWriteOrCreate(redisClient *c, robj *key) {
+    robj *o = lookupKeyWrite(c->db,key);
+
+    if (o == NULL) {
+        o = createHashObject();
+        dictAdd(c->db->dict,key,o);
+        incrRefCount(key);
+    } else if (o->type != REDIS_HASH) {
+        addReply(c,shared.wrongtypeerr);
+        return NULL;
+    }
+    return o;
+}
+
+/* HSET key field value [field value ...] */
+//设置一个或多个field的值，返回新增的field个数
+static void hsetCommand(redisClient *c) {
+    robj *o;
+    int j, added = 0;
+
+    if (c->argc % 2) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    if ((o = hashTypeLookupWriteOrCreate(c,c->argv[1])) == NULL) return;
+    hashTypeTryConversion(o,c->argv,2,c->argc-1);
+    for (j = 2; j < c->argc; j += 2) {
+        c->argv[j] = tryObjectEncoding(c->argv[j]);
+        c->argv[j+1] = tryObjectEncoding(c->argv[j+1]);
+        added += hashTypeSet(o,c->argv[j],c->argv[j+1]);
+    }
+    server.dirty += (c->argc-2)/2;
+    addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",added));
+}
+
+//获取field的值
+static void hgetCommand(redisClient *c) {
+    robj *o, *value;
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.nullbulk);
+        return;
+    }
+    if (o->type != REDIS_HASH) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    if ((value = hashTypeGetValue(o,c->argv[2])) == NULL) {
+        addReply(c,shared.nullbulk);
+        return;
+    }
+    addReplyBulkLen(c,value);
+    addReply(c,value);
+    addReply(c,shared.crlf);
+    decrRefCount(value);
+}
+
+/* HMGET key field [field ...]: like MGET, a missing key is like an empty
+ * hash */
+//获取多个field的值
+static void hmgetCommand(redisClient *c) {
+    robj *o;
+    int j;
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o && o->type != REDIS_HASH) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),"*%d\r\n",c->argc-2));
+    for (j = 2; j < c->argc; j++) {
+        robj *value = o ? hashTypeGetValue(o,c->argv[j]) : NULL;
+
+        if (value == NULL) {
+            addReply(c,shared.nullbulk);
+        } else {
+            addReplyBulkLen(c,value);
+            addReply(c,value);
+            addReply(c,shared.crlf);
+            decrRefCount(value);
+        }
+    }
+}
+
+/* HINCRBY key field increment. Like INCRBY a missing field counts as 0 */
+//field的值增加increment，返回新的值
+static void hincrbyCommand(redisClient *c) {
+    long long value = 0, incr = strtoll(c->argv[3]->ptr, NULL, 10);
+    robj *o, *current, *newobj, *args[2];
+
+    if ((o = hashTypeLookupWriteOrCreate(c,c->argv[1])) == NULL) return;
+    if ((current = hashTypeGetValue(o,c->argv[2])) != NULL) {
+        if (current->encoding == REDIS_ENCODING_INT) {
+            value = (long)current->ptr;
+        } else {
+            robj *dec = getDecodedObject(current);
+
+            value = strtoll(dec->ptr, NULL, 10);
+            decrRefCount(dec);
+        }
+        decrRefCount(current);
+    }
+
+    value += incr;
+    newobj = createStringObjectFromLongLong(value);
+    args[0] = c->argv[2];
+    args[1] = newobj;
+    hashTypeTryConversion(o,args,0,1);
+    c->argv[2] = tryObjectEncoding(c->argv[2]);
+    hashTypeSet(o,c->argv[2],newobj);
+    decrRefCount(newobj);
+    server.dirty++;
+    addReplySds(c,sdscatprintf(sdsempty(),":%lld\r\n",value));
+}
+
+/* HDEL key field [field ...]. Like lists and sets the hash is kept when
+ * it becomes empty. */
+//删除一个或多个field，返回删除的个数
+static void hdelCommand(redisClient *c) {
+    robj *o;
+    int j, deleted = 0;
+
+    o = lookupKeyWrite(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_HASH) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    for (j = 2; j < c->argc; j++)
+        deleted += hashTypeDelete(o,c->argv[j]);
+    server.dirty += deleted;
+    addReplySds(c,sdscatprintf(sdsempty(),":%d\r\n",deleted));
+}
+
+//返回field的个数
+static void hlenCommand(redisClient *c) {
+    robj *o;
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_HASH) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",hashTypeLength(o)));
+}
+
+//返回所有的field和value
+static void hgetallCommand(redisClient *c) {
+    robj *o;
+    hashTypeIterator hi;
+
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.emptymultibulk);
+        return;
+    }
+    if (o->type != REDIS_HASH) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),"*%lu\r\n",hashTypeLength(o)*2));
+    hashTypeInitIterator(&hi,o);
+    while (hashTypeNext(&hi)) {
+        addReplyHashIteratorCurrent(c,&hi,0);
+        addReplyHashIteratorCurrent(c,&hi,1);
+    }
+    hashTypeReleaseIterator(&hi);
+}
+
+/* ================================= Bitmaps ================================ */
+
+/* Bitmaps are not a type of their own but string values whose bits are
+ * addressed one by one, the most significant bit of the first byte being
+ * bit 0. SETBIT grows the string as needed, filling it with zero bytes, so
+ * the largest offset decides how much memory the bitmap uses. */
+
+/* The offset is limited to 2^32 bits, that is a 512MB string, the same
+ * limit of bulk arguments */
+#define REDIS_BITMAP_MAX_OFFSET (4294967296LL)
+
+//解析位的偏移量，出错时返回REDIS_ERR并且回复客户端
+static int getBitOffsetOrReply(redisClient *c, robj *o, size_t *offset) {
+    char *eptr;
+    long long value;
+
+    errno = 0;
+    value = strtoll(o->ptr,&eptr,10);
+    if (((char*)o->ptr)[0] == '\0' || eptr[0] != '\0' || errno == ERANGE ||
+        value < 0 || value >= REDIS_BITMAP_MAX_OFFSET)
+    {
+        addReplySds(c,sdsnew(
+            "-ERR bit offset is not an integer or out of range\r\n"));
+        return REDIS_ERR;
+    }
+    *offset = (size_t)value;
+    return REDIS_OK;
+}
+
+/* Lookup the string at 'key' in order to modify it in place, creating an
+ * empty one if the key does not exist. On type mismatch an error is sent
+ * to the client and NULL is returned. */
+//查找用于修改的位图，需要时先创建或者转成raw编码
+static robj *bitmapLookupWriteOrCreate(redisClient *c, robj *key) {
+    robj *o = lookupKeyWrite(c->db,key);
+
+    if (o == NULL) {
+        o = createObject(REDIS_STRING,sdsempty());
+        dictAdd(c->db->dict,key,o);
+        incrRefCount(key);
+    } else if (o->type != REDIS_STRING) {
+        addReply(c,shared.wrongtypeerr);
+        return NULL;
+    } else {
+        o = dbUnshareStringValue(c->db,key,o);
+    }
+    return o;
+}
+
+/* Return the bytes of the bitmap 'o' stored at 'key' as a new reference.
+ * Sparse bitmaps compress very well, so instead of inflating an LZF value
+ * on every GETBIT or BITCOUNT it is inflated once in place. */
+//返回位图的sds表示，LZF压缩的值先原地解压，使用后需要decrRefCount
+static robj *bitmapGetDecoded(redisDb *db, robj *key, robj *o) {
+    if (o->encoding == REDIS_ENCODING_LZF) o = dbUnshareStringValue(db,key,o);
+    return getDecodedObject(o);
+}
+
+/* SETBIT key offset value. Returns the previous value of the bit */
+//设置offset位置的位，返回原来的值
+static void setbitCommand(redisClient *c) {
+    robj *o;
+    char *bitval = c->argv[3]->ptr;
+    size_t offset, byte;
+    int bit, old;
+
+    if (getBitOffsetOrReply(c,c->argv[2],&offset) == REDIS_ERR) return;
+    if ((bitval[0] != '0' && bitval[0] != '1') || bitval[1] != '\0') {
+        addReplySds(c,sdsnew(
+            "-ERR bit is not an integer or out of range\r\n"));
+        return;
+    }
+    if ((o = bitmapLookupWriteOrCreate(c,c->argv[1])) == NULL) return;
+
+    byte = offset >> 3;
+    bit = 7 - (offset & 7);
+    o->ptr = sdsgrowzero(o->ptr,byte+1);
+    old = (((unsigned char*)o->ptr)[byte] >> bit) & 1;
+    if (bitval[0] == '1')
+        ((unsigned char*)o->ptr)[byte] |= 1 << bit;
+    else
+        ((unsigned char*)o->ptr)[byte] &= ~(1 << bit);
+    server.dirty++;
+    addReply(c,old ? shared.cone : shared.czero);
+}
+
+/* GETBIT key offset. Bits past the end of the string are zero */
+//返回offset位置的位
+static void getbitCommand(redisClient *c) {
+    robj *o, *dec;
+    size_t offset, byte;
+    int bitval = 0;
+
+    if (getBitOffsetOrReply(c,c->argv[2],&offset) == REDIS_ERR) return;
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_STRING) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    dec = bitmapGetDecoded(c->db,c->argv[1],o);
+    byte = offset >> 3;
+    if (byte < sdslen(dec->ptr))
+        bitval = (((unsigned char*)dec->ptr)[byte] >> (7 - (offset & 7))) & 1;
+    decrRefCount(dec);
+    addReply(c,bitval ? shared.cone : shared.czero);
+}
+
+/* BITCOUNT key [start end]. start and end are byte indexes, negative
+ * values count from the end of the string like in LRANGE */
+//统计置1的位数
+static void bitcountCommand(redisClient *c) {
+    robj *o, *dec;
+    long start = 0, end = -1, len;
+    size_t count = 0;
+
+    if (c->argc != 2 && c->argc != 4) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    if (c->argc == 4) {
+        start = atol(c->argv[2]->ptr);
+        end = atol(c->argv[3]->ptr);
+    }
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_STRING) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    dec = bitmapGetDecoded(c->db,c->argv[1],o);
+    len = sdslen(dec->ptr);
+    if (start < 0) start = len+start;
+    if (end < 0) end = len+end;
+    if (start < 0) start = 0;
+    if (end >= len) end = len-1;
+    if (start <= end)
+        count = bitmapCount((unsigned char*)dec->ptr+start,end-start+1);
+    decrRefCount(dec);
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",(unsigned long)count));
+}
+
+/* BITOP AND|OR|XOR|NOT destkey key [key ...]. Missing keys and the bytes
+ * past the end of the shorter strings count as zero. The result is as long
+ * as the longest source, and an empty result removes destkey. Replies with
+ * the length of the result. */
+//对多个位图进行位运算，结果保存在destkey中
+static void bitopCommand(redisClient *c) {
+    char *opname = c->argv[1]->ptr;
+    int op, j, numsrc = c->argc-3;
+    robj **objs, *o;
+    const unsigned char **src;
+    size_t *len, maxlen = 0;
+    sds res = NULL;
+
+    if (!strcasecmp(opname,"and")) op = BITMAP_OP_AND;
+    else if (!strcasecmp(opname,"or")) op = BITMAP_OP_OR;
+    else if (!strcasecmp(opname,"xor")) op = BITMAP_OP_XOR;
+    else if (!strcasecmp(opname,"not")) op = BITMAP_OP_NOT;
+    else {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    if (op == BITMAP_OP_NOT && numsrc != 1) {
+        addReplySds(c,sdsnew(
+            "-ERR BITOP NOT must be called with a single source key\r\n"));
+        return;
     }
 
-    /* We are ready to sort the vector... perform a bit of sanity check
-     * on the LIMIT option too. We'll use a partial version of quicksort. */
-    start = (limit_start < 0) ? 0 : limit_start;
-    end = (limit_count < 0) ? vectorlen-1 : start+limit_count-1;
-    if (start >= vectorlen) {
-        start = vectorlen-1;
-        end = vectorlen-2;
+    objs = zmalloc(sizeof(robj*)*numsrc);
+    src = zmalloc(sizeof(unsigned char*)*numsrc);
+    len = zmalloc(sizeof(size_t)*numsrc);
+    for (j = 0; j < numsrc; j++) {
+        o = lookupKeyRead(c->db,c->argv[j+3]);
+        if (o == NULL) {
+            objs[j] = NULL;
+            src[j] = NULL;
+            len[j] = 0;
+            continue;
+        }
+        if (o->type != REDIS_STRING) {
+            while (j--) if (objs[j]) decrRefCount(objs[j]);
+            zfree(objs);
+            zfree(src);
+            zfree(len);
+            addReply(c,shared.wrongtypeerr);
+            return;
+        }
+        objs[j] = bitmapGetDecoded(c->db,c->argv[j+3],o);
+        src[j] = objs[j]->ptr;
+        len[j] = sdslen(objs[j]->ptr);
+        if (len[j] > maxlen) maxlen = len[j];
     }
-    if (end >= vectorlen) end = vectorlen-1;
 
-    if (dontsort == 0) {
-        server.sort_desc = desc;
-        server.sort_alpha = alpha;
-        server.sort_bypattern = sortby ? 1 : 0;
-        if (sortby && (start != 0 || end != vectorlen-1))
-            pqsort(vector,vectorlen,sizeof(redisSortObject),sortCompare, start,end);
-        else
-            qsort(vector,vectorlen,sizeof(redisSortObject),sortCompare);
+    if (maxlen) {
+        res = sdsnewlen(NULL,maxlen);
+        bitmapOp(op,(unsigned char*)res,src,len,numsrc);
     }
+    for (j = 0; j < numsrc; j++) if (objs[j]) decrRefCount(objs[j]);
+    zfree(objs);
+    zfree(src);
+    zfree(len);
 
-    /* Send command output to the output buffer, performing the specified
-     * GET/DEL/INCR/DECR operations if any. */
-    outputlen = getop ? getop*(end-start+1) : end-start+1;
-    addReplySds(c,sdscatprintf(sdsempty(),"*%d\r\n",outputlen));
-    for (j = start; j <= end; j++) {
-        listNode *ln;
-        if (!getop) {
-            addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",
-                sdslen(vector[j].obj->ptr)));
-            addReply(c,vector[j].obj);
-            addReply(c,shared.crlf);
+    if (maxlen) {
+        o = createObject(REDIS_STRING,res);
+        if (dictAdd(c->db->dict,c->argv[2],o) == DICT_ERR) {
+            dbOverwrite(c->db,c->argv[2],o);
+        } else {
+            incrRefCount(c->argv[2]);
         }
-        listRewind(operations);
-        while((ln = listYield(operations))) {
-            redisSortOperation *sop = ln->value;
-            robj *val = lookupKeyByPattern(c->db,sop->pattern,
-                vector[j].obj);
+        removeExpire(c->db,c->argv[2]);
+    } else {
+        deleteKey(c->db,c->argv[2]);
+    }
+    server.dirty++;
+    addReplySds(c,sdscatprintf(sdsempty(),":%lu\r\n",(unsigned long)maxlen));
+}
 
-            if (sop->type == REDIS_SORT_GET) {
-                if (!val || val->type != REDIS_STRING) {
-                    addReply(c,shared.nullbulk);
-                } else {
-                    addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",
-                        sdslen(val->ptr)));
-                    addReply(c,val);
-                    addReply(c,shared.crlf);
-                }
-            } else if (sop->type == REDIS_SORT_DEL) {
-                /* TODO */
-            }
+/* ============================== HyperLogLog =============================== */
+
+/* HyperLogLogs are string values too, see hyperloglog.c for the format, so
+ * they can be read with GET and restored with SET. The header is checked
+ * before a value is used as a HyperLogLog. */
+
+//检查字符串是否是一个HyperLogLog，不是的话回复错误
+static int hllValidOrReply(redisClient *c, sds s) {
+    if (hllValid(s)) return 1;
+    addReply(c,shared.invalidhllerr);
+    return 0;
+}
+
+/* PFADD key [element ...]. Returns 1 if the approximated cardinality may
+ * have changed (a register was modified or the key was created) */
+//添加元素到HyperLogLog中
+static void pfaddCommand(redisClient *c) {
+    robj *o = lookupKeyWrite(c->db,c->argv[1]);
+    int j, retval, updated = 0;
+    sds s;
+
+    if (o == NULL) {
+        o = createObject(REDIS_STRING,hllNew());
+        dictAdd(c->db->dict,c->argv[1],o);
+        incrRefCount(c->argv[1]);
+        updated++;
+    } else {
+        if (o->type != REDIS_STRING) {
+            addReply(c,shared.wrongtypeerr);
+            return;
         }
+        o = dbUnshareStringValue(c->db,c->argv[1],o);
+        if (!hllValidOrReply(c,o->ptr)) return;
     }
 
-    /* Cleanup */
-    decrRefCount(sortval);
-    listRelease(operations);
-    for (j = 0; j < vectorlen; j++) {
-        if (sortby && alpha && vector[j].u.cmpobj)
-            decrRefCount(vector[j].u.cmpobj);
+    s = o->ptr;
+    for (j = 2; j < c->argc; j++) {
+        sds ele = c->argv[j]->ptr;
+
+        retval = hllAdd(&s,(unsigned char*)ele,sdslen(ele),
+                        server.hllsparsemaxbytes);
+        if (retval == -1) {
+            o->ptr = s;
+            addReply(c,shared.corrupthllerr);
+            return;
+        }
+        updated += retval;
     }
-    zfree(vector);
+    o->ptr = s;
+    if (updated) server.dirty++;
+    addReply(c,updated ? shared.cone : shared.czero);
 }
-//打印一些日志
-static void infoCommand(redisClient *c) {
-    sds info;
-    time_t uptime = time(NULL)-server.stat_starttime;
+
+/* PFCOUNT key [key ...]. With a single key the cardinality is cached in the
+ * value, and recomputed only if PFADD modified the registers since then.
+ * With many keys the cardinality of their union is returned: the registers
+ * are merged in a temporary buffer and nothing is cached. */
+//返回HyperLogLog的近似基数，多个key时返回并集的基数
+static void pfcountCommand(redisClient *c) {
+    robj *o, *dec;
+    uint64_t card;
     int j;
 
-    info = sdscatprintf(sdsempty(),
-        "redis_version:%s\r\n"
-        "uptime_in_seconds:%d\r\n"
-        "uptime_in_days:%d\r\n"
-        "connected_clients:%d\r\n"
-        "connected_slaves:%d\r\n"
-        "used_memory:%zu\r\n"
-        "changes_since_last_save:%lld\r\n"
-        "bgsave_in_progress:%d\r\n"
-        "last_save_time:%d\r\n"
-        "total_connections_received:%lld\r\n"
-        "total_commands_processed:%lld\r\n"
-        "role:%s\r\n"
-        ,REDIS_VERSION,
-        uptime,
-        uptime/(3600*24),
-        listLength(server.clients)-listLength(server.slaves),
-        listLength(server.slaves),
-        server.usedmemory,
-        server.dirty,
-        server.bgsaveinprogress,
-        server.lastsave,
-        server.stat_numconnections,
-        server.stat_numcommands,
-        server.masterhost == NULL ? "master" : "slave"
-    );
-    if (server.masterhost) {
-        info = sdscatprintf(info,
-            "master_host:%s\r\n"
-            "master_port:%d\r\n"
-            "master_link_status:%s\r\n"
-            "master_last_io_seconds_ago:%d\r\n"
-            ,server.masterhost,
-            server.masterport,
-            (server.replstate == REDIS_REPL_CONNECTED) ?
-                "up" : "down",
-            (int)(time(NULL)-server.master->lastinteraction)
-        );
+    if (c->argc > 2) {
+        uint8_t *regs = zmalloc(HLL_REGISTERS);
+
+        memset(regs,0,HLL_REGISTERS);
+        for (j = 1; j < c->argc; j++) {
+            int retval;
+
+            if ((o = lookupKeyRead(c->db,c->argv[j])) == NULL) continue;
+            if (o->type != REDIS_STRING) {
+                zfree(regs);
+                addReply(c,shared.wrongtypeerr);
+                return;
+            }
+            dec = getDecodedObject(o);
+            retval = hllValidOrReply(c,dec->ptr) ?
+                     hllMerge(regs,dec->ptr) : -2;
+            decrRefCount(dec);
+            if (retval < 0) {
+                zfree(regs);
+                if (retval == -1) addReply(c,shared.corrupthllerr);
+                return;
+            }
+        }
+        card = hllCountRegisters(regs);
+        zfree(regs);
+        addReplySds(c,sdscatprintf(sdsempty(),":%llu\r\n",
+            (unsigned long long)card));
+        return;
     }
-    for (j = 0; j < server.dbnum; j++) {
-        long long keys, vkeys;
 
-        keys = dictSize(server.db[j].dict);
-        vkeys = dictSize(server.db[j].expires);
-        if (keys || vkeys) {
-            info = sdscatprintf(info, "db%d: keys=%lld,expires=%lld\r\n",
-                j, keys, vkeys);
+    o = lookupKeyRead(c->db,c->argv[1]);
+    if (o == NULL) {
+        addReply(c,shared.czero);
+        return;
+    }
+    if (o->type != REDIS_STRING) {
+        addReply(c,shared.wrongtypeerr);
+        return;
+    }
+    dec = getDecodedObject(o);
+    if (!hllValidOrReply(c,dec->ptr)) {
+        decrRefCount(dec);
+        return;
+    }
+    if (hllCachedCount(dec->ptr,&card)) {
+        decrRefCount(dec);
+    } else {
+        /* Store the new cardinality in a private copy of the value. As the
+         * value changes this is replicated like a write. */
+        decrRefCount(dec);
+        o = dbUnshareStringValue(c->db,c->argv[1],o);
+        if (hllCount(o->ptr,&card) == -1) {
+            addReply(c,shared.corrupthllerr);
+            return;
         }
+        server.dirty++;
     }
-    addReplySds(c,sdscatprintf(sdsempty(),"$%d\r\n",sdslen(info)));
-    addReplySds(c,info);
-    addReply(c,shared.crlf);
+    addReplySds(c,sdscatprintf(sdsempty(),":%llu\r\n",
+        (unsigned long long)card));
 }
 
-static void monitorCommand(redisClient *c) {
-    /* ignore MONITOR if aleady slave or in monitor mode */
-    if (c->flags & REDIS_SLAVE) return;
+/* PFMERGE destkey [sourcekey ...]. destkey becomes the union of itself and
+ * the source HyperLogLogs, always dense encoded */
+//合并多个HyperLogLog保存到destkey中
+static void pfmergeCommand(redisClient *c) {
+    uint8_t *regs = zmalloc(HLL_REGISTERS);
+    robj *o, *dec;
+    int j, retval;
 
-    c->flags |= (REDIS_SLAVE|REDIS_MONITOR);
-    c->slaveseldb = 0;
-    if (!listAddNodeTail(server.monitors,c)) oom("listAddNodeTail");
+    memset(regs,0,HLL_REGISTERS);
+    for (j = 1; j < c->argc; j++) {
+        o = (j == 1) ? lookupKeyWrite(c->db,c->argv[j]) :
+                       lookupKeyRead(c->db,c->argv[j]);
+        if (o == NULL) continue;
+        if (o->type != REDIS_STRING) {
+            zfree(regs);
+            addReply(c,shared.wrongtypeerr);
+            return;
+        }
+        dec = getDecodedObject(o);
+        retval = hllValidOrReply(c,dec->ptr) ? hllMerge(regs,dec->ptr) : -2;
+        decrRefCount(dec);
+        if (retval < 0) {
+            zfree(regs);
+            if (retval == -1) addReply(c,shared.corrupthllerr);
+            return;
+        }
+    }
+
+    o = createObject(REDIS_STRING,hllNewDense(regs));
+    zfree(regs);
+    if (dictAdd(c->db->dict,c->argv[1],o) == DICT_ERR) {
+        dbOverwrite(c->db,c->argv[1],o);
+    } else {
+        incrRefCount(c->argv[1]);
+    }
+    server.dirty++;
     addReply(c,shared.ok);
 }
 
@@ -4286,13 +8574,8 @@ static void slaveofCommand(redisClient *c) {
  *///释放内存，如果超过了最大限制
 static void freeMemoryIfNeeded(void) {
     while (server.maxmemory && zmalloc_used_memory() > server.maxmemory) {
-        if (listLength(server.objfreelist)) {//从objfreelist中删除
-            robj *o;
-
-            listNode *head = listFirst(server.objfreelist);
-            o = listNodeValue(head);
-            listDelNode(server.objfreelist,head);
-            zfree(o);
+        if (server.objfreelist) {//从objfreelist中删除
+            server.stat_objfreelist_trimmed += trimObjFreelist(1);
         } else {//删除过期健
             int j, k, freed = 0;
 
@@ -4315,7 +8598,8 @@ static void freeMemoryIfNeeded(void) {
                             minttl = t;
                         }
                     }
-                    deleteKey(server.db+j,minkey);
+                    /* Free it now, we need the memory back to stop */
+                    deleteKeyGeneric(server.db+j,minkey,0);
                 }
             }
             if (!freed) return; /* nothing to free... */
@@ -4323,6 +8607,272 @@ static void freeMemoryIfNeeded(void) {
     }
 }
 
+/* =========================== Memory introspection ========================= */
+
+/* Return the approximated number of bytes used by the object 'o'. For lists
+ * and sets only up to 'samples' elements are looked at, and their average
+ * size is used for all the elements (samples == 0 means all the elements).
+ * The robj, sds headers, list nodes and hash table entries and buckets are
+ * all accounted, the allocator overhead is not. */
+//计算对象占用的内存(估算值)
+static size_t objectComputeSize(robj *o, int samples) {
+    size_t asize = sizeof(*o), elesize = 0;
+    int sampled = 0;
+
+    switch(o->type) {
+    case REDIS_STRING:
+        if (o->encoding == REDIS_ENCODING_RAW)
+            asize += sdsAllocSize(o->ptr);
+        else if (o->encoding == REDIS_ENCODING_EMBSTR)
+            asize += sizeof(struct sdshdr8)+sdslen(o->ptr)+1;
+        else if (o->encoding == REDIS_ENCODING_LZF)
+            asize += sizeof(redisLzfString)+((redisLzfString*)o->ptr)->clen;
+        break;
+    case REDIS_LIST: {
+        quicklist *ql = o->ptr;
+        quicklistNode *node;
+
+        if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+            asize += ziplistBlobLen(o->ptr);
+            break;
+        }
+        asize += sizeof(quicklist)+
+                 sizeof(quicklistNode)*quicklistNodeCount(ql);
+        node = ql->head;
+        while(node && (!samples || sampled < samples)) {
+            elesize += node->sz;
+            sampled++;
+            node = node->next;
+        }
+        if (sampled) asize += elesize*quicklistNodeCount(ql)/sampled;
+        break;
+    }
+    case REDIS_SET: {
+        dict *d = o->ptr;
+        dictIterator *di;
+        dictEntry *de;
+
+        if (o->encoding == REDIS_ENCODING_INTSET) {
+            asize += intsetBlobLen(o->ptr);
+            break;
+        }
+        asize += sizeof(dict)+sizeof(dictEntry*)*dictSlots(d)+
+                 sizeof(dictEntry)*dictSize(d);
+        if (!dictSize(d)) break;
+        if (samples && (unsigned long)samples < dictSize(d)) {
+            /* Random sampling, as the first entries of the table are
+             * not any better than others */
+            while(sampled < samples) {
+                de = dictGetRandomKey(d);
+                elesize += objectComputeSize(dictGetEntryKey(de),0);
+                sampled++;
+            }
+        } else {
+            di = dictGetIterator(d);
+            if (!di) oom("dictGetIterator");
+            while((de = dictNext(di)) != NULL) {
+                elesize += objectComputeSize(dictGetEntryKey(de),0);
+                sampled++;
+            }
+            dictReleaseIterator(di);
+        }
+        asize += elesize*dictSize(d)/sampled;
+        break;
+    }
+    case REDIS_HASH: {
+        dict *d = o->ptr;
+        dictIterator *di;
+        dictEntry *de;
+
+        if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+            asize += ziplistBlobLen(o->ptr);
+            break;
+        }
+        asize += sizeof(dict)+sizeof(dictEntry*)*dictSlots(d)+
+                 sizeof(dictEntry)*dictSize(d);
+        if (!dictSize(d)) break;
+        di = dictGetIterator(d);
+        if (!di) oom("dictGetIterator");
+        while((de = dictNext(di)) != NULL &&
+              (!samples || sampled < samples))
+        {
+            elesize += objectComputeSize(dictGetEntryKey(de),0)+
+                       objectComputeSize(dictGetEntryVal(de),0);
+            sampled++;
+        }
+        dictReleaseIterator(di);
+        asize += elesize*dictSize(d)/sampled;
+        break;
+    }
+    case REDIS_ZSET: {
+        zset *zs = o->ptr;
+        zskiplistNode *ln = zs->zsl->header;
+        unsigned long len = zs->zsl->length;
+
+        /* Nodes have 1/(1-ZSKIPLIST_P) levels on average. Members are
+         * sampled from the head of the skiplist. */
+        asize += sizeof(zset)+sizeof(zskiplist)+sizeof(zskiplistNode)+
+                 sizeof(struct zskiplistLevel)*ZSKIPLIST_MAXLEVEL+
+                 sizeof(dict)+sizeof(dictEntry*)*dictSlots(zs->dict)+
+                 (sizeof(dictEntry)+sizeof(zskiplistNode)+
+                  (size_t)(sizeof(struct zskiplistLevel)/(1-ZSKIPLIST_P)))*len;
+        while((ln = ln->level[0].forward) != NULL &&
+              (!samples || sampled < samples))
+        {
+            elesize += objectComputeSize(ln->obj,0);
+            sampled++;
+        }
+        if (sampled) asize += elesize*len/sampled;
+        break;
+    }
+    default:
+        break;
+    }
+    return asize;
+}
+
+/* Bytes used by a key in the DB: the key, the value and the entry of the
+ * main hash table. */
+static size_t keyComputeSize(robj *key, robj *val, int samples) {
+    return objectComputeSize(key,0)+objectComputeSize(val,samples)+
+           sizeof(dictEntry);
+}
+
+/* Sample 'count' random keys of the DB, adding their size to the per type
+ * counters reported by INFO. Every REDIS_MEMSAMPLE_WINDOW samples all the
+ * counters are halved, so old samples fade away and the estimate follows
+ * the changes of the dataset. */
+//对数据库进行采样，统计每种类型占用的内存
+static void sampleDbMemory(redisDb *db, int count) {
+    int j, t;
+
+    if (dictSize(db->dict) == 0) return;
+    for (j = 0; j < count; j++) {
+        dictEntry *de = dictGetRandomKey(db->dict);
+        robj *key = dictGetEntryKey(de), *val = dictGetEntryVal(de);
+
+        if (val->type >= REDIS_NUM_TYPES) continue;
+        db->memsamplebytes[val->type] +=
+            keyComputeSize(key,val,REDIS_MEMSAMPLE_ELEMENTS);
+        db->memsamplekeys++;
+    }
+    if (db->memsamplekeys >= REDIS_MEMSAMPLE_WINDOW) {
+        for (t = 0; t < REDIS_NUM_TYPES; t++) db->memsamplebytes[t] /= 2;
+        db->memsamplekeys /= 2;
+    }
+}
+
+/* MEMORY USAGE <key> [SAMPLES <count>]
+ *
+ * Reply with the approximated number of bytes used by the key. By default
+ * REDIS_MEMSAMPLE_ELEMENTS elements of aggregate values are sampled,
+ * SAMPLES 0 forces to look at all the elements. */
+static void memoryCommand(redisClient *c) {
+    int samples = REDIS_MEMSAMPLE_ELEMENTS;
+    dictEntry *de;
+
+    if (strcasecmp(c->argv[1]->ptr,"usage") ||
+        (c->argc != 3 && c->argc != 5) ||
+        (c->argc == 5 && strcasecmp(c->argv[3]->ptr,"samples")))
+    {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    if (c->argc == 5) samples = atoi(c->argv[4]->ptr);
+    if (samples < 0) samples = 0;
+
+    expireIfNeeded(c->db,c->argv[2]);
+    de = dictFind(c->db->dict,c->argv[2]);
+    if (de == NULL) {
+        addReply(c,shared.nullbulk);
+        return;
+    }
+    addReplySds(c,sdscatprintf(sdsempty(),":%zu\r\n",
+        keyComputeSize(dictGetEntryKey(de),dictGetEntryVal(de),samples)));
+}
+
+/* Entry of the biggest keys array, kept sorted by size, biggest first */
+typedef struct bigKey {
+    robj *key;
+    int type;
+    size_t size;
+} bigKey;
+
+/* DEBUG BIGKEYS <count> [<samples>]
+ *
+ * Look at 'samples' random keys of the DB (1000 by default) and reply with
+ * the 'count' biggest ones found, as "<key> <type> <bytes>" strings. Being
+ * sampled there is no guarantee the reply contains the biggest keys of the
+ * DB, but the cost is bounded whatever the size of the DB is. */
+static void debugBigkeysCommand(redisClient *c) {
+    long count = strtol(c->argv[2]->ptr,NULL,10), samples = 1000;
+    long found = 0, j, k, lo, hi;
+    dictIterator *di = NULL;
+    bigKey *top;
+
+    if (c->argc == 4) samples = strtol(c->argv[3]->ptr,NULL,10);
+    if (count <= 0 || samples <= 0) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    /* No need to sample more than the keys in the DB: in this case every
+     * key is visited, as random sampling would miss some of them */
+    if ((unsigned long)samples >= dictSize(c->db->dict)) {
+        samples = dictSize(c->db->dict);
+        di = dictGetIterator(c->db->dict);
+        if (!di) oom("dictGetIterator");
+    }
+    /* We can't find more keys than the ones we sample, so whatever the
+     * client asked for the array is never bigger than the DB */
+    if (count > samples) count = samples;
+    top = zmalloc(sizeof(bigKey)*(count ? count : 1));
+    if (!top) oom("debugBigkeysCommand");
+
+    for (j = 0; j < samples; j++) {
+        dictEntry *de = di ? dictNext(di) : dictGetRandomKey(c->db->dict);
+        robj *key = dictGetEntryKey(de), *val = dictGetEntryVal(de);
+        size_t size;
+
+        /* Skip keys already sampled */
+        for (k = 0; k < found; k++)
+            if (top[k].key == key) break;
+        if (k != found) continue;
+        size = keyComputeSize(key,val,REDIS_MEMSAMPLE_ELEMENTS);
+        /* Not bigger than the smallest key of a full array? Discard it */
+        if (found == count && size <= top[found-1].size) continue;
+
+        /* Binary search the position of the new key, and shift the smaller
+         * ones down, dropping the last one if the array is full */
+        lo = 0;
+        hi = found;
+        while (lo < hi) {
+            long mid = (lo+hi)/2;
+
+            if (top[mid].size >= size) lo = mid+1;
+            else hi = mid;
+        }
+        if (found < count) found++;
+        memmove(top+lo+1,top+lo,sizeof(bigKey)*(found-lo-1));
+        top[lo].key = key;
+        top[lo].type = val->type;
+        top[lo].size = size;
+    }
+    if (di) dictReleaseIterator(di);
+
+    addReplySds(c,sdscatprintf(sdsempty(),"*%ld\r\n",found));
+    for (j = 0; j < found; j++) {
+        robj *o = createObject(REDIS_STRING,sdscatprintf(sdsempty(),
+            "%s %s %zu",(char*)top[j].key->ptr,typeName(top[j].type),
+            top[j].size));
+
+        addReplyBulkLen(c,o);
+        addReply(c,o);
+        addReply(c,shared.crlf);
+        decrRefCount(o);
+    }
+    zfree(top);
+}
+
 /* ================================= Debugging ============================== */
 //debug
 static void debugCommand(redisClient *c) {
@@ -4339,11 +8889,31 @@ static void debugCommand(redisClient *c) {
         key = dictGetEntryKey(de);
         val = dictGetEntryVal(de);
         addReplySds(c,sdscatprintf(sdsempty(),
-            "+Key at:%p refcount:%d, value at:%p refcount:%d\r\n",
-                key, key->refcount, val, val->refcount));
+            "+Key at:%p refcount:%d, value at:%p refcount:%d "
+            "encoding:%s\r\n",
+                key, key->refcount, val, val->refcount,
+                strEncoding(val->encoding)));
+    } else if (!strcasecmp(c->argv[1]->ptr,"reload")) {
+        /* Save the DB and load it again, useful to test the persistence
+         * code without restarting the server */
+        if (rdbSave(server.dbfilename) != REDIS_OK) {
+            addReply(c,shared.err);
+            return;
+        }
+        emptyDb();
+        if (rdbLoad(server.dbfilename) != REDIS_OK) {
+            addReply(c,shared.err);
+            return;
+        }
+        redisLog(REDIS_NOTICE,"DB reloaded by DEBUG RELOAD");
+        addReply(c,shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr,"bigkeys") &&
+               (c->argc == 3 || c->argc == 4)) {
+        debugBigkeysCommand(c);
     } else {
         addReplySds(c,sdsnew(
-            "-ERR Syntax error, try DEBUG [SEGFAULT|OBJECT <key>]\r\n"));
+            "-ERR Syntax error, try DEBUG [SEGFAULT|OBJECT <key>|RELOAD|"
+            "BIGKEYS <count> [<samples>]]\r\n"));
     }
 }
 
@@ -4362,6 +8932,7 @@ static struct redisFunctionSym symsTable[] = {
 {"rdbSaveBackground", (unsigned long)rdbSaveBackground},
 {"createStringObject", (unsigned long)createStringObject},
 {"replicationFeedSlaves", (unsigned long)replicationFeedSlaves},
+{"replicationFeedMonitors", (unsigned long)replicationFeedMonitors},
 {"syncWithMaster", (unsigned long)syncWithMaster},
 {"tryObjectSharing", (unsigned long)tryObjectSharing},
 {"removeExpire", (unsigned long)removeExpire},
@@ -4404,6 +8975,7 @@ static struct redisFunctionSym symsTable[] = {
 {"lrangeCommand", (unsigned long)lrangeCommand},
 {"ltrimCommand", (unsigned long)ltrimCommand},
 {"typeCommand", (unsigned long)typeCommand},
+{"memoryCommand", (unsigned long)memoryCommand},
 {"lsetCommand", (unsigned long)lsetCommand},
 {"saddCommand", (unsigned long)saddCommand},
 {"sremCommand", (unsigned long)sremCommand},
@@ -4411,12 +8983,42 @@ static struct redisFunctionSym symsTable[] = {
 {"sismemberCommand", (unsigned long)sismemberCommand},
 {"scardCommand", (unsigned long)scardCommand},
 {"spopCommand", (unsigned long)spopCommand},
+{"srandmemberCommand", (unsigned long)srandmemberCommand},
 {"sinterCommand", (unsigned long)sinterCommand},
 {"sinterstoreCommand", (unsigned long)sinterstoreCommand},
+{"sintercardCommand", (unsigned long)sintercardCommand},
 {"sunionCommand", (unsigned long)sunionCommand},
 {"sunionstoreCommand", (unsigned long)sunionstoreCommand},
 {"sdiffCommand", (unsigned long)sdiffCommand},
 {"sdiffstoreCommand", (unsigned long)sdiffstoreCommand},
+{"zaddCommand", (unsigned long)zaddCommand},
+{"zincrbyCommand", (unsigned long)zincrbyCommand},
+{"zremCommand", (unsigned long)zremCommand},
+{"zrangeCommand", (unsigned long)zrangeCommand},
+{"zrevrangeCommand", (unsigned long)zrevrangeCommand},
+{"zrangebyscoreCommand", (unsigned long)zrangebyscoreCommand},
+{"zrevrangebyscoreCommand", (unsigned long)zrevrangebyscoreCommand},
+{"zcountCommand", (unsigned long)zcountCommand},
+{"zcardCommand", (unsigned long)zcardCommand},
+{"zscoreCommand", (unsigned long)zscoreCommand},
+{"zrankCommand", (unsigned long)zrankCommand},
+{"zrevrankCommand", (unsigned long)zrevrankCommand},
+{"zremrangebyscoreCommand", (unsigned long)zremrangebyscoreCommand},
+{"zremrangebyrankCommand", (unsigned long)zremrangebyrankCommand},
+{"hsetCommand", (unsigned long)hsetCommand},
+{"hgetCommand", (unsigned long)hgetCommand},
+{"hmgetCommand", (unsigned long)hmgetCommand},
+{"hincrbyCommand", (unsigned long)hincrbyCommand},
+{"hdelCommand", (unsigned long)hdelCommand},
+{"hlenCommand", (unsigned long)hlenCommand},
+{"hgetallCommand", (unsigned long)hgetallCommand},
+{"setbitCommand", (unsigned long)setbitCommand},
+{"getbitCommand", (unsigned long)getbitCommand},
+{"bitcountCommand", (unsigned long)bitcountCommand},
+{"bitopCommand", (unsigned long)bitopCommand},
+{"pfaddCommand", (unsigned long)pfaddCommand},
+{"pfcountCommand", (unsigned long)pfcountCommand},
+{"pfmergeCommand", (unsigned long)pfmergeCommand},
 {"syncCommand", (unsigned long)syncCommand},
 {"flushdbCommand", (unsigned long)flushdbCommand},
 {"flushallCommand", (unsigned long)flushallCommand},
@@ -1,6 +1,11 @@
 //发生内存错误时终止程序
 #define SDS_ABORT_ON_OOM
 
+/* Strings growing past this size preallocate at most this many bytes more,
+ * instead of doubling: a 512MB bitmap should not take 1GB */
+//字符串增长时最多预分配1MB
+#define SDS_MAX_PREALLOC (1024*1024)
+
 #include "sds.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,12 +21,66 @@ static void sdsOomAbort(void) {
     abort();//出错时直接终止程序
 }
 
+//返回type类型的header的大小
+int sdsHdrSize(char type) {
+    switch(type&SDS_TYPE_MASK) {
+    case SDS_TYPE_8: return sizeof(struct sdshdr8);
+    case SDS_TYPE_16: return sizeof(struct sdshdr16);
+    case SDS_TYPE_32: return sizeof(struct sdshdr32);
+    case SDS_TYPE_64: return sizeof(struct sdshdr64);
+    }
+    return 0;
+}
+
+//根据字符串的长度选择header的类型
+char sdsReqType(size_t len) {
+    if (len < 1<<8) return SDS_TYPE_8;
+    if (len < 1<<16) return SDS_TYPE_16;
+    if (len < 1ll<<32) return SDS_TYPE_32;
+    return SDS_TYPE_64;
+}
+
+//返回buf的容量
+static size_t sdsalloc(const sds s) {
+    switch(s[-1]&SDS_TYPE_MASK) {
+    case SDS_TYPE_8: return SDS_HDR(8,s)->alloc;
+    case SDS_TYPE_16: return SDS_HDR(16,s)->alloc;
+    case SDS_TYPE_32: return SDS_HDR(32,s)->alloc;
+    case SDS_TYPE_64: return SDS_HDR(64,s)->alloc;
+    }
+    return 0;
+}
+
+//设置字符串的长度
+static void sdssetlen(sds s, size_t newlen) {
+    switch(s[-1]&SDS_TYPE_MASK) {
+    case SDS_TYPE_8: SDS_HDR(8,s)->len = newlen; break;
+    case SDS_TYPE_16: SDS_HDR(16,s)->len = newlen; break;
+    case SDS_TYPE_32: SDS_HDR(32,s)->len = newlen; break;
+    case SDS_TYPE_64: SDS_HDR(64,s)->len = newlen; break;
+    }
+}
+
+//设置buf的容量
+static void sdssetalloc(sds s, size_t newlen) {
+    switch(s[-1]&SDS_TYPE_MASK) {
+    case SDS_TYPE_8: SDS_HDR(8,s)->alloc = newlen; break;
+    case SDS_TYPE_16: SDS_HDR(16,s)->alloc = newlen; break;
+    case SDS_TYPE_32: SDS_HDR(32,s)->alloc = newlen; break;
+    case SDS_TYPE_64: SDS_HDR(64,s)->alloc = newlen; break;
+    }
+}
+
 //新建一个字符串，并将其初始化，初始化时，取init字符串中initlen个字符
 sds sdsnewlen(const void *init, size_t initlen) {
-    struct sdshdr *sh;
+    char type = sdsReqType(initlen);
+    int hdrlen = sdsHdrSize(type);
+    unsigned char *sh;
+    sds s;
+
     //创建字符串存储空间，多创建一个1，是因为C语言中的字符串
     //均有一个\0结束符
-    sh = zmalloc(sizeof(struct sdshdr)+initlen+1);
+    sh = zmalloc(hdrlen+initlen+1);
 #ifdef SDS_ABORT_ON_OOM
     //如果内存分配失败的情况下，直接终止程序的运行
     if (sh == NULL) sdsOomAbort();
@@ -29,19 +88,20 @@ sds sdsnewlen(const void *init, size_t initlen) {
     //如果内存分配失败的情况下，返回NULL
     if (sh == NULL) return NULL;
 #endif
-    //记录内存空间的实际使用量
-    sh->len = initlen;
-    //记录内存空间的余下多少
-    sh->free = 0;
+    s = (char*)sh+hdrlen;
+    s[-1] = type;
+    //记录字符串的长度以及容量
+    sdssetlen(s,initlen);
+    sdssetalloc(s,initlen);
     if (initlen) {
         //如果设置了init的情况下，复制initlen个字符
-        if (init) memcpy(sh->buf, init, initlen);
+        if (init) memcpy(s, init, initlen);
         //否则将内存全部置为0
-        else memset(sh->buf,0,initlen);
+        else memset(s,0,initlen);
     }
     //结尾字符,C语言中字符串均以\0结尾
-    sh->buf[initlen] = '\0';
-    return (char*)sh->buf;
+    s[initlen] = '\0';
+    return s;
 }
 
 //生成一个空字符串
@@ -60,11 +120,16 @@ sds sdsnew(const char *init) {
 
 /*
  * 获取字符串的长度
- * 字符串的长度是存放在sdshdr结构中的len里面
+ * 字符串的长度是存放在header中的len里面
  */
 size_t sdslen(const sds s) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
-    return sh->len;
+    switch(s[-1]&SDS_TYPE_MASK) {
+    case SDS_TYPE_8: return SDS_HDR(8,s)->len;
+    case SDS_TYPE_16: return SDS_HDR(16,s)->len;
+    case SDS_TYPE_32: return SDS_HDR(32,s)->len;
+    case SDS_TYPE_64: return SDS_HDR(64,s)->len;
+    }
+    return 0;
 }
 
 /*
@@ -79,64 +144,102 @@ sds sdsdup(const sds s) {
  */
 void sdsfree(sds s) {
     if (s == NULL) return;
-    zfree(s-sizeof(struct sdshdr));
+    zfree(s-sdsHdrSize(s[-1]));
 }
 
 /*
  * 返回字符串中还有多少空间可以使用
  */
 size_t sdsavail(sds s) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
-    return sh->free;
+    return sdsalloc(s)-sdslen(s);
+}
+
+/*
+ * 返回字符串占用的全部内存(header+容量+结尾的\0)
+ */
+size_t sdsAllocSize(sds s) {
+    return sdsHdrSize(s[-1])+sdsalloc(s)+1;
 }
 
 /*
  * 更新字符串的长度
  */
 void sdsupdatelen(sds s) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
-    int reallen = strlen(s);
-    sh->free += (sh->len-reallen);
-    sh->len = reallen;
+    sdssetlen(s,strlen(s));
 }
 
 /*
  * 给字符串增加长度
  */
 static sds sdsMakeRoomFor(sds s, size_t addlen) {
-    struct sdshdr *sh, *newsh;
+    void *sh, *newsh;
     //还有多少空间
     size_t free = sdsavail(s);
     size_t len, newlen;
+    char type, oldtype = s[-1] & SDS_TYPE_MASK;
+    int hdrlen;
     //如果余下空间还足够的话
     if (free >= addlen) return s;
     //获取字符串的长度
     len = sdslen(s);
-    sh = (void*) (s-(sizeof(struct sdshdr)));
-    newlen = (len+addlen)*2;
-    newsh = zrealloc(sh, sizeof(struct sdshdr)+newlen+1);
+    sh = (char*)s-sdsHdrSize(oldtype);
+    newlen = len+addlen;
+    if (newlen < SDS_MAX_PREALLOC)
+        newlen *= 2;
+    else
+        newlen += SDS_MAX_PREALLOC;
+
+    /* The new capacity may need a bigger header */
+    type = sdsReqType(newlen);
+    hdrlen = sdsHdrSize(type);
+    if (oldtype == type) {
+        newsh = zrealloc(sh, hdrlen+newlen+1);
+    } else {
+        //header的类型变了，只能重新分配内存然后复制字符串
+        newsh = zmalloc(hdrlen+newlen+1);
+        if (newsh != NULL) {
+            memcpy((char*)newsh+hdrlen, s, len+1);
+            zfree(sh);
+        }
+    }
     //内存分配失败的情况下进行处理
 #ifdef SDS_ABORT_ON_OOM
     if (newsh == NULL) sdsOomAbort();
 #else
     if (newsh == NULL) return NULL;
 #endif
-    //新的余下空间
-    newsh->free = newlen - len;
-    return newsh->buf;
+    s = (char*)newsh+hdrlen;
+    s[-1] = type;
+    sdssetlen(s,len);
+    //新的容量
+    sdssetalloc(s,newlen);
+    return s;
+}
+
+/* Grow the string to have the specified length. The bytes that were not part
+ * of the string are set to zero. If the string is already long enough
+ * nothing is done. */
+//将字符串增长到len，新增的部分填0
+sds sdsgrowzero(sds s, size_t len) {
+    size_t curlen = sdslen(s);
+
+    if (len <= curlen) return s;
+    s = sdsMakeRoomFor(s,len-curlen);
+    if (s == NULL) return NULL;
+    /* Also zero the terminator position */
+    memset(s+curlen,0,len-curlen+1);
+    sdssetlen(s,len);
+    return s;
 }
 
 //进行字符串的拼接操作
 sds sdscatlen(sds s, void *t, size_t len) {
-    struct sdshdr *sh;
     size_t curlen = sdslen(s);
 
     s = sdsMakeRoomFor(s,len);
     if (s == NULL) return NULL;
-    sh = (void*) (s-(sizeof(struct sdshdr)));
     memcpy(s+curlen, t, len);
-    sh->len = curlen+len;
-    sh->free = sh->free-len;
+    sdssetlen(s,curlen+len);
     s[curlen+len] = '\0';
     return s;
 }
@@ -148,20 +251,14 @@ sds sdscat(sds s, char *t) {
 
 //进行字符串的copy,会覆盖掉原字符串
 sds sdscpylen(sds s, char *t, size_t len) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
-    //字符串s代表的字符串的总共长度
-    size_t totlen = sh->free+sh->len;
-
-    if (totlen < len) {
-        s = sdsMakeRoomFor(s,len-totlen);
+    //字符串s的总容量
+    if (sdsalloc(s) < len) {
+        s = sdsMakeRoomFor(s,len-sdslen(s));
         if (s == NULL) return NULL;
-        sh = (void*) (s-(sizeof(struct sdshdr)));
-        totlen = sh->free+sh->len;
     }
     memcpy(s, t, len);
     s[len] = '\0';
-    sh->len = len;
-    sh->free = totlen-len;
+    sdssetlen(s,len);
     return s;
 }
 
@@ -204,7 +301,6 @@ sds sdscatprintf(sds s, const char *fmt, ...) {
 
 //字符串中去掉首尾包含cset里的字符
 sds sdstrim(sds s, const char *cset) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
     char *start, *end, *sp, *ep;
     size_t len;
     //字符串的开始位置
@@ -217,18 +313,16 @@ sds sdstrim(sds s, const char *cset) {
     while(ep > start && strchr(cset, *ep)) ep--;
     len = (sp > ep) ? 0 : ((ep-sp)+1);
     //字符串的内存移动操作
-    if (sh->buf != sp) memmove(sh->buf, sp, len);
-    sh->buf[len] = '\0';
+    if (s != sp) memmove(s, sp, len);
+    s[len] = '\0';
     //字符串的余下空间增长
-    sh->free = sh->free+(sh->len-len);
-    sh->len = len;
+    sdssetlen(s,len);
     return s;
 }
 
 //获取指定范围里的字符串
 //类似于pyhon里面a[-5:-1]
 sds sdsrange(sds s, long start, long end) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
     size_t newlen, len = sdslen(s);
 
     if (len == 0) return s;
@@ -248,10 +342,9 @@ sds sdsrange(sds s, long start, long end) {
     } else {
         start = 0;
     }
-    if (start != 0) memmove(sh->buf, sh->buf+start, newlen);
-    sh->buf[newlen] = 0;
-    sh->free = sh->free+(sh->len-newlen);
-    sh->len = newlen;
+    if (start != 0) memmove(s, s+start, newlen);
+    s[newlen] = 0;
+    sdssetlen(s,newlen);
     return s;
 }
 
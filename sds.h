@@ -7,6 +7,7 @@
 
 //系统头文件，与类型定义相关
 #include <sys/types.h>
+#include <stdint.h>
 
 /*
  * sds实际上就是一个char *指针
@@ -21,23 +22,59 @@ typedef char *sds;
  * 此结构中存放着字符串，以及字符器的长度
  * buf用来存放字符串
  * len表示字符串的实际长度
- * free表示空间中还有多少空余空间能够使用
- */
+ * alloc表示buf的容量(不包括结尾的\0)，alloc-len就是余下的空间
+ * flags的低3位表示header的类型(SDS_TYPE_*)
+ */
+
+/* The header is selected according to the string length, so that short
+ * strings (the vast majority of keys and values) pay a 3 bytes header
+ * instead of 16. The structures are packed, and the flags byte is always
+ * the one just before buf, so s[-1] tells the header type of any sds. */
+struct __attribute__ ((__packed__)) sdshdr8 {
+    uint8_t len;            /* used */
+    uint8_t alloc;          /* excluding the header and null terminator */
+    unsigned char flags;    /* 3 lsb of type, 5 unused bits */
+    char buf[];
+};
+struct __attribute__ ((__packed__)) sdshdr16 {
+    uint16_t len;
+    uint16_t alloc;
+    unsigned char flags;
+    char buf[];
+};
+struct __attribute__ ((__packed__)) sdshdr32 {
+    uint32_t len;
+    uint32_t alloc;
+    unsigned char flags;
+    char buf[];
+};
+struct __attribute__ ((__packed__)) sdshdr64 {
+    uint64_t len;
+    uint64_t alloc;
+    unsigned char flags;
+    char buf[];
+};
+
+#define SDS_TYPE_8  1
+#define SDS_TYPE_16 2
+#define SDS_TYPE_32 3
+#define SDS_TYPE_64 4
+#define SDS_TYPE_MASK 7
+//获取s的header
+#define SDS_HDR(T,s) ((struct sdshdr##T *)((s)-(sizeof(struct sdshdr##T))))
 
 /*
- * 最后重点提醒一下，sdshdr这个结构体
- * 实际占用的内存空间为8字节
- * buf占用的内存为0字节
+ * 返回type类型的header的大小
  */
+int sdsHdrSize(char type);
 
-struct sdshdr {
-    long len;
-    long free;
-    char buf[];
-};
+/*
+ * 返回能够保存长度为len的字符串的最小header类型
+ */
+char sdsReqType(size_t len);
 
 /*
- * 开设空间，空间大小为sizeof(sdshdr)+initlen+1
+ * 开设空间，空间大小为header大小+initlen+1
  * 将init所指向的字符串copy到开设空间buf处
  * 失败时返回NULL
  * 成功时返回sdshdr->buf的地址
@@ -57,7 +94,7 @@ sds sdsnew(const char *init);
  * 创建空字符串
  * 其实只分配了1字节
  * 即创建空字符串时的内存情况为
- * sizeof(int)+sizeof(int)+1
+ * sizeof(struct sdshdr8)+1
  */
 
 sds sdsempty();
@@ -83,11 +120,23 @@ void sdsfree(sds s);
 
 /*
  * 返回字符串空间中余下未使用的空间
- * 实际上就是返回sdshdr中free变量的值
+ * 实际上就是返回header中alloc-len的值
  */
 
 size_t sdsavail(sds s);
 
+/*
+ * 返回字符串占用的全部内存空间(包括header)
+ */
+
+size_t sdsAllocSize(sds s);
+
+/*
+ * 将字符串增长到len个字节，新增的字节都是0
+ * len不大于当前长度时什么也不做，较长的字符串最多预分配1MB
+ */
+sds sdsgrowzero(sds s, size_t len);
+
 /*
  * 进行字符串的拼接
  */
@@ -127,7 +176,7 @@ sds sdstrim(sds s, const char *cset);
 sds sdsrange(sds s, long start, long end);
 
 /*
- * 更新sdshdr中的len字段以及free字段
+ * 更新header中的len字段
  * 实际上调用的是strlen函数
  * 然后做相应的加减法
  */
@@ -143,6 +143,67 @@ proc main {server port} {
         $r decrby novar 17179869185
     } {-1}
 
+    test {Numeric values are integer encoded and GET returns them verbatim} {
+        set res {}
+        $r set novar 12345
+        lappend res [$r get novar]
+        lappend res [string match {*encoding:int*} [$r debug object novar]]
+        $r set novar 0012
+        lappend res [$r get novar]
+        lappend res [string match {*encoding:embstr*} [$r debug object novar]]
+        $r set novar -7
+        lappend res [$r incrby novar 10] [$r get novar]
+    } {12345 1 0012 1 3 3}
+
+    test {Integer encoded values survive DEBUG RELOAD and SORT BY} {
+        $r del intlist
+        foreach {id w} {1 30 2 -5 3 100000000000} {
+            $r rpush intlist $id
+            $r set weight_$id $w
+        }
+        $r debug reload
+        set res [list [$r get weight_3] [$r sort intlist by weight_*] \
+             [$r sort intlist by weight_* get weight_*]]
+        $r del intlist weight_1 weight_2 weight_3
+        set res
+    } {100000000000 {2 1 3} {-5 30 100000000000}}
+
+    test {Short strings are embedded, long strings are raw, also after reload} {
+        $r set foo [string repeat x 44]
+        $r set bar [string repeat x 45]
+        $r debug reload
+        set res [list [regexp {encoding:embstr} [$r debug object foo]] \
+                      [regexp {encoding:raw} [$r debug object bar]] \
+                      [string length [$r get foo]] [string length [$r get bar]]]
+        $r del foo bar
+        set res
+    } {1 1 44 45}
+
+    test {Small integers are shared objects} {
+        $r set foo 100
+        $r set bar 100
+        regexp {value at:([^ ]+)} [$r debug object foo] - ptr1
+        regexp {value at:([^ ]+)} [$r debug object bar] - ptr2
+        $r incr foo
+        set res [list [expr {$ptr1 eq $ptr2}] [$r get foo] [$r get bar]]
+        $r del foo bar
+        set res
+    } {1 101 100}
+
+    test {Sets and lists of small integers, SORT and SREM} {
+        $r del intset intlist
+        foreach i {5 3 10 1} {
+            $r sadd intset $i
+            $r rpush intlist $i
+        }
+        $r srem intset 10
+        $r lrem intlist 0 3
+        set res [list [$r sort intset] [$r sort intlist alpha] \
+            [$r sismember intset 5] [$r lrange intlist 0 -1]]
+        $r del intset intlist
+        set res
+    } {{1 3 5} {1 10 5} 1 {5 10 1}}
+
     test {SETNX target key missing} {
         $r setnx novar2 foobared
         $r get novar2
@@ -180,6 +241,48 @@ proc main {server port} {
         format $res
     } {1xyzk1}
 
+    test {Pipelined commands after a bulk argument sent in many packets} {
+        set fd [$r channel]
+        puts -nonewline $fd "SET k1 4\r\nxy"
+        flush $fd
+        after 50
+        puts -nonewline $fd "zk\r\nGET k1\r\nPING\r\n"
+        flush $fd
+        set res {}
+        append res [string match OK* [::redis::redis_read_reply $fd]]
+        append res [::redis::redis_read_reply $fd]
+        append res [string match PONG* [::redis::redis_read_reply $fd]]
+        format $res
+    } {1xyzk1}
+
+    test {Multi bulk requests are binary safe and can be split} {
+        set fd [$r channel]
+        set cmd "*3\r\n\$3\r\nSET\r\n\$3\r\nk 2\r\n\$4\r\na\r\nb\r\n"
+        append cmd "*2\r\n\$3\r\nGET\r\n\$3\r\nk 2\r\nPING\r\n"
+        # Send the commands in small chunks
+        for {set i 0} {$i < [string length $cmd]} {incr i 7} {
+            puts -nonewline $fd [string range $cmd $i [expr {$i+6}]]
+            flush $fd
+            after 5
+        }
+        set res [list [::redis::redis_read_reply $fd]]
+        lappend res [::redis::redis_read_reply $fd]
+        lappend res [::redis::redis_read_reply $fd]
+        puts -nonewline $fd "*2\r\n\$3\r\nDEL\r\n\$3\r\nk 2\r\n"
+        flush $fd
+        lappend res [::redis::redis_read_reply $fd]
+    } "OK {a\r\nb} PONG 1"
+
+    test {Multi bulk protocol error closes the connection} {
+        set efd [socket $server $port]
+        fconfigure $efd -translation binary
+        puts -nonewline $efd "*1\r\nPING\r\n"
+        flush $efd
+        set res [list [gets $efd]]
+        close $efd
+        set res
+    } {{}}
+
     test {Non existing command} {
         catch {$r foobaredcommand} err
         string match ERR* $err
@@ -459,6 +562,17 @@ proc main {server port} {
         lsort [$r smembers myset]
     } {bar ciao}
 
+    test {Variadic RPUSH, LPUSH, SADD and SREM} {
+        $r del vlist vset
+        $r rpush vlist a b c
+        $r lpush vlist x y
+        set res [list [$r lrange vlist 0 -1]]
+        lappend res [$r sadd vset a b c a] [$r sadd vset c d]
+        lappend res [$r srem vset a d z] [lsort [$r smembers vset]]
+        $r del vlist vset
+        set res
+    } {{y x a b c} 3 1 2 {b c}}
+
     test {Mass SADD and SINTER with two sets} {
         for {set i 0} {$i < 1000} {incr i} {
             $r sadd set1 $i
@@ -530,6 +644,16 @@ proc main {server port} {
         $r set mynormalkey {blablablba}
         $r save
     } {OK}
+
+    test {DEBUG RELOAD - all the types survive a save/load cycle} {
+        $r del myreloadset
+        for {set i 0} {$i < 100} {incr i} {$r sadd myreloadset $i}
+        $r expire mynormalkey 1000
+        $r debug reload
+        list [$r lrange mysavelist 0 -1] [$r get mynormalkey] \
+            [$r scard myreloadset] [$r sismember myreloadset 42] \
+            [expr {[$r ttl mynormalkey] > 900}]
+    } {{world hello} blablablba 100 1 1}
     
     test {Create a random list} {
         set tosort {}
@@ -566,6 +690,14 @@ proc main {server port} {
         $r sort tosort {DESC}
     } [lsort -decreasing -integer $res]
 
+    test {SORT ... STORE against the newly created list} {
+        set n [$r sort tosort {BY weight_* STORE sorted}]
+        set l [$r lrange sorted 0 -1]
+        $r del sorted
+        list $n [expr {$l eq $res}] [$r sort tosort {BY weight_* LIMIT 5 3 STORE sorted}] \
+             [$r lrange sorted 0 -1]
+    } [list 10000 1 3 [lrange $res 5 7]]
+
     test {SORT speed, sorting 10000 elements list using BY, 100 times} {
         set start [clock clicks -milliseconds]
         for {set i 0} {$i < 100} {incr i} {
@@ -607,6 +739,32 @@ proc main {server port} {
         $r sort mylist
     } [lsort -real {1.1 5.10 3.10 7.44 2.1 5.75 6.12 0.25 1.15}]
 
+    test {SORT ... STORE with GET, missing keys, expires and empty output} {
+        $r flushdb
+        foreach {id w name} {a 3 Alice b 1 Bob c 2 Carol d 4 {}} {
+            $r rpush ids $id
+            $r set w_$id $w
+            if {$name ne {}} {$r set name_$id $name}
+        }
+        $r set dst foo
+        $r expire dst 100
+        set res [list [$r sort ids {BY w_* GET name_* LIMIT 1 2 STORE dst}]]
+        lappend res [$r lrange dst 0 -1] [$r ttl dst]
+        lappend res [$r sort ids {BY w_* GET name_* GET w_* STORE dst}] [$r lrange dst 0 -1]
+        lappend res [$r sort ids {LIMIT 10 5 STORE dst}] [$r exists dst]
+        lappend res [$r sort ids {ALPHA DESC STORE ids}] [$r lrange ids 0 -1]
+        $r sadd myset z
+        $r sadd myset x
+        $r sadd myset 10
+        lappend res [$r sort myset {BY nosort STORE dst}] [$r lrange dst 0 -1]
+        $r rpush ties c
+        $r rpush ties a
+        $r rpush ties b
+        lappend res [$r sort ties {BY noweight_* STORE dst}] [$r lrange dst 0 -1]
+        $r flushdb
+        set res
+    } {2 {Carol Alice} -1 8 {Bob 1 Carol 2 Alice 3 {} 4} 0 0 4 {d c b a} 3 {10 x z} 3 {a b c}}
+
     test {LREM, remove all the occurrences} {
         $r flushall
         $r rpush mylist foo
@@ -742,6 +900,1015 @@ proc main {server port} {
         format $err
     } {ERR*}
 
+    test {MEMORY USAGE grows with the value size} {
+        $r del smallkey biglist
+        $r set smallkey foo
+        for {set i 0} {$i < 100} {incr i} {
+            $r rpush biglist [string repeat x 100]
+        }
+        set small [$r memory usage smallkey]
+        set big [$r memory usage biglist]
+        set bigall [$r memory usage biglist samples 0]
+        set res [list [expr {$small > 0 && $small < 100}] \
+                      [expr {$big > 10000}] [expr {$big == $bigall}] \
+                      [$r memory usage nokey]]
+        $r del smallkey
+        set res
+    } {1 1 1 {}}
+
+    test {DEBUG BIGKEYS reports the biggest sampled keys first} {
+        set res [$r debug bigkeys 1 10000]
+        $r del biglist
+        string match {biglist list *} [lindex $res 0]
+    } {1}
+
+    test {DEBUG BIGKEYS clamps huge counts to the sampled keys} {
+        $r flushdb
+        foreach {key len} {k1 10 k2 1000 k3 100} {
+            $r set $key [string repeat x $len]
+        }
+        set res [$r debug bigkeys 2147483647]
+        set keys {}
+        foreach item $res {lappend keys [lindex $item 0]}
+        $r flushdb
+        list $keys [$r debug bigkeys 99999999999]
+    } {{k2 k3 k1} {}}
+
+    test {INFO reports used memory, RSS and allocator} {
+        set info [$r info]
+        list [regexp {used_memory_rss:[1-9][0-9]*} $info] \
+             [regexp {mem_allocator:[a-z]+} $info]
+    } {1 1}
+
+    test {Freed objects are cached in the objects free list} {
+        $r del bigset
+        # Stay below lazyfreethreshold, bigger sets are freed in background
+        for {set i 0} {$i < 60} {incr i} {
+            $r sadd bigset [string repeat x 70]$i
+        }
+        $r del bigset
+        set info [$r info]
+        regexp {objfreelist_len:(\d+)} $info - len
+        regexp {objfreelist_hits:(\d+)} $info - hits
+        list [expr {$len >= 60}] [expr {$hits > 0}]
+    } {1 1}
+
+    test {Small lists are ziplist encoded, converted when they grow} {
+        $r del smalllist otherlist
+        foreach v {a 1 -2 300 70000 5000000000 foo 007 {}} {
+            $r rpush smalllist $v
+        }
+        $r lpush smalllist head
+        regexp {encoding:(\w+)} [$r debug object smalllist] - enc
+        set res [list $enc [$r lrange smalllist 0 -1]]
+        $r rpush smalllist [string repeat x 100]
+        regexp {encoding:(\w+)} [$r debug object smalllist] - enc
+        lappend res $enc [$r llen smalllist] [$r lindex smalllist 5]
+        for {set i 0} {$i < 200} {incr i} {$r rpush otherlist $i}
+        regexp {encoding:(\w+)} [$r debug object otherlist] - enc
+        lappend res $enc [$r lindex otherlist 199]
+        $r del smalllist otherlist
+        set res
+    } {ziplist {head a 1 -2 300 70000 5000000000 foo 007 {}} quicklist 11 70000 quicklist 199}
+
+    test {LSET, LREM, LTRIM, POP, SORT and DEBUG RELOAD with ziplists} {
+        $r del smalllist
+        foreach v {3 x 1 x 2 y x 10} {$r rpush smalllist $v}
+        $r lset smalllist 1 20
+        $r lset smalllist -1 bar
+        set res [list [$r lrem smalllist -1 x] [$r lrem smalllist 0 x]]
+        lappend res [$r lrange smalllist 0 -1]
+        lappend res [$r sort smalllist by nokey] [$r lpop smalllist]
+        lappend res [$r rpop smalllist]
+        $r ltrim smalllist 1 -1
+        lappend res [$r lrange smalllist 0 -1]
+        $r debug reload
+        regexp {encoding:(\w+)} [$r debug object smalllist] - enc
+        lappend res $enc [$r sort smalllist]
+        $r del smalllist
+        set res
+    } {1 1 {3 20 1 2 y bar} {3 20 1 2 y bar} 3 bar {1 2 y} ziplist {y 1 2}}
+
+    test {Random ziplist operations match a quicklist} {
+        $r del smalllist biglist
+        # The long element converts biglist to a quicklist
+        $r rpush smalllist a
+        $r rpush biglist [string repeat x 100]
+        $r rpush biglist a
+        $r lpop biglist
+        set err {}
+        for {set i 0} {$i < 2000} {incr i} {
+            set v [randstring 0 10 alpha]
+            if {rand() < 0.3} {set v [expr {int(rand()*1000)}]}
+            switch [expr {int(rand()*6)}] {
+                0 {set cmd [list lpush $v]}
+                1 {set cmd [list rpush $v]}
+                2 {set cmd [list lpop]}
+                3 {set cmd [list lrem [expr {int(rand()*5)-2}] $v]}
+                4 {set cmd [list lset [expr {int(rand()*10)-5}] $v]}
+                5 {set cmd [list ltrim [expr {int(rand()*3)}] [expr {int(rand()*60)-3}]]}
+            }
+            catch {eval $r [linsert $cmd 1 smalllist]} r1
+            catch {eval $r [linsert $cmd 1 biglist]} r2
+            if {$r1 ne $r2 ||
+                [$r lrange smalllist 0 -1] ne [$r lrange biglist 0 -1]} {
+                set err [list $cmd $r1 $r2]
+                break
+            }
+        }
+        regexp {encoding:(\w+)} [$r debug object smalllist] - enc1
+        regexp {encoding:(\w+)} [$r debug object biglist] - enc2
+        $r del smalllist biglist
+        list $err $enc1 $enc2
+    } {{} ziplist quicklist}
+
+    test {Integer sets are intset encoded, converted when they grow} {
+        $r del iset1 iset2
+        $r sadd iset1 5 -3 70000 5000000000 5
+        regexp {encoding:(\w+)} [$r debug object iset1] - enc
+        set res [list $enc [$r scard iset1] [lsort [$r smembers iset1]]]
+        lappend res [$r sismember iset1 70000] [$r sismember iset1 7] \
+            [$r sismember iset1 007] [$r sismember iset1 foo]
+        lappend res [$r srem iset1 -3 foo 6] [$r sadd iset1 007]
+        regexp {encoding:(\w+)} [$r debug object iset1] - enc
+        lappend res $enc [lsort [$r smembers iset1]] [$r sismember iset1 70000]
+        for {set i 0} {$i < 600} {incr i} {$r sadd iset2 $i}
+        regexp {encoding:(\w+)} [$r debug object iset2] - enc
+        lappend res $enc [$r scard iset2] [$r sismember iset2 599]
+        $r del iset1 iset2
+        set res
+    } {intset 4 {-3 5 5000000000 70000} 1 0 0 0 1 1 hashtable {007 5 5000000000 70000} 1 hashtable 600 1}
+
+    test {SINTER, SUNION, SDIFF, SMOVE, SPOP, SORT and DEBUG RELOAD with intsets} {
+        $r del iset1 iset2 hset ires
+        $r sadd iset1 1 2 3 4 5
+        $r sadd iset2 4 5 6 -1
+        $r sadd hset 3 4 x
+        set res [list [lsort -integer [$r sinter iset1 iset2]]]
+        lappend res [lsort [$r sinter iset1 hset]] [lsort [$r sdiff iset1 hset]]
+        lappend res [lsort [$r sunion iset2 hset]] [lsort [$r sdiff hset iset1]]
+        $r sinterstore ires iset1 iset2
+        regexp {encoding:(\w+)} [$r debug object ires] - enc
+        lappend res $enc
+        $r sunionstore ires iset1 hset
+        regexp {encoding:(\w+)} [$r debug object ires] - enc
+        lappend res $enc [$r scard ires]
+        lappend res [$r sort iset2] [$r smove iset1 iset2 1] [$r smove iset1 hset 2]
+        lappend res [$r sort iset2] [$r sismember hset 2]
+        $r debug reload
+        regexp {encoding:(\w+)} [$r debug object iset2] - enc
+        lappend res $enc [$r sort iset2]
+        set popped {}
+        while {[set e [$r spop iset1]] ne {}} {lappend popped $e}
+        lappend res [lsort $popped] [$r scard iset1]
+        $r del iset1 iset2 hset ires
+        set res
+    } {{4 5} {3 4} {1 2 5} {-1 3 4 5 6 x} x intset hashtable 6 {-1 4 5 6} 1 1 {-1 1 4 5 6} 1 intset {-1 1 4 5 6} {3 4 5} 0}
+
+    test {SINTER and SINTERSTORE of intsets match the generic intersection} {
+        set err {}
+        for {set round 0} {$round < 40} {incr round} {
+            $r del is1 is2 is3 hs1 ires
+            # Sizes and ranges covering the 16/32/64 bit encodings, the
+            # block kernels and the galloping search of skewed sizes
+            set range [lindex {100 1000 100000 10000000000} [expr {$round%4}]]
+            set n1 [expr {($round%3 == 0) ? 8 : int(rand()*300)+1}]
+            foreach key {is1 is2 is3} n [list $n1 400 200] {
+                for {set i 0} {$i < $n} {incr i} {
+                    $r sadd $key [expr {int(rand()*$range)-$range/2}]
+                }
+            }
+            # The same elements of is2 in a hash table
+            foreach e [$r smembers is2] {$r sadd hs1 $e}
+            $r sadd hs1 x
+            $r srem hs1 x
+            set expected [lsort -integer [$r sinter is1 hs1 is3]]
+            set got [lsort -integer [$r sinter is1 is2 is3]]
+            $r sinterstore ires is3 is1 is2
+            regexp {encoding:(\w+)} [$r debug object ires] - enc
+            if {$got ne $expected || $enc ne {intset} ||
+                [lsort -integer [$r smembers ires]] ne $expected} {
+                set err [list $round $expected $got $enc]
+                break
+            }
+        }
+        $r del is1 is2 is3 hs1 ires
+        set err
+    } {}
+
+    test {SINTERCARD with and without LIMIT} {
+        $r del is1 is2 hs1 mylist
+        foreach i {1 2 3 4 5 6 7 8 9 10} {$r sadd is1 $i}
+        foreach i {2 4 6 8 10 12} {$r sadd is2 $i}
+        foreach i {4 6 8 10 x} {$r sadd hs1 $i}
+        $r rpush mylist a
+        set res [list [$r sintercard 2 is1 is2] [$r sintercard 3 is1 is2 hs1]]
+        lappend res [$r sintercard 2 is1 is2 limit 3] [$r sintercard 2 is1 is2 LIMIT 0]
+        lappend res [$r sintercard 3 is1 hs1 is2 limit 2] [$r sintercard 1 hs1]
+        lappend res [$r sintercard 2 is1 nokey] [$r sintercard 2 is1 is2 limit 100]
+        foreach args {{0 is1} {3 is1 is2} {1 is1 is2} {1 is1 limit -1} {2 is1 mylist}} {
+            catch {eval $r sintercard $args} err
+            lappend res [string match ERR* $err]
+        }
+        $r del is1 is2 hs1 mylist
+        set res
+    } {5 4 3 5 2 5 0 5 1 1 1 1 1}
+
+    test {SUNION and SDIFF pick probing or building, same results} {
+        set err {}
+        # Set sizes making both the algorithms win for both the operations
+        foreach sizes {{5 500 500} {500 5 5} {300 300} {50 50 50 50 50 50 50}
+                       {1 0 400} {0 10 10}} {
+            set keys {}
+            array unset model
+            set i 0
+            foreach n $sizes {
+                set key uset$i
+                $r del $key
+                for {set e 0} {$e < $n} {incr e} {
+                    set v [expr {int(rand()*600)}]
+                    if {rand() < 0.1} {set v s$v}
+                    $r sadd $key $v
+                    set model($i,$v) 1
+                }
+                lappend keys $key
+                incr i
+            }
+            set union {}
+            set diff {}
+            foreach kv [array names model] {
+                lappend union [lindex [split $kv ,] 1]
+            }
+            set union [lsort -uniq $union]
+            foreach v $union {
+                if {![info exists model(0,$v)]} continue
+                set found 0
+                for {set j 1} {$j < [llength $sizes]} {incr j} {
+                    if {[info exists model($j,$v)]} {set found 1}
+                }
+                if {!$found} {lappend diff $v}
+            }
+            set diff [lsort $diff]
+            set u1 [lsort [eval $r sunion $keys]]
+            set d1 [lsort [eval $r sdiff $keys]]
+            set u2 [eval $r sunionstore ures $keys]
+            set u3 [lsort [$r smembers ures]]
+            set d2 [eval $r sdiffstore ures $keys]
+            set d3 [lsort [$r smembers ures]]
+            if {$u1 ne $union || $u3 ne $union || $u2 != [llength $union] ||
+                $d1 ne $diff || $d3 ne $diff || $d2 != [llength $diff]} {
+                set err [list $sizes $union $u1 $u3 $diff $d1 $d3]
+                break
+            }
+            eval $r del $keys ures
+        }
+        set err
+    } {}
+
+    test {SRANDMEMBER with and without count} {
+        set err {}
+        foreach {key content} [list rset1 {1 2 3 4 5 6 7 8 9 10} \
+                                    rset2 {a b c d e f g h i j}] {
+            $r del $key
+            foreach e $content {$r sadd $key $e}
+            set single [$r srandmember $key]
+            if {[lsearch $content $single] == -1} {lappend err single $single}
+            foreach count {1 2 5 7 10 20} {
+                set res [$r srandmember $key $count]
+                set expected [expr {$count > 10 ? 10 : $count}]
+                if {[llength [lsort -uniq $res]] != $expected} {
+                    lappend err $key $count $res
+                }
+                foreach e $res {
+                    if {[lsearch $content $e] == -1} {lappend err $key $e}
+                }
+            }
+            set res [$r srandmember $key -30]
+            if {[llength $res] != 30} {lappend err $key -30 $res}
+            foreach e $res {
+                if {[lsearch $content $e] == -1} {lappend err $key $e}
+            }
+            if {[$r scard $key] != 10} {lappend err $key scard}
+        }
+        $r del rset1 rset2 mylist
+        $r rpush mylist a
+        lappend err [$r srandmember nokey] [$r srandmember nokey 5] \
+            [$r srandmember rset1 0]
+        catch {$r srandmember mylist} e1
+        catch {$r srandmember rset1 foo} e2
+        $r del mylist
+        lappend err [string match ERR* $e1] [string match ERR* $e2]
+    } {{} {} {} 1 1}
+
+    test {SRANDMEMBER and SPOP refuse out of range counts} {
+        $r del rset1
+        foreach e {a b c} {$r sadd rset1 $e}
+        set res {}
+        foreach count {-9223372036854775807 -9223372036854775808 \
+                       99999999999999999999 -1048577} {
+            catch {$r srandmember rset1 $count} e
+            lappend res [string match ERR*range* $e]
+        }
+        catch {$r spop rset1 99999999999999999999} e
+        lappend res [string match ERR*range* $e]
+        lappend res [llength [$r srandmember rset1 -1048576]] [$r scard rset1]
+        $r del rset1
+        set res
+    } {1 1 1 1 1 1048576 3}
+
+    test {SPOP with count} {
+        set err {}
+        foreach content [list {1 2 3 4 5 6 7 8 9 10 11 12} \
+                              {a b c d e f g h i j k l}] {
+            foreach count {1 3 10 12 20} {
+                $r del pset
+                foreach e $content {$r sadd pset $e}
+                set popped [$r spop pset $count]
+                set left [$r smembers pset]
+                set expected [expr {$count > 12 ? 12 : $count}]
+                if {[llength [lsort -uniq $popped]] != $expected ||
+                    [lsort [concat $popped $left]] ne [lsort $content]} {
+                    lappend err $count $popped $left
+                }
+            }
+        }
+        lappend err [$r spop pset 3] [$r spop pset] [$r spop nokey 3]
+        catch {$r spop pset -1} e1
+        lappend err [string match ERR* $e1]
+    } {{} {} {} 1}
+
+    test {ZADD, ZRANGE and ZREVRANGE with and without WITHSCORES} {
+        $r del ztmp
+        set res [$r zadd ztmp 10 x 5 y 20 z 5 a]
+        lappend res [$r zadd ztmp 1 y 30 w] [$r zcard ztmp]
+        lappend res [$r zrange ztmp 0 -1] [$r zrevrange ztmp 0 -1]
+        lappend res [$r zrange ztmp 1 2 withscores] [$r zrange ztmp -2 100]
+        lappend res [$r zrange ztmp 3 1] [$r zrevrange ztmp 0 0 WITHSCORES]
+    } {4 1 5 {y a x z w} {w z x a y} {a 5 x 10} {z w} {} {w 30}}
+
+    test {ZSCORE, ZRANK, ZREVRANK and ZINCRBY} {
+        set res [list [$r zscore ztmp x] [$r zrank ztmp y] [$r zrevrank ztmp y]]
+        lappend res [$r zrank ztmp w] [$r zrank ztmp nosuch] [$r zscore ztmp nosuch]
+        lappend res [$r zincrby ztmp 25.5 y] [$r zrank ztmp y]
+        lappend res [$r zincrby ztmp -2 newone] [$r zrange ztmp 0 1]
+        lappend res [$r zscore nokey x] [$r zrank nokey x]
+    } {10 0 4 4 {} {} 26.5 3 -2 {newone a} {} {}}
+
+    test {ZRANGEBYSCORE, ZREVRANGEBYSCORE and ZCOUNT with exclusive and infinite bounds} {
+        $r del ztmp
+        foreach {s m} {1 a 2 b 3 c 4 d 5 e 6 f} {$r zadd ztmp $s $m}
+        set res [list [$r zrangebyscore ztmp 2 4] [$r zrangebyscore ztmp (2 (4]]
+        lappend res [$r zrangebyscore ztmp -inf +inf limit 1 2]
+        lappend res [$r zrangebyscore ztmp (1 inf withscores limit 3 10]
+        lappend res [$r zrevrangebyscore ztmp 4 -inf] [$r zrevrangebyscore ztmp (6 (3 limit 1 1]
+        lappend res [$r zrangebyscore ztmp 4 2] [$r zrangebyscore ztmp (3 3]
+        lappend res [$r zcount ztmp 2 4] [$r zcount ztmp (2 +inf] [$r zcount ztmp 7 8]
+        lappend res [$r zcount ztmp -inf inf]
+    } {{b c d} c {b c} {e 5 f 6} {d c b a} d {} {} 3 4 0 6}
+
+    test {ZREM, ZREMRANGEBYSCORE and ZREMRANGEBYRANK} {
+        set res [list [$r zrem ztmp a nosuch f] [$r zrange ztmp 0 -1]]
+        lappend res [$r zremrangebyscore ztmp (2 3] [$r zrange ztmp 0 -1]
+        foreach {s m} {10 x 11 y 12 z} {$r zadd ztmp $s $m}
+        lappend res [$r zremrangebyrank ztmp 1 -2] [$r zrange ztmp 0 -1]
+        lappend res [$r zremrangebyrank ztmp 5 10] [$r zremrangebyscore ztmp 100 200]
+        lappend res [$r zremrangebyrank ztmp 0 -1] [$r zcard ztmp] [$r exists ztmp]
+    } {2 {b c d e} 1 {b d e} 4 {b z} 0 0 2 0 1}
+
+    test {ZSET errors: invalid scores and ranges, wrong type} {
+        $r del ztmp mylist
+        $r rpush mylist a
+        set res {}
+        foreach cmd {{zadd ztmp foo x} {zadd ztmp nan x} {zadd ztmp 1 x 2}
+                     {zincrby ztmp bar x} {zrangebyscore ztmp a 1}
+                     {zrangebyscore ztmp 1 2 limit 1} {zcount ztmp (x 1}
+                     {zrange ztmp 0 1 foo} {zadd mylist 1 x} {zrange mylist 0 1}} {
+            catch {eval $r $cmd} err
+            lappend res [string match ERR* $err]
+        }
+        $r zadd ztmp inf x
+        catch {$r zincrby ztmp -inf x} err
+        lappend res [string match ERR* $err] [$r exists ztmp] [$r zscore ztmp x]
+        $r del mylist ztmp
+        set res
+    } {1 1 1 1 1 1 1 1 1 1 1 1 inf}
+
+    test {SORT, DEBUG RELOAD and big values freed in background with sorted sets} {
+        $r del ztmp zbig
+        foreach {s m} {3 10 1 30 2 20 -inf 5 +inf -1} {$r zadd ztmp $s $m}
+        set res [list [$r sort ztmp limit 0 5] [$r debug object ztmp]]
+        $r zadd ztmp 0.1 {a member with spaces}
+        for {set i 0} {$i < 200} {incr i} {$r zadd zbig [expr {$i*1.5}] e$i}
+        set before [list [$r zrange ztmp 0 -1 withscores] [$r zrange zbig 0 -1 withscores]]
+        $r debug reload
+        set after [list [$r zrange ztmp 0 -1 withscores] [$r zrange zbig 0 -1 withscores]]
+        lappend res [expr {$before eq $after}] [$r type ztmp]
+        set freed [lindex [regexp -inline {lazyfreed_objects:(\d+)} [$r info]] 1]
+        $r del zbig
+        after 100
+        lappend res [expr {[lindex [regexp -inline {lazyfreed_objects:(\d+)} [$r info]] 1]-$freed}]
+    } {{-1 5 10 20 30} {*encoding:skiplist*} 1 zset 1}
+
+    test {Random ZSET operations match a model} {
+        $r del zrnd
+        array unset model
+        set err {}
+        for {set i 0} {$i < 2000} {incr i} {
+            set m [expr {int(rand()*300)}]
+            set s [expr {int(rand()*50)}]
+            switch [expr {int(rand()*4)}] {
+                0 - 1 {$r zadd zrnd $s $m; set model($m) $s}
+                2 {$r zincrby zrnd 3 $m
+                   if {[info exists model($m)]} {incr model($m) 3} else {set model($m) 3}}
+                3 {$r zrem zrnd $m; unset -nocomplain model($m)}
+            }
+        }
+        set pairs {}
+        foreach m [array names model] {lappend pairs [list $m $model($m)]}
+        set sorted [lsort -integer -index 1 [lsort -ascii -index 0 $pairs]]
+        set members {}
+        set scores {}
+        foreach p $sorted {lappend members [lindex $p 0]; lappend scores [lindex $p 1]}
+        if {[$r zrange zrnd 0 -1] ne $members} {lappend err zrange}
+        if {[$r zcard zrnd] != [llength $members]} {lappend err zcard}
+        for {set j 0} {$j < 50} {incr j} {
+            set idx [expr {int(rand()*[llength $members])}]
+            set m [lindex $members $idx]
+            if {[$r zrank zrnd $m] != $idx} {lappend err zrank $m}
+            if {[$r zscore zrnd $m] != $model($m)} {lappend err zscore $m}
+            set min [expr {int(rand()*60)}]
+            set max [expr {$min+int(rand()*20)}]
+            set expected {}
+            foreach p $sorted {
+                if {[lindex $p 1] >= $min && [lindex $p 1] <= $max} {
+                    lappend expected [lindex $p 0]
+                }
+            }
+            if {[$r zrangebyscore zrnd $min $max] ne $expected ||
+                [$r zcount zrnd $min $max] != [llength $expected]} {
+                lappend err range $min $max
+            }
+        }
+        $r del zrnd
+        set err
+    } {}
+
+    test {HSET, HGET, HMGET, HLEN and HGETALL on a small hash} {
+        $r del smallhash
+        set res [list [$r hset smallhash a 1 b 2 c {with space}] [$r hset smallhash a 10]]
+        lappend res [$r hget smallhash a] [$r hget smallhash c] [$r hget smallhash x]
+        lappend res [$r hmget smallhash c x a] [$r hlen smallhash]
+        lappend res [$r hgetall smallhash] [$r hmget nokey a b] [$r hgetall nokey]
+        lappend res [$r hlen nokey] [$r hget nokey a] [$r type smallhash]
+        lappend res [string match {*encoding:ziplist*} [$r debug object smallhash]]
+    } {3 0 10 {with space} {} {{with space} {} 10} 3 {a 10 b 2 c {with space}} {{} {}} {} 0 {} hash 1}
+
+    test {HINCRBY and HDEL} {
+        set res [list [$r hincrby smallhash b 5] [$r hincrby smallhash n -3]]
+        lappend res [$r hincrby smallhash n 1] [$r hincrby newhash x 7]
+        lappend res [$r hdel smallhash a c nosuch] [$r hgetall smallhash]
+        lappend res [$r hdel smallhash b n] [$r hlen smallhash] [$r hdel nokey a]
+        $r rpush mylist a
+        foreach cmd {{hset mylist a b} {hget mylist a} {hmget mylist a}
+                     {hincrby mylist a 1} {hdel mylist a} {hgetall mylist}} {
+            catch {eval $r $cmd} err
+            lappend res [string match ERR* $err]
+        }
+        $r del mylist newhash smallhash
+        set res
+    } {7 -3 -2 7 2 {b 7 n -2} 2 0 0 1 1 1 1 1 1}
+
+    test {Hashes are converted to hash tables when they grow, DEBUG RELOAD} {
+        $r del bighash smallhash longhash
+        array unset model
+        for {set i 0} {$i < 100} {incr i} {
+            set f [randstring 1 10 alpha]
+            set v [randstring 0 10 alpha]
+            $r hset bighash $f $v
+            set model($f) $v
+        }
+        $r hset smallhash f1 v1 f2 2
+        $r hset longhash f1 v1
+        $r hset longhash f2 [string repeat x 100]
+        set res [list [lindex [$r debug object bighash] end] \
+                      [lindex [$r debug object smallhash] end] \
+                      [lindex [$r debug object longhash] end]]
+        $r debug reload
+        lappend res [lindex [$r debug object bighash] end] \
+                    [lindex [$r debug object smallhash] end] \
+                    [lindex [$r debug object longhash] end]
+        set err {}
+        foreach f [array names model] {
+            if {[$r hget bighash $f] ne $model($f)} {lappend err $f}
+        }
+        if {[$r hlen bighash] != [array size model]} {lappend err hlen}
+        lappend res $err [$r hgetall smallhash] [$r hlen longhash]
+        $r del bighash smallhash longhash
+        set res
+    } {encoding:hashtable encoding:ziplist encoding:hashtable encoding:hashtable encoding:ziplist encoding:hashtable {} {f1 v1 f2 2} 2}
+
+    test {Random hash operations match a model, both encodings} {
+        set err {}
+        foreach n {20 300} {
+            $r del rndhash
+            array unset model
+            for {set i 0} {$i < 2000} {incr i} {
+                set f [expr {int(rand()*$n)}]
+                switch [expr {int(rand()*4)}] {
+                    0 {set v v[randstring 0 20 alpha]
+                       $r hset rndhash $f $v; set model($f) $v}
+                    1 {$r hincrby rndhash $f 3
+                       if {[info exists model($f)] && [string is integer -strict $model($f)]} {
+                           incr model($f) 3
+                       } else {
+                           set model($f) 3
+                       }}
+                    2 {$r hdel rndhash $f; unset -nocomplain model($f)}
+                    3 {set got [$r hget rndhash $f]
+                       set exp [expr {[info exists model($f)] ? $model($f) : {}}]
+                       if {$got ne $exp} {lappend err $n $f $got $exp}}
+                }
+            }
+            set all {}
+            foreach {f v} [$r hgetall rndhash] {lappend all [list $f $v]}
+            set expected {}
+            foreach f [array names model] {lappend expected [list $f $model($f)]}
+            if {[lsort $all] ne [lsort $expected]} {lappend err $n hgetall}
+        }
+        $r del rndhash
+        set err
+    } {}
+
+    test {SETBIT and GETBIT, the string grows with zero bytes} {
+        $r del bm num bmnew
+        set res [list [$r setbit bm 1 1] [$r setbit bm 7 1] [$r setbit bm 7 1] [$r get bm]]
+        lappend res [$r getbit bm 1] [$r getbit bm 2] [$r getbit bm 100000] [$r getbit nokey 3]
+        lappend res [$r setbit bm 23 1] [string length [$r get bm]] [$r getbit bm 23]
+        binary scan [$r get bm] cu* bytes
+        lappend res $bytes [$r setbit bm 7 0] [$r getbit bm 7]
+        $r set num 1
+        lappend res [$r setbit num 6 1] [$r get num] [$r type num]
+        lappend res [$r setbit bmnew 0 0] [$r exists bmnew] [string length [$r get bmnew]]
+        $r del bm num bmnew
+        set res
+    } {0 0 1 A 1 0 0 0 0 3 1 {65 0 1} 1 0 0 3 string 0 1 1}
+
+    test {SETBIT on a big offset preallocates at most 1MB} {
+        $r del bm
+        $r setbit bm 100000000 1
+        set usage [$r memory usage bm]
+        $r del bm
+        expr {$usage > 12500000 && $usage < 12500000+1100000}
+    } {1}
+
+    test {SETBIT, GETBIT, BITCOUNT and BITOP errors} {
+        $r del bm mylist dest
+        $r rpush mylist a
+        set res {}
+        foreach cmd {{setbit bm -1 1} {setbit bm 4294967296 1} {setbit bm abc 1}
+                     {setbit bm 1 2} {setbit bm 1 10} {getbit bm -1} {getbit bm 1x}
+                     {setbit mylist 0 1} {getbit mylist 0} {bitcount mylist}
+                     {bitcount bm 1} {bitop foo dest bm} {bitop not dest bm bm}
+                     {bitop and dest bm mylist}} {
+            catch {eval $r $cmd} err
+            lappend res [string match ERR* $err]
+        }
+        lappend res [$r exists bm] [$r exists dest]
+        $r del mylist
+        set res
+    } {1 1 1 1 1 1 1 1 1 1 1 1 1 1 0 0}
+
+    test {BITCOUNT matches a model, with ranges and LZF compressed values} {
+        set err {}
+        foreach type {binary compr} {
+            foreach len {0 1 7 31 33 100 1000 5000} {
+                set s [randstring $len $len $type]
+                $r set bcstr $s
+                binary scan $s B* bits
+                if {[$r bitcount bcstr] != [string length [string map {0 {}} $bits]]} {
+                    lappend err $type $len
+                }
+                for {set i 0} {$i < 20} {incr i} {
+                    set start [expr {int(rand()*(2*$len+10))-$len-5}]
+                    set end [expr {int(rand()*(2*$len+10))-$len-5}]
+                    set s1 [expr {$start < 0 ? $len+$start : $start}]
+                    set e1 [expr {$end < 0 ? $len+$end : $end}]
+                    binary scan [string range $s [expr {max($s1,0)}] $e1] B* bits
+                    set exp [expr {$s1 > $e1 ? 0 : [string length [string map {0 {}} $bits]]}]
+                    set got [$r bitcount bcstr $start $end]
+                    if {$got != $exp} {lappend err $type $len $start $end $got $exp}
+                }
+            }
+        }
+        lappend err [$r bitcount nokey] [$r bitcount nokey 0 -1]
+        $r set bcstr 255
+        lappend err [$r bitcount bcstr] [$r bitcount bcstr -1 -1]
+        $r del bcstr
+        set err
+    } {0 0 11 4}
+
+    test {GETBIT and BITCOUNT inflate LZF compressed bitmaps once} {
+        $r del bm
+        $r setbit bm 100000 1
+        $r debug reload
+        regexp {encoding:(\w+)} [$r debug object bm] - enc
+        set res [list $enc [$r getbit bm 100000] [$r bitcount bm]]
+        regexp {encoding:(\w+)} [$r debug object bm] - enc
+        lappend res $enc [$r getbit bm 99999] [string length [$r get bm]]
+        $r del bm
+        set res
+    } {lzf 1 1 raw 0 12501}
+
+    test {BITOP AND, OR, XOR and NOT match a model} {
+        set err {}
+        for {set i 0} {$i < 100} {incr i} {
+            set keys {}
+            set numkeys [expr {1+int(rand()*4)}]
+            array unset src
+            for {set k 0} {$k < $numkeys} {incr k} {
+                lappend keys bsrc$k
+                if {rand() < 0.1} {
+                    $r del bsrc$k
+                    set src($k) {}
+                    continue
+                }
+                set s [randstring 0 100]
+                if {rand() < 0.1} {append s [randstring 1500 1500 compr]}
+                $r set bsrc$k $s
+                binary scan $s cu* src($k)
+            }
+            foreach op {and or xor not} {
+                if {$op eq {not} && $numkeys != 1} continue
+                set maxlen 0
+                for {set k 0} {$k < $numkeys} {incr k} {
+                    set maxlen [expr {max($maxlen,[llength $src($k)])}]
+                }
+                set exp {}
+                for {set j 0} {$j < $maxlen} {incr j} {
+                    set b [lindex $src(0) $j]
+                    if {$b eq {}} {set b 0}
+                    for {set k 1} {$k < $numkeys} {incr k} {
+                        set o [lindex $src($k) $j]
+                        if {$o eq {}} {set o 0}
+                        switch $op {
+                            and {set b [expr {$b & $o}]}
+                            or {set b [expr {$b | $o}]}
+                            xor {set b [expr {$b ^ $o}]}
+                        }
+                    }
+                    if {$op eq {not}} {set b [expr {~$b & 255}]}
+                    lappend exp $b
+                }
+                $r set bdest foo
+                $r expire bdest 100
+                set len [eval [list $r bitop $op bdest] $keys]
+                binary scan [$r get bdest] cu* got
+                if {$len != $maxlen || $got ne $exp} {lappend err $op $numkeys $len $maxlen}
+                if {$maxlen == 0 && [$r exists bdest]} {lappend err $op exists}
+                if {$maxlen && [$r ttl bdest] != -1} {lappend err $op ttl}
+            }
+        }
+        $r set bsrc0 {ab}
+        lappend err [$r bitop and bsrc0 bsrc0 nokey] [$r getbit bsrc0 1] [$r bitcount bsrc0]
+        $r setbit bsrc0 0 1
+        $r debug reload
+        lappend err [$r getbit bsrc0 0] [string length [$r get bsrc0]]
+        $r del bsrc0 bsrc1 bsrc2 bsrc3 bdest
+        set err
+    } {2 0 0 1 2}
+
+    test {PFADD, PFCOUNT basics and errors} {
+        $r del hll newhll str mylist
+        set res [list [$r pfadd hll a b c] [$r pfadd hll a] [$r pfcount hll]]
+        lappend res [$r pfadd hll] [$r pfadd newhll] [$r pfcount newhll]
+        lappend res [$r pfcount nokey] [$r type hll]
+        $r set str foo
+        $r rpush mylist a
+        foreach cmd {{pfadd str a} {pfcount str} {pfmerge hll str}
+                     {pfadd mylist a} {pfcount mylist} {pfcount hll mylist}
+                     {pfmerge mylist hll}} {
+            catch {eval $r $cmd} err
+            lappend res [string match ERR* $err]
+        }
+        lappend res [$r get str] [$r pfcount hll]
+        $r del hll newhll str mylist
+        set res
+    } {1 0 3 0 1 0 0 string 1 1 1 1 1 1 1 foo 3}
+
+    test {PFCOUNT is approximated, sparse HyperLogLogs become dense} {
+        $r del hll
+        set res {}
+        set n 0
+        foreach target {100 1000 20000} {
+            while {$n < $target} {
+                set args {}
+                for {set j 0} {$j < 100} {incr j} {lappend args ele:[incr n]}
+                eval [list $r pfadd hll] $args
+            }
+            set card [$r pfcount hll]
+            if {abs($card-$n) > $n*0.05} {lappend res $n $card}
+            set len [string length [$r get hll]]
+            lappend res [expr {$len < 3000 ? "sparse" : $len}]
+        }
+        lappend res [$r pfadd hll ele:1 ele:2] [expr {[$r pfcount hll] == $card}]
+        $r del hll
+        set res
+    } {sparse sparse 12304 0 1}
+
+    test {PFCOUNT caches the cardinality until PFADD modifies the registers} {
+        $r del hll
+        $r pfadd hll a b c d e
+        binary scan [$r get hll] @15cu res
+        lappend res [$r pfcount hll]
+        binary scan [$r get hll] @15cu b
+        lappend res $b [$r pfadd hll f] [$r pfcount hll]
+        $r del hll
+        set res
+    } {128 5 0 1 6}
+
+    test {PFMERGE and PFCOUNT of many keys, DEBUG RELOAD} {
+        $r del hll1 hll2 hll3 merged
+        for {set j 0} {$j < 1500} {incr j 100} {
+            set args1 {}
+            set args2 {}
+            for {set k $j} {$k < $j+100} {incr k} {
+                if {$k < 1000} {lappend args1 $k}
+                if {$k >= 500} {lappend args2 $k}
+            }
+            if {[llength $args1]} {eval [list $r pfadd hll1] $args1}
+            if {[llength $args2]} {eval [list $r pfadd hll2] $args2}
+        }
+        $r pfadd hll3 0 1 2
+        set union [$r pfcount hll1 hll2 hll3 nokey]
+        set res [expr {abs($union-1500) < 75}]
+        lappend res [$r pfmerge merged hll1 hll2 nokey]
+        lappend res [$r pfmerge merged hll3] [expr {[$r pfcount merged] == $union}]
+        lappend res [string length [$r get merged]]
+        $r pfmerge dense3 hll3
+        lappend res [$r pfcount dense3] [$r pfcount hll3]
+        $r set copy [$r get hll1]
+        set c1 [$r pfcount hll1]
+        $r debug reload
+        lappend res [expr {[$r pfcount copy] == $c1}] [expr {[$r pfcount merged] == $union}]
+        lappend res [$r pfadd dense3 foo] [$r pfcount dense3]
+        $r del hll1 hll2 hll3 merged dense3 copy
+        set res
+    } {1 OK OK 1 12304 3 3 1 1 1 4}
+
+    test {Corrupted HyperLogLog values are detected} {
+        $r del bad
+        set res {}
+        $r set bad "HYLL\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x80\x40\x00"
+        foreach cmd {{pfcount bad} {pfcount bad bad} {pfadd bad a} {pfmerge dst bad}} {
+            catch {eval $r $cmd} err
+            lappend res [string match {ERR Corrupted*} $err]
+        }
+        $r set bad "HYLL\x00"
+        catch {$r pfcount bad} err
+        lappend res [string match {ERR Key is not*} $err] [$r exists dst]
+        $r del bad
+        set res
+    } {1 1 1 1 1 0}
+
+    test {LINDEX, LSET and LRANGE on a quicklist with many nodes} {
+        $r del biglist
+        set l {}
+        for {set i 0} {$i < 1000} {incr i} {
+            $r rpush biglist $i
+            lappend l $i
+        }
+        set err {}
+        for {set i 0} {$i < 500} {incr i} {
+            set idx [expr {int(rand()*2100)-1050}]
+            set v [randstring 0 20 alpha]
+            set pos [expr {$idx < 0 ? [llength $l]+$idx : $idx}]
+            if {[$r lindex biglist $idx] ne [lindex $l $pos]} {
+                set err [list lindex $idx]
+                break
+            }
+            if {$pos < 0 || $pos >= [llength $l]} continue
+            $r lset biglist $idx $v
+            set l [lreplace $l $pos $pos $v]
+            if {[$r lrange biglist $idx [expr {$pos+5}]] ne
+                [lrange $l $pos [expr {$pos+5}]]} {
+                set err [list lrange $idx]
+                break
+            }
+        }
+        $r ltrim biglist 300 -301
+        $r debug reload
+        regexp {encoding:(\w+)} [$r debug object biglist] - enc
+        set res [list $err $enc [$r llen biglist]]
+        lappend res [expr {[$r lrange biglist 0 -1] eq [lrange $l 300 end-300]}]
+        $r del biglist
+        set res
+    } {{} quicklist 400 1}
+
+    test {BLPOP and BRPOP against non empty lists} {
+        $r del blist1 blist2 blist3
+        $r rpush blist2 a
+        $r rpush blist2 b
+        $r rpush blist3 c
+        set res [$r blpop blist1 blist2 blist3 0]
+        lappend res [$r brpop blist1 blist2 0] [$r brpop blist3 blist2 0]
+        $r set blist1 foo
+        catch {$r blpop blist1 0} err
+        lappend res [string match *wrong* $err]
+        catch {$r blpop blist2 -1} err
+        lappend res [string match *negative* $err]
+        $r del blist1 blist2 blist3
+        set res
+    } {blist2 a {blist2 b} {blist3 c} 1 1}
+
+    test {BLPOP blocks until a push, waiters are served in FIFO order} {
+        $r del blist1 blist2
+        set fd1 [socket $server $port]
+        set fd2 [socket $server $port]
+        fconfigure $fd1 -translation binary
+        fconfigure $fd2 -translation binary
+        # The PING after the BLPOP is processed once the client is served
+        puts -nonewline $fd1 "blpop blist1 blist2 0\r\nping\r\n"
+        flush $fd1
+        after 50
+        puts -nonewline $fd2 "brpop blist2 0\r\n"
+        flush $fd2
+        after 50
+        regexp {blocked_clients:(\d+)} [$r info] - blocked
+        set res [list $blocked]
+        $r rpush blist2 x
+        $r lpush blist2 y
+        foreach bfd [list $fd1 $fd2] {
+            set reply {}
+            for {set i 0} {$i < 5} {incr i} {lappend reply [string trim [gets $bfd]]}
+            lappend res $reply
+        }
+        lappend res [string trim [gets $fd1]] [$r exists blist2]
+        regexp {blocked_clients:(\d+)} [$r info] - blocked
+        lappend res $blocked
+        close $fd1
+        close $fd2
+        set res
+    } {2 {*2 {$6} blist2 {$1} x} {*2 {$6} blist2 {$1} y} +PONG 0 0}
+
+    test {Variadic RPUSH hands the first element to a blocked client} {
+        $r del blist1
+        set fd1 [socket $server $port]
+        fconfigure $fd1 -translation binary
+        puts -nonewline $fd1 "blpop blist1 0\r\n"
+        flush $fd1
+        after 50
+        $r rpush blist1 a b c
+        set reply {}
+        for {set i 0} {$i < 5} {incr i} {lappend reply [string trim [gets $fd1]]}
+        close $fd1
+        set res [list $reply [$r lrange blist1 0 -1]]
+        $r del blist1
+        set res
+    } {{*2 {$6} blist1 {$1} a} {b c}}
+
+    test {BLPOP timeout and client disconnection while blocked} {
+        $r del blist1
+        set fd1 [socket $server $port]
+        set fd2 [socket $server $port]
+        fconfigure $fd1 -translation binary
+        fconfigure $fd2 -translation binary
+        puts -nonewline $fd1 "blpop blist1 1\r\n"
+        flush $fd1
+        puts -nonewline $fd2 "blpop blist1 0\r\n"
+        flush $fd2
+        after 50
+        close $fd2
+        set start [clock milliseconds]
+        set res [string trim [gets $fd1]]
+        lappend res [expr {[clock milliseconds]-$start > 500}]
+        close $fd1
+        $r rpush blist1 a
+        lappend res [$r lrange blist1 0 -1]
+        regexp {blocked_clients:(\d+)} [$r info] - blocked
+        lappend res $blocked
+        $r del blist1
+        set res
+    } {*-1 1 a 0}
+
+    test {BLPOP is seen by MONITOR and slaves as LPOP} {
+        $r del blist1
+        $r rpush blist1 a
+        set mfd [socket $server $port]
+        fconfigure $mfd -translation binary
+        puts -nonewline $mfd "monitor\r\n"
+        flush $mfd
+        after 50
+        $r blpop blist1 0
+        # Skip the reply to MONITOR and the MONITOR command itself
+        while {[set res [string trim [gets $mfd]]] in {+OK monitor}} {}
+        close $mfd
+        $r del blist1
+        set res
+    } {lpop blist1}
+
+    test {Big compressible values are stored LZF compressed} {
+        set json [string repeat {{"id":1234,"name":"foo","tags":["a","b"]},} 50]
+        set rnd [randstring 2000 2000 alpha]
+        $r set bigjson $json
+        $r set bigrnd $rnd
+        set res {}
+        foreach key {bigjson bigrnd} {
+            regexp {encoding:(\w+)} [$r debug object $key] - enc
+            lappend res $enc
+        }
+        lappend res [expr {[$r get bigjson] eq $json}]
+        lappend res [expr {[lindex [$r mget bigrnd bigjson] 1] eq $json}]
+        lappend res [expr {[$r getset bigjson foo] eq $json}] [$r get bigjson]
+        $r set bigjson $json
+        $r debug reload
+        regexp {encoding:(\w+)} [$r debug object bigjson] - enc
+        lappend res $enc [expr {[$r get bigjson] eq $json}]
+        regexp {lzf_compression_ratio:([\d.]+)} [$r info] - ratio
+        lappend res [expr {$ratio > 2}]
+        $r del bigjson bigrnd
+        set res
+    } {lzf raw 1 1 1 foo lzf 1 1}
+
+    test {Big compressible values are replicated uncompressed to slaves} {
+        set json [string repeat {{"id":1234,"name":"foo","tags":["a","b"]},} 100]
+        set sfd [socket $server $port]
+        fconfigure $sfd -translation binary
+        puts -nonewline $sfd "sync\r\n"
+        flush $sfd
+        # Skip the initial payload, then look for the replicated SET
+        set len [string range [string trim [gets $sfd]] 1 end]
+        read $sfd $len
+        $r set bigjson $json
+        while {[string tolower [string trim [gets $sfd]]] ne {set}} {}
+        gets $sfd
+        set key [string trim [gets $sfd]]
+        set len [string range [string trim [gets $sfd]] 1 end]
+        set val [read $sfd $len]
+        close $sfd
+        set res [list $key [expr {$val eq $json}] [$r ping]]
+        regexp {encoding:(\w+)} [$r debug object bigjson] - enc
+        lappend res $enc
+        $r del bigjson
+        set res
+    } {bigjson 1 PONG lzf}
+
+    test {SORT BY and INCR with LZF compressed values} {
+        $r del biglist
+        foreach {id w} {a 30 b 10 c 20} {
+            $r rpush biglist $id
+            $r set weight_$id "$w[string repeat { } 2000]"
+        }
+        set res [$r sort biglist by weight_*]
+        $r set counter "7[string repeat { } 2000]"
+        lappend res [$r incr counter]
+        $r del biglist weight_a weight_b weight_c counter
+        set res
+    } {b c a 8}
+
+    test {Big values are freed in background on DEL, SET and LTRIM} {
+        regexp {lazyfreed_objects:(\d+)} [$r info] - before
+        foreach key {biglist1 biglist2 biglist3} {
+            $r del $key
+            # One element per quicklist node
+            for {set i 0} {$i < 200} {incr i} {
+                $r rpush $key [string repeat x 5000]$i
+            }
+        }
+        # Not an intset, that is a single allocation freed in place
+        $r sadd bigset e0
+        for {set i 0} {$i < 200} {incr i} {$r sadd bigset e$i}
+        $r del biglist1 bigset
+        $r set biglist2 foo
+        $r ltrim biglist3 95 104
+        after 200
+        set info [$r info]
+        regexp {lazyfreed_objects:(\d+)} $info - after
+        regexp {lazyfree_pending_objects:(\d+)} $info - pending
+        set res [list [expr {$after-$before}] $pending [$r get biglist2]]
+        lappend res [$r llen biglist3] [$r lindex biglist3 0]
+        lappend res [$r lindex biglist3 9] [$r lindex biglist3 -1]
+        $r del biglist2 biglist3
+        set res
+    } [list 4 0 foo 10 [string repeat x 5000]95 [string repeat x 5000]104 \
+            [string repeat x 5000]104]
+
+    test {FLUSHDB ASYNC and FLUSHALL ASYNC} {
+        $r select 10
+        $r set x 10
+        $r rpush biglist a
+        $r expire x 100
+        set res [$r flushdb async]
+        lappend res [$r dbsize] [$r get x]
+        $r set x 20
+        catch {$r flushdb foo} err
+        lappend res [string match ERR* $err] [$r get x]
+        $r select 11
+        $r set y 30
+        lappend res [$r flushall async] [$r dbsize]
+        $r select 9
+        lappend res [$r dbsize]
+    } {OK 0 {} 1 20 OK 0 0}
+
     foreach fuzztype {binary alpha compr} {
         test "FUZZ stresser with data model $fuzztype" {
             set err 0
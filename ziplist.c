@@ -0,0 +1,780 @@
+/* The ziplist is a specially encoded dually linked list that is designed
+ * to be very memory efficient. It stores both strings and integer values,
+ * where integers are encoded as actual integers instead of a series of
+ * characters. It allows push and pop operations on either side of the list
+ * in O(1) time. However, because every operation requires a reallocation
+ * of the memory used by the ziplist, the actual complexity is related to
+ * the amount of memory used by the ziplist, so it is only used for small
+ * lists.
+ *
+ * The general layout of the ziplist is as follows:
+ *
+ * <zlbytes><zltail><zllen><entry><entry><zlend>
+ *
+ * <zlbytes> is an unsigned 32 bit integer holding the number of bytes the
+ * ziplist occupies, so that the ziplist can be resized without traversing
+ * it first. <zltail> is the offset of the last entry, so that a pop on the
+ * far side of the list is O(1). <zllen> is the number of entries, when it
+ * is 2^16-1 the list needs to be traversed to know how many items it holds.
+ * <zlend> is a single byte equal to 255, marking the end of the list.
+ *
+ * Every entry is prefixed by a header with two pieces of information.
+ * First, the length of the previous entry, to be able to traverse the list
+ * from back to front. Second, the encoding of the entry: a string with its
+ * length, or an integer with its size.
+ *
+ * The length of the previous entry is stored in 1 byte when it is less
+ * than 254 bytes, otherwise it is a byte set to 254 followed by the length
+ * as a 4 bytes unsigned integer.
+ *
+ * The encoding byte tells how the entry is stored:
+ *
+ * |00pppppp| string of up to 63 bytes, the length is in the 6 lower bits
+ * |01pppppp|qqqqqqqq| string of up to 16383 bytes (14 bits big endian)
+ * |10______|qqqqqqqq|rrrrrrrr|ssssssss|tttttttt| string of up to 2^32-1
+ *      bytes, the length is the 4 bytes big endian number that follows
+ * |11000000| integer encoded as int16_t (2 bytes)
+ * |11010000| integer encoded as int32_t (4 bytes)
+ * |11100000| integer encoded as int64_t (8 bytes)
+ * |11111110| integer encoded as int8_t (1 byte)
+ *
+ * Integers are stored in the host byte order, ziplists are only used in
+ * memory and are never written on disk as they are.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "zmalloc.h"
+#include "ziplist.h"
+
+#define ZIP_END 255
+#define ZIP_BIGLEN 254
+
+/* Different encoding/length possibilities */
+#define ZIP_STR_MASK 0xc0
+#define ZIP_STR_06B (0 << 6)
+#define ZIP_STR_14B (1 << 6)
+#define ZIP_STR_32B (2 << 6)
+#define ZIP_INT_16B (0xc0 | 0<<4)
+#define ZIP_INT_32B (0xc0 | 1<<4)
+#define ZIP_INT_64B (0xc0 | 2<<4)
+#define ZIP_INT_8B 0xfe
+
+/* Macro to determine type */
+#define ZIP_IS_STR(enc) (((enc) & ZIP_STR_MASK) < ZIP_STR_MASK)
+
+/* Utility macros */
+//ziplist占用的字节数
+#define ZIPLIST_BYTES(zl)       (*((uint32_t*)(zl)))
+//最后一个元素的偏移量
+#define ZIPLIST_TAIL_OFFSET(zl) (*((uint32_t*)((zl)+sizeof(uint32_t))))
+//元素个数，等于UINT16_MAX时需要遍历才能得到
+#define ZIPLIST_LENGTH(zl)      (*((uint16_t*)((zl)+sizeof(uint32_t)*2)))
+#define ZIPLIST_HEADER_SIZE     (sizeof(uint32_t)*2+sizeof(uint16_t))
+#define ZIPLIST_ENTRY_HEAD(zl)  ((zl)+ZIPLIST_HEADER_SIZE)
+#define ZIPLIST_ENTRY_TAIL(zl)  ((zl)+ZIPLIST_TAIL_OFFSET(zl))
+#define ZIPLIST_ENTRY_END(zl)   ((zl)+ZIPLIST_BYTES(zl)-1)
+
+/* We know a positive increment can only be 1 because entries can only be
+ * pushed one at a time. */
+#define ZIPLIST_INCR_LENGTH(zl,incr) { \
+    if (ZIPLIST_LENGTH(zl) < UINT16_MAX) ZIPLIST_LENGTH(zl) += incr; }
+
+//解码后的元素头部信息
+typedef struct zlentry {
+    unsigned int prevrawlensize, prevrawlen;
+    unsigned int lensize, len;
+    unsigned int headersize;
+    unsigned char encoding;
+    unsigned char *p;
+} zlentry;
+
+//内存出错函数
+static void ziplistOomAbort(void) {
+    fprintf(stderr,"ziplist: Out Of Memory\n");
+    abort();
+}
+
+/* Return the encoding pointed to by 'p'. */
+//获取p指向的编码，字符串编码只保留高2位
+static unsigned char zipEntryEncoding(unsigned char *p) {
+    /* String encoding: 2 MSBs */
+    unsigned char b = p[0] & ZIP_STR_MASK;
+    if (b < ZIP_STR_MASK) return b;
+    return p[0];
+}
+
+/* Return bytes needed to store integer encoded by 'encoding' */
+//整数编码需要的字节数
+static unsigned int zipIntSize(unsigned char encoding) {
+    switch(encoding) {
+    case ZIP_INT_8B:  return sizeof(int8_t);
+    case ZIP_INT_16B: return sizeof(int16_t);
+    case ZIP_INT_32B: return sizeof(int32_t);
+    case ZIP_INT_64B: return sizeof(int64_t);
+    }
+    assert(NULL);
+    return 0;
+}
+
+/* Decode the encoded length pointed by 'p'. If a pointer to 'lensize' is
+ * provided, it is set to the number of bytes required to encode the length. */
+//解码元素的长度(字符串的长度或者整数占用的字节数)
+static unsigned int zipDecodeLength(unsigned char *p, unsigned int *lensize) {
+    unsigned char encoding = zipEntryEncoding(p);
+    unsigned int len = 0;
+
+    if (ZIP_IS_STR(encoding)) {
+        switch(encoding) {
+        case ZIP_STR_06B:
+            len = p[0] & 0x3f;
+            if (lensize) *lensize = 1;
+            break;
+        case ZIP_STR_14B:
+            len = ((p[0] & 0x3f) << 8) | p[1];
+            if (lensize) *lensize = 2;
+            break;
+        case ZIP_STR_32B:
+            len = ((uint32_t)p[1] << 24) |
+                  ((uint32_t)p[2] << 16) |
+                  ((uint32_t)p[3] <<  8) |
+                  ((uint32_t)p[4]);
+            if (lensize) *lensize = 5;
+            break;
+        default:
+            assert(NULL);
+        }
+    } else {
+        len = zipIntSize(encoding);
+        if (lensize) *lensize = 1;
+    }
+    return len;
+}
+
+/* Encode the length 'rawlen' writing it in 'p'. If p is NULL it just returns
+ * the amount of bytes required to encode such a length. */
+//编码元素的长度，p为NULL时只返回需要的字节数
+static unsigned int zipEncodeLength(unsigned char *p, unsigned char encoding, unsigned int rawlen) {
+    unsigned char len = 1, buf[5];
+
+    if (ZIP_IS_STR(encoding)) {
+        /* Although encoding is given it may not be set for strings,
+         * so we determine it here using the raw length. */
+        if (rawlen <= 0x3f) {
+            if (!p) return len;
+            buf[0] = ZIP_STR_06B | rawlen;
+        } else if (rawlen <= 0x3fff) {
+            len += 1;
+            if (!p) return len;
+            buf[0] = ZIP_STR_14B | ((rawlen >> 8) & 0x3f);
+            buf[1] = rawlen & 0xff;
+        } else {
+            len += 4;
+            if (!p) return len;
+            buf[0] = ZIP_STR_32B;
+            buf[1] = (rawlen >> 24) & 0xff;
+            buf[2] = (rawlen >> 16) & 0xff;
+            buf[3] = (rawlen >> 8) & 0xff;
+            buf[4] = rawlen & 0xff;
+        }
+    } else {
+        /* Implies integer encoding, so length is always 1. */
+        if (!p) return len;
+        buf[0] = encoding;
+    }
+
+    /* Store this length at p */
+    memcpy(p,buf,len);
+    return len;
+}
+
+/* Decode the length of the previous element stored at "p". */
+//解码前一个元素的长度
+static unsigned int zipPrevDecodeLength(unsigned char *p, unsigned int *lensize) {
+    unsigned int len = *p;
+
+    if (len < ZIP_BIGLEN) {
+        if (lensize) *lensize = 1;
+    } else {
+        if (lensize) *lensize = 1+sizeof(len);
+        memcpy(&len,p+1,sizeof(len));
+    }
+    return len;
+}
+
+/* Encode the length of the previous entry and write it to "p". Return the
+ * number of bytes needed to encode this length if "p" is NULL. */
+//编码前一个元素的长度，p为NULL时只返回需要的字节数
+static unsigned int zipPrevEncodeLength(unsigned char *p, unsigned int len) {
+    if (p == NULL) {
+        return (len < ZIP_BIGLEN) ? 1 : sizeof(len)+1;
+    } else {
+        if (len < ZIP_BIGLEN) {
+            p[0] = len;
+            return 1;
+        } else {
+            p[0] = ZIP_BIGLEN;
+            memcpy(p+1,&len,sizeof(len));
+            return 1+sizeof(len);
+        }
+    }
+}
+
+/* Encode the length of the previous entry using the 5 bytes form even if a
+ * single byte would be enough. Used when the entry already has room for it,
+ * as shrinking the header would require moving the rest of the ziplist. */
+//使用5个字节编码前一个元素的长度
+static void zipPrevEncodeLengthForceLarge(unsigned char *p, unsigned int len) {
+    p[0] = ZIP_BIGLEN;
+    memcpy(p+1,&len,sizeof(len));
+}
+
+/* Return the difference in number of bytes needed to store the new length
+ * "len" on the entry pointed to by "p". */
+//在p中保存len需要的字节数与现有字节数的差值
+static int zipPrevLenByteDiff(unsigned char *p, unsigned int len) {
+    unsigned int prevlensize;
+
+    zipPrevDecodeLength(p,&prevlensize);
+    return zipPrevEncodeLength(NULL,len)-prevlensize;
+}
+
+/* Check if string pointed to by 'entry' can be encoded as an integer.
+ * Only the canonical representation is encoded (no spaces, no leading
+ * zeroes, no '+' sign), so the string can be rebuilt verbatim. Stores the
+ * integer value in 'v' and its encoding in 'encoding'. */
+//判断字符串能否编码为整数
+static int zipTryEncoding(unsigned char *entry, unsigned int entrylen, long long *v, unsigned char *encoding) {
+    char buf[32], *eptr;
+    long long value;
+    int len;
+
+    if (entrylen == 0 || entrylen >= 21) return 0;
+    memcpy(buf,entry,entrylen);
+    buf[entrylen] = '\0';
+    value = strtoll(buf,&eptr,10);
+    if (eptr[0] != '\0') return 0;
+    len = snprintf(buf,sizeof(buf),"%lld",value);
+    if ((unsigned)len != entrylen || memcmp(buf,entry,entrylen)) return 0;
+
+    /* Great, the string can be encoded. Check what's the smallest
+     * of our encoding types that can hold this value. */
+    if (value >= INT8_MIN && value <= INT8_MAX) {
+        *encoding = ZIP_INT_8B;
+    } else if (value >= INT16_MIN && value <= INT16_MAX) {
+        *encoding = ZIP_INT_16B;
+    } else if (value >= INT32_MIN && value <= INT32_MAX) {
+        *encoding = ZIP_INT_32B;
+    } else {
+        *encoding = ZIP_INT_64B;
+    }
+    *v = value;
+    return 1;
+}
+
+/* Store integer 'value' at 'p', encoded as 'encoding' */
+//保存整数
+static void zipSaveInteger(unsigned char *p, int64_t value, unsigned char encoding) {
+    int8_t i8;
+    int16_t i16;
+    int32_t i32;
+    int64_t i64;
+
+    if (encoding == ZIP_INT_8B) {
+        i8 = value;
+        memcpy(p,&i8,sizeof(i8));
+    } else if (encoding == ZIP_INT_16B) {
+        i16 = value;
+        memcpy(p,&i16,sizeof(i16));
+    } else if (encoding == ZIP_INT_32B) {
+        i32 = value;
+        memcpy(p,&i32,sizeof(i32));
+    } else if (encoding == ZIP_INT_64B) {
+        i64 = value;
+        memcpy(p,&i64,sizeof(i64));
+    } else {
+        assert(NULL);
+    }
+}
+
+/* Read integer encoded as 'encoding' from 'p' */
+//读取整数
+static int64_t zipLoadInteger(unsigned char *p, unsigned char encoding) {
+    int8_t i8;
+    int16_t i16;
+    int32_t i32;
+    int64_t i64, ret = 0;
+
+    if (encoding == ZIP_INT_8B) {
+        memcpy(&i8,p,sizeof(i8));
+        ret = i8;
+    } else if (encoding == ZIP_INT_16B) {
+        memcpy(&i16,p,sizeof(i16));
+        ret = i16;
+    } else if (encoding == ZIP_INT_32B) {
+        memcpy(&i32,p,sizeof(i32));
+        ret = i32;
+    } else if (encoding == ZIP_INT_64B) {
+        memcpy(&i64,p,sizeof(i64));
+        ret = i64;
+    } else {
+        assert(NULL);
+    }
+    return ret;
+}
+
+/* Return a struct with all information about an entry. */
+//解码p指向的元素的头部
+static zlentry zipEntry(unsigned char *p) {
+    zlentry e;
+
+    e.prevrawlen = zipPrevDecodeLength(p,&e.prevrawlensize);
+    e.len = zipDecodeLength(p+e.prevrawlensize,&e.lensize);
+    e.headersize = e.prevrawlensize+e.lensize;
+    e.encoding = zipEntryEncoding(p+e.prevrawlensize);
+    e.p = p;
+    return e;
+}
+
+/* Return the total number of bytes used by the entry at "p". */
+//p指向的元素占用的字节数
+static unsigned int zipRawEntryLength(unsigned char *p) {
+    unsigned int prevlensize, lensize, len;
+
+    zipPrevDecodeLength(p,&prevlensize);
+    len = zipDecodeLength(p+prevlensize,&lensize);
+    return prevlensize+lensize+len;
+}
+
+/* Create a new empty ziplist. */
+//创建一个空的ziplist
+unsigned char *ziplistNew(void) {
+    unsigned int bytes = ZIPLIST_HEADER_SIZE+1;
+    unsigned char *zl = zmalloc(bytes);
+
+    if (zl == NULL) ziplistOomAbort();
+    ZIPLIST_BYTES(zl) = bytes;
+    ZIPLIST_TAIL_OFFSET(zl) = ZIPLIST_HEADER_SIZE;
+    ZIPLIST_LENGTH(zl) = 0;
+    zl[bytes-1] = ZIP_END;
+    return zl;
+}
+
+/* Resize the ziplist. */
+//调整ziplist的大小
+static unsigned char *ziplistResize(unsigned char *zl, unsigned int len) {
+    zl = zrealloc(zl,len);
+    if (zl == NULL) ziplistOomAbort();
+    ZIPLIST_BYTES(zl) = len;
+    zl[len-1] = ZIP_END;
+    return zl;
+}
+
+/* When an entry is inserted, we need to set the prevlen field of the next
+ * entry to equal the length of the inserted entry. It can occur that this
+ * length cannot be encoded in 1 byte and the next entry needs to be grow
+ * a bit larger to hold the 5-byte encoded prevlen. This can be done for free,
+ * because this only happens when an entry is already being inserted (which
+ * causes a realloc and memmove). However, encoding the prevlen may require
+ * that this entry is grown as well. This effect may cascade throughout
+ * the ziplist when there are consecutive entries with a size close to
+ * ZIP_BIGLEN, so we need to check that the prevlen can be encoded in every
+ * consecutive entry.
+ *
+ * Note that this effect can also happen in reverse, where the bytes required
+ * to encode the prevlen field can shrink. This effect is deliberately ignored,
+ * because it can cause a "flapping" effect where a chain prevlen fields is
+ * first grown and then shrunk again after consecutive inserts. Rather, the
+ * field is allowed to stay larger than necessary, because a large prevlen
+ * field implies the ziplist is holding large entries anyway.
+ *
+ * The pointer "p" points to the first entry that does NOT need to be
+ * updated, i.e. consecutive fields MAY need an update. */
+//级联更新后续元素的prevlen字段
+static unsigned char *__ziplistCascadeUpdate(unsigned char *zl, unsigned char *p) {
+    size_t curlen = ZIPLIST_BYTES(zl), rawlen, rawlensize;
+    size_t offset, noffset, extra;
+    unsigned char *np;
+    zlentry cur, next;
+
+    while (p[0] != ZIP_END) {
+        cur = zipEntry(p);
+        rawlen = cur.headersize + cur.len;
+        rawlensize = zipPrevEncodeLength(NULL,rawlen);
+
+        /* Abort if there is no next entry. */
+        if (p[rawlen] == ZIP_END) break;
+        next = zipEntry(p+rawlen);
+
+        /* Abort when "prevlen" has not changed. */
+        if (next.prevrawlen == rawlen) break;
+
+        if (next.prevrawlensize < rawlensize) {
+            /* The "prevlen" field of "next" needs more bytes to hold
+             * the raw length of "cur". */
+            offset = p-zl;
+            extra = rawlensize-next.prevrawlensize;
+            zl = ziplistResize(zl,curlen+extra);
+            p = zl+offset;
+
+            /* Current pointer and offset for next element. */
+            np = p+rawlen;
+            noffset = np-zl;
+
+            /* Update tail offset when next element is not the tail element. */
+            if ((zl+ZIPLIST_TAIL_OFFSET(zl)) != np)
+                ZIPLIST_TAIL_OFFSET(zl) += extra;
+
+            /* Move the tail to the back. */
+            memmove(np+rawlensize,
+                np+next.prevrawlensize,
+                curlen-noffset-next.prevrawlensize-1);
+            zipPrevEncodeLength(np,rawlen);
+
+            /* Advance the cursor */
+            p += rawlen;
+            curlen += extra;
+        } else {
+            if (next.prevrawlensize > rawlensize) {
+                /* This would result in shrinking, which we want to avoid.
+                 * So, set "rawlen" in the available bytes. */
+                zipPrevEncodeLengthForceLarge(p+rawlen,rawlen);
+            } else {
+                zipPrevEncodeLength(p+rawlen,rawlen);
+            }
+
+            /* Stop here, as the raw length of "next" has not changed. */
+            break;
+        }
+    }
+    return zl;
+}
+
+/* Delete "num" entries, starting at "p". Returns pointer to the ziplist. */
+//从p开始删除num个元素
+static unsigned char *__ziplistDelete(unsigned char *zl, unsigned char *p, unsigned int num) {
+    unsigned int i, totlen, deleted = 0;
+    size_t offset;
+    int nextdiff = 0;
+    zlentry first, tail;
+
+    first = zipEntry(p);
+    for (i = 0; p[0] != ZIP_END && i < num; i++) {
+        p += zipRawEntryLength(p);
+        deleted++;
+    }
+
+    totlen = p-first.p;
+    if (totlen > 0) {
+        if (p[0] != ZIP_END) {
+            /* Storing the prevrawlen in this entry may increase or decrease
+             * the number of bytes required compare to the current one.
+             * There always is room to store this, because it was previously
+             * stored by an entry that is now being deleted. */
+            nextdiff = zipPrevLenByteDiff(p,first.prevrawlen);
+            p -= nextdiff;
+            zipPrevEncodeLength(p,first.prevrawlen);
+
+            /* Update offset for tail */
+            ZIPLIST_TAIL_OFFSET(zl) -= totlen;
+
+            /* When the tail contains more than one entry, we need to take
+             * "nextdiff" in account as well. Otherwise, a change in the
+             * size of prevlen doesn't have an effect on the *tail* offset. */
+            tail = zipEntry(p);
+            if (p[tail.headersize+tail.len] != ZIP_END)
+                ZIPLIST_TAIL_OFFSET(zl) += nextdiff;
+
+            /* Move tail to the front of the ziplist */
+            memmove(first.p,p,ZIPLIST_BYTES(zl)-(p-zl)-1);
+        } else {
+            /* The entire tail was deleted. No need to move memory. */
+            ZIPLIST_TAIL_OFFSET(zl) = (first.p-zl)-first.prevrawlen;
+        }
+
+        /* Resize and update length */
+        offset = first.p-zl;
+        zl = ziplistResize(zl,ZIPLIST_BYTES(zl)-totlen+nextdiff);
+        ZIPLIST_INCR_LENGTH(zl,-(int)deleted);
+        p = zl+offset;
+
+        /* When nextdiff != 0, the raw length of the next entry has changed, so
+         * we need to cascade the update throughout the ziplist */
+        if (nextdiff != 0)
+            zl = __ziplistCascadeUpdate(zl,p);
+    }
+    return zl;
+}
+
+/* Insert item at "p". */
+//在p的位置插入一个元素
+static unsigned char *__ziplistInsert(unsigned char *zl, unsigned char *p, unsigned char *s, unsigned int slen) {
+    size_t curlen = ZIPLIST_BYTES(zl), reqlen, prevlen = 0;
+    size_t offset;
+    int nextdiff = 0, forcelarge = 0;
+    unsigned char encoding = 0;
+    long long value = 0;
+    zlentry entry, tail;
+
+    /* Find out prevlen for the entry that is inserted. */
+    if (p[0] != ZIP_END) {
+        entry = zipEntry(p);
+        prevlen = entry.prevrawlen;
+    } else {
+        unsigned char *ptail = ZIPLIST_ENTRY_TAIL(zl);
+        if (ptail[0] != ZIP_END)
+            prevlen = zipRawEntryLength(ptail);
+    }
+
+    /* See if the entry can be encoded */
+    if (zipTryEncoding(s,slen,&value,&encoding)) {
+        /* 'encoding' is set to the appropriate integer encoding */
+        reqlen = zipIntSize(encoding);
+    } else {
+        /* 'encoding' is untouched, however zipEncodeLength will use the
+         * string length to figure out how to encode it. */
+        reqlen = slen;
+    }
+    /* We need space for both the length of the previous entry and
+     * the length of the payload. */
+    reqlen += zipPrevEncodeLength(NULL,prevlen);
+    reqlen += zipEncodeLength(NULL,encoding,slen);
+
+    /* When the insert position is not equal to the tail, we need to
+     * make sure that the next entry can hold this entry's length in
+     * its prevlen field. If the next entry has a 5 bytes prevlen that is
+     * now too big, and the new entry is smaller than 4 bytes, shrinking
+     * it would make the ziplist smaller before the memmove() below, so in
+     * this case the large prevlen is kept. */
+    nextdiff = (p[0] != ZIP_END) ? zipPrevLenByteDiff(p,reqlen) : 0;
+    if (nextdiff == -4 && reqlen < 4) {
+        nextdiff = 0;
+        forcelarge = 1;
+    }
+
+    /* Store offset because a realloc may change the address of zl. */
+    offset = p-zl;
+    zl = ziplistResize(zl,curlen+reqlen+nextdiff);
+    p = zl+offset;
+
+    /* Apply memory move when necessary and update tail offset. */
+    if (p[0] != ZIP_END) {
+        /* Subtract one because of the ZIP_END bytes */
+        memmove(p+reqlen,p-nextdiff,curlen-offset-1+nextdiff);
+
+        /* Encode this entry's raw length in the next entry. */
+        if (forcelarge)
+            zipPrevEncodeLengthForceLarge(p+reqlen,reqlen);
+        else
+            zipPrevEncodeLength(p+reqlen,reqlen);
+
+        /* Update offset for tail */
+        ZIPLIST_TAIL_OFFSET(zl) += reqlen;
+
+        /* When the tail contains more than one entry, we need to take
+         * "nextdiff" in account as well. Otherwise, a change in the
+         * size of prevlen doesn't have an effect on the *tail* offset. */
+        tail = zipEntry(p+reqlen);
+        if (p[reqlen+tail.headersize+tail.len] != ZIP_END)
+            ZIPLIST_TAIL_OFFSET(zl) += nextdiff;
+    } else {
+        /* This element will be the new tail. */
+        ZIPLIST_TAIL_OFFSET(zl) = p-zl;
+    }
+
+    /* When nextdiff != 0, the raw length of the next entry has changed, so
+     * we need to cascade the update throughout the ziplist */
+    if (nextdiff != 0) {
+        offset = p-zl;
+        zl = __ziplistCascadeUpdate(zl,p+reqlen);
+        p = zl+offset;
+    }
+
+    /* Write the entry */
+    p += zipPrevEncodeLength(p,prevlen);
+    p += zipEncodeLength(p,encoding,slen);
+    if (ZIP_IS_STR(encoding)) {
+        memcpy(p,s,slen);
+    } else {
+        zipSaveInteger(p,value,encoding);
+    }
+    ZIPLIST_INCR_LENGTH(zl,1);
+    return zl;
+}
+
+//在头部或者尾部添加一个元素
+unsigned char *ziplistPush(unsigned char *zl, unsigned char *s, unsigned int slen, int where) {
+    unsigned char *p;
+
+    p = (where == ZIPLIST_HEAD) ? ZIPLIST_ENTRY_HEAD(zl) : ZIPLIST_ENTRY_END(zl);
+    return __ziplistInsert(zl,p,s,slen);
+}
+
+/* Returns an offset to use for iterating with ziplistNext. When the given
+ * index is negative, the list is traversed back to front. When the list
+ * doesn't contain an element at the provided index, NULL is returned. */
+//获取index位置的元素
+unsigned char *ziplistIndex(unsigned char *zl, int index) {
+    unsigned char *p;
+    zlentry entry;
+
+    if (index < 0) {
+        index = (-index)-1;
+        p = ZIPLIST_ENTRY_TAIL(zl);
+        if (p[0] != ZIP_END) {
+            entry = zipEntry(p);
+            while (entry.prevrawlen > 0 && index--) {
+                p -= entry.prevrawlen;
+                entry = zipEntry(p);
+            }
+        }
+    } else {
+        p = ZIPLIST_ENTRY_HEAD(zl);
+        while (p[0] != ZIP_END && index--)
+            p += zipRawEntryLength(p);
+    }
+    return (p[0] == ZIP_END || index > 0) ? NULL : p;
+}
+
+/* Return pointer to next entry in ziplist, or NULL at the end. */
+//获取下一个元素
+unsigned char *ziplistNext(unsigned char *zl, unsigned char *p) {
+    ((void) zl);
+
+    /* "p" could be equal to ZIP_END, caused by ziplistDelete,
+     * and we should return NULL. Otherwise, we should return NULL
+     * when the *next* element is ZIP_END (there is no next entry). */
+    if (p[0] == ZIP_END) return NULL;
+    p += zipRawEntryLength(p);
+    if (p[0] == ZIP_END) return NULL;
+    return p;
+}
+
+/* Return pointer to previous entry in ziplist, or NULL at the head. */
+//获取上一个元素
+unsigned char *ziplistPrev(unsigned char *zl, unsigned char *p) {
+    zlentry entry;
+
+    /* Iterating backwards from ZIP_END should return the tail. When "p" is
+     * equal to the first element of the list, we're already at the head,
+     * and should return NULL. */
+    if (p[0] == ZIP_END) {
+        p = ZIPLIST_ENTRY_TAIL(zl);
+        return (p[0] == ZIP_END) ? NULL : p;
+    } else if (p == ZIPLIST_ENTRY_HEAD(zl)) {
+        return NULL;
+    } else {
+        entry = zipEntry(p);
+        assert(entry.prevrawlen > 0);
+        return p-entry.prevrawlen;
+    }
+}
+
+/* Get entry pointed to by 'p' and store in either 'sval' or 'lval' depending
+ * on the encoding of the entry. 'sval' is set to NULL for integers. Return 0
+ * if 'p' points to the end of the ziplist, 1 otherwise. */
+//读取p指向的元素
+unsigned int ziplistGet(unsigned char *p, unsigned char **sval, unsigned int *slen, long long *lval) {
+    zlentry entry;
+
+    if (p == NULL || p[0] == ZIP_END) return 0;
+    if (sval) *sval = NULL;
+
+    entry = zipEntry(p);
+    if (ZIP_IS_STR(entry.encoding)) {
+        if (sval) {
+            *slen = entry.len;
+            *sval = p+entry.headersize;
+        }
+    } else {
+        if (lval) *lval = zipLoadInteger(p+entry.headersize,entry.encoding);
+    }
+    return 1;
+}
+
+/* Insert an entry at "p". */
+//在p指向的元素前插入
+unsigned char *ziplistInsert(unsigned char *zl, unsigned char *p, unsigned char *s, unsigned int slen) {
+    return __ziplistInsert(zl,p,s,slen);
+}
+
+/* Delete a single entry from the ziplist, pointed to by *p.
+ * Also update *p in place, to be able to iterate over the
+ * ziplist, while deleting entries. */
+//删除*p指向的元素
+unsigned char *ziplistDelete(unsigned char *zl, unsigned char **p) {
+    size_t offset = *p-zl;
+
+    zl = __ziplistDelete(zl,*p,1);
+
+    /* Store pointer to current element in p, because ziplistDelete will
+     * do a realloc which might result in a different "zl"-pointer.
+     * When the delete direction is back to front, we might delete the last
+     * entry and end up with "p" pointing to ZIP_END, so check this. */
+    *p = zl+offset;
+    return zl;
+}
+
+/* Delete a range of entries from the ziplist. */
+//删除从index开始的num个元素
+unsigned char *ziplistDeleteRange(unsigned char *zl, int index, unsigned int num) {
+    unsigned char *p = ziplistIndex(zl,index);
+
+    return (p == NULL) ? zl : __ziplistDelete(zl,p,num);
+}
+
+/* Compare entry pointer to by 'p' with 'sstr' of length 'slen'. */
+/* Return 1 if equal. */
+//比较p指向的元素与字符串是否相等
+unsigned int ziplistCompare(unsigned char *p, unsigned char *sstr, unsigned int slen) {
+    zlentry entry;
+    unsigned char sencoding;
+    long long zval, sval;
+
+    if (p[0] == ZIP_END) return 0;
+
+    entry = zipEntry(p);
+    if (ZIP_IS_STR(entry.encoding)) {
+        /* Raw compare */
+        if (entry.len == slen)
+            return memcmp(p+entry.headersize,sstr,slen) == 0;
+        return 0;
+    } else {
+        /* Try to compare encoded values. Strings that are not the
+         * canonical form of an integer can't be equal to an integer. */
+        if (zipTryEncoding(sstr,slen,&sval,&sencoding)) {
+            zval = zipLoadInteger(p+entry.headersize,entry.encoding);
+            return zval == sval;
+        }
+    }
+    return 0;
+}
+
+/* Return length of ziplist. */
+//元素个数
+unsigned int ziplistLen(unsigned char *zl) {
+    unsigned int len = 0;
+
+    if (ZIPLIST_LENGTH(zl) < UINT16_MAX) {
+        len = ZIPLIST_LENGTH(zl);
+    } else {
+        unsigned char *p = zl+ZIPLIST_HEADER_SIZE;
+        while (*p != ZIP_END) {
+            p += zipRawEntryLength(p);
+            len++;
+        }
+
+        /* Re-store length if small enough */
+        if (len < UINT16_MAX) ZIPLIST_LENGTH(zl) = len;
+    }
+    return len;
+}
+
+/* Return ziplist blob size in bytes. */
+//ziplist占用的字节数
+size_t ziplistBlobLen(unsigned char *zl) {
+    return ZIPLIST_BYTES(zl);
+}
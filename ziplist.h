@@ -0,0 +1,69 @@
+/*
+ * ziplist.h与ziplist.c实现的是一个紧凑的双向链表：
+ * 所有元素保存在一块连续的内存中，用于保存元素较少、较短的list
+ */
+
+#ifndef _ZIPLIST_H
+#define _ZIPLIST_H
+
+#define ZIPLIST_HEAD 0
+#define ZIPLIST_TAIL 1
+
+/*
+ * 创建一个空的ziplist
+ */
+unsigned char *ziplistNew(void);
+
+/*
+ * 在头部(ZIPLIST_HEAD)或者尾部(ZIPLIST_TAIL)添加一个元素
+ * 返回新的ziplist地址
+ */
+unsigned char *ziplistPush(unsigned char *zl, unsigned char *s, unsigned int slen, int where);
+
+/*
+ * 获取index位置的元素，负数表示从尾部开始，越界时返回NULL
+ */
+unsigned char *ziplistIndex(unsigned char *zl, int index);
+
+/*
+ * 获取下一个/上一个元素，没有时返回NULL
+ */
+unsigned char *ziplistNext(unsigned char *zl, unsigned char *p);
+unsigned char *ziplistPrev(unsigned char *zl, unsigned char *p);
+
+/*
+ * 读取p指向的元素，字符串保存在sval/slen中，整数保存在lval中(*sval为NULL)
+ */
+unsigned int ziplistGet(unsigned char *p, unsigned char **sval, unsigned int *slen, long long *lval);
+
+/*
+ * 在p指向的元素前插入一个元素
+ */
+unsigned char *ziplistInsert(unsigned char *zl, unsigned char *p, unsigned char *s, unsigned int slen);
+
+/*
+ * 删除*p指向的元素，*p更新为下一个元素，便于在迭代时删除
+ */
+unsigned char *ziplistDelete(unsigned char *zl, unsigned char **p);
+
+/*
+ * 从index开始删除num个元素
+ */
+unsigned char *ziplistDeleteRange(unsigned char *zl, int index, unsigned int num);
+
+/*
+ * 比较p指向的元素与字符串s是否相等
+ */
+unsigned int ziplistCompare(unsigned char *p, unsigned char *s, unsigned int slen);
+
+/*
+ * 元素个数
+ */
+unsigned int ziplistLen(unsigned char *zl);
+
+/*
+ * ziplist占用的字节数
+ */
+size_t ziplistBlobLen(unsigned char *zl);
+
+#endif /* _ZIPLIST_H */
@@ -1,31 +1,90 @@
+#include "fmacros.h"
 //系统C语言标准库
 #include <stdlib.h>
 //系统标准库(提供的字符串相关操作的函数)
 #include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
 //自定的配置的头文件   
 #include "config.h"
+#include "zmalloc.h"
+
+/* When the allocator can tell the size of a block (HAVE_MALLOC_SIZE, see
+ * config.h) no header is needed, and used_memory accounts the real size of
+ * the blocks, including the allocator rounding to its size classes.
+ * Otherwise every allocation is prefixed by a size_t holding its size. */
+#ifdef HAVE_MALLOC_SIZE
+#define PREFIX_SIZE (0)
+#else
+#define PREFIX_SIZE (sizeof(size_t))
+#endif
+
+/* Once zmalloc_enable_thread_safeness() is called other threads may
+ * allocate and free memory concurrently with the main one, so the counter
+ * is updated with atomic operations (or under a mutex where the compiler
+ * does not provide them). Before that the plain update is used, that's
+ * the only path taken by redis-cli and redis-benchmark. */
+#ifdef HAVE_ATOMIC
+#define update_zmalloc_stat_add(__n) __sync_add_and_fetch(&used_memory, (__n))
+#define update_zmalloc_stat_sub(__n) __sync_sub_and_fetch(&used_memory, (__n))
+#else
+#define update_zmalloc_stat_add(__n) do { \
+    pthread_mutex_lock(&used_memory_mutex); \
+    used_memory += (__n); \
+    pthread_mutex_unlock(&used_memory_mutex); \
+} while(0)
+#define update_zmalloc_stat_sub(__n) do { \
+    pthread_mutex_lock(&used_memory_mutex); \
+    used_memory -= (__n); \
+    pthread_mutex_unlock(&used_memory_mutex); \
+} while(0)
+#endif
+
+#define increment_used_memory(__n) do { \
+    size_t _n = (__n); \
+    if (zmalloc_thread_safe) { \
+        update_zmalloc_stat_add(_n); \
+    } else { \
+        used_memory += _n; \
+    } \
+} while(0)
+
+#define decrement_used_memory(__n) do { \
+    size_t _n = (__n); \
+    if (zmalloc_thread_safe) { \
+        update_zmalloc_stat_sub(_n); \
+    } else { \
+        used_memory -= _n; \
+    } \
+} while(0)
 
 //目前已经使用的内存空间量
 static size_t used_memory = 0;
+//是否有其他线程同时分配/释放内存
+static int zmalloc_thread_safe = 0;
+#ifndef HAVE_ATOMIC
+static pthread_mutex_t used_memory_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 //申请size大小的空间
 void *zmalloc(size_t size) {
-    //从这里可以看出的是不旦申请了，还多申请了sizeof(size_t)个空间
-    void *ptr = malloc(size+sizeof(size_t));
+    //没有redis_malloc_size时，还多申请了sizeof(size_t)个空间用于存放size
+    void *ptr = malloc(size+PREFIX_SIZE);
     //如果申请失败的情况下，直接返回NULL
     if (!ptr) return NULL;
 #ifdef HAVE_MALLOC_SIZE
-    //redis_malloc_size用于Apple下获取ptr指向的空间大小
-    used_memory += redis_malloc_size(ptr);
+    //redis_malloc_size用于获取ptr指向的空间的实际大小
+    increment_used_memory(redis_malloc_size(ptr));
     return ptr;
 #else
     //前一个字节用于存放分配的内存空间大小
     *((size_t*)ptr) = size;
     //由于申请了size+sizeof(size_t)个空间
     //因此内存空间的使用量又增加了
-    used_memory += size+sizeof(size_t);
+    increment_used_memory(size+PREFIX_SIZE);
     //返回的位置向前移动了sizeof(size_t)个空间
-    return (char*)ptr+sizeof(size_t);
+    return (char*)ptr+PREFIX_SIZE;
 #endif
 }
 
@@ -35,7 +94,7 @@ void *zmalloc(size_t size) {
  */
 
 void *zrealloc(void *ptr, size_t size) {
-//在Apple下会定义了HAVE_MALLOC_SIZE
+//有redis_malloc_size时不需要头部
 #ifndef HAVE_MALLOC_SIZE
     //返回存放数据的实际地址
     void *realptr;
@@ -53,22 +112,22 @@ void *zrealloc(void *ptr, size_t size) {
     //分配失败的情况下
     if (!newptr) return NULL;
     //记录重新分配后所占用的内存空间大小
-    used_memory -= oldsize;
-    used_memory += redis_malloc_size(newptr);
+    decrement_used_memory(oldsize);
+    increment_used_memory(redis_malloc_size(newptr));
     return newptr;
 #else
-    realptr = (char*)ptr-sizeof(size_t);
+    realptr = (char*)ptr-PREFIX_SIZE;
     //前sizeof(size_t)存放着分配的内存空间大小
     oldsize = *((size_t*)realptr);
     //重新分配内存空间的大小
-    newptr = realloc(realptr,size+sizeof(size_t));
+    newptr = realloc(realptr,size+PREFIX_SIZE);
     if (!newptr) return NULL;
     //记录分配的内存空间大小
     *((size_t*)newptr) = size;
-    used_memory -= oldsize;
-    used_memory += size;
+    decrement_used_memory(oldsize);
+    increment_used_memory(size);
     //返回的地址
-    return (char*)newptr+sizeof(size_t);
+    return (char*)newptr+PREFIX_SIZE;
 #endif
 }
 
@@ -77,25 +136,23 @@ void *zrealloc(void *ptr, size_t size) {
  */
 
 void zfree(void *ptr) {
-//如果是apple机的话
-//就会定义HAVE_MALLOC_SIZE
+//没有redis_malloc_size时需要从头部读取大小
 #ifndef HAVE_MALLOC_SIZE
     void *realptr;
     size_t oldsize;
 #endif
 //ptr=NULL表示ptr压根就没指向任何空间
     if (ptr == NULL) return;
-//如果是在Apple机的情况下
+//能够直接获取内存块大小的情况下
 #ifdef HAVE_MALLOC_SIZE
-    used_memory -= redis_malloc_size(ptr);
+    decrement_used_memory(redis_malloc_size(ptr));
     free(ptr);
 #else
-    //如果不是在Apple机的情况下
-    //realptr指向内存空间的前sizeof(size_t)
+    //否则realptr指向内存空间的前sizeof(size_t)
     //个字节存放的是分配的内存空间大小
-    realptr = (char*)ptr-sizeof(size_t);
+    realptr = (char*)ptr-PREFIX_SIZE;
     oldsize = *((size_t*)realptr);
-    used_memory -= oldsize+sizeof(size_t);
+    decrement_used_memory(oldsize+PREFIX_SIZE);
     free(realptr);
 #endif
 }
@@ -119,5 +176,58 @@ char *zstrdup(const char *s) {
 
 //返回使用的内存空间的大小
 size_t zmalloc_used_memory(void) {
+    size_t um;
+
+    if (zmalloc_thread_safe) {
+#ifdef HAVE_ATOMIC
+        um = __sync_add_and_fetch(&used_memory, 0);
+#else
+        pthread_mutex_lock(&used_memory_mutex);
+        um = used_memory;
+        pthread_mutex_unlock(&used_memory_mutex);
+#endif
+    } else {
+        um = used_memory;
+    }
+    return um;
+}
+
+/* Must be called before starting other threads that use zmalloc. */
+//开启线程安全的内存统计
+void zmalloc_enable_thread_safeness(void) {
+    zmalloc_thread_safe = 1;
+}
+
+/* Return the Resident Set Size of the process, as reported by the kernel.
+ * Compared to zmalloc_used_memory() it also includes the fragmentation and
+ * the memory the allocator did not return to the OS. Where /proc is not
+ * available the used memory is returned instead. */
+//返回进程实际占用的物理内存(RSS)
+size_t zmalloc_get_rss(void) {
+#ifdef HAVE_PROCFS
+    char buf[4096], *p;
+    long rss;
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen("/proc/self/stat","r")) == NULL)
+        return used_memory;
+    if (fgets(buf,sizeof(buf),fp) == NULL) {
+        fclose(fp);
+        return used_memory;
+    }
+    fclose(fp);
+
+    /* RSS is the 24th field of /proc/<pid>/stat, in pages */
+    p = buf;
+    for (i = 0; i < 23 && p; i++) {
+        p = strchr(p,' ');
+        if (p) p++;
+    }
+    if (!p) return used_memory;
+    rss = strtol(p,NULL,10);
+    return (size_t)rss * sysconf(_SC_PAGESIZE);
+#else
     return used_memory;
+#endif
 }
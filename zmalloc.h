@@ -75,4 +75,28 @@ char *zstrdup(const char *s);
 
 size_t zmalloc_used_memory(void);
 
+/*
+ * 开启线程安全的内存使用量统计，需要在创建其他线程前调用
+ */
+
+void zmalloc_enable_thread_safeness(void);
+
+/*
+ * 获取进程实际占用的物理内存(RSS)
+ */
+
+size_t zmalloc_get_rss(void);
+
+/*
+ * 使用的内存分配器的名字
+ */
+
+#if defined(USE_TCMALLOC)
+#define ZMALLOC_LIB "tcmalloc"
+#elif defined(USE_JEMALLOC)
+#define ZMALLOC_LIB "jemalloc"
+#else
+#define ZMALLOC_LIB "libc"
+#endif
+
 #endif /* _ZMALLOC_H */